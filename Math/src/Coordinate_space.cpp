@@ -8,10 +8,19 @@ namespace Dubious {
 namespace Math {
 
 Coordinate_space::Coordinate_space(const Point& p, const Unit_quaternion& r)
-    : m_position(p), m_rotation(r)
+    : m_position(p), m_rotation(r), m_matrix(r)
 {
 }
 
+void
+Coordinate_space::update_matrix()
+{
+    if (m_matrix_dirty) {
+        m_matrix       = Rotation_matrix(m_rotation);
+        m_matrix_dirty = false;
+    }
+}
+
 void
 Coordinate_space::get_matrix(float matrix[16]) const
 {
@@ -49,7 +58,9 @@ Coordinate_space::rotate(const Unit_quaternion& diff)
     // against the global space (diff) we can't apply it to our existing m_rotation because
     // that's already put us into a local coordinate space. So we start by applying diff to
     // the global space, and then apply out m_rotation to get our new m_rotation
-    m_rotation = diff * m_rotation;
+    m_rotation     = diff * m_rotation;
+    m_matrix       = Rotation_matrix(m_rotation);
+    m_matrix_dirty = false;
 }
 
 void
@@ -60,28 +71,30 @@ Coordinate_space::rotate(const Local_unit_quaternion& diff)
     // Local_unit_quaternion and use that.
     m_rotation =
         m_rotation * Unit_quaternion(diff.m_w, Vector(diff.m_v.x(), diff.m_v.y(), diff.m_v.z()));
+    m_matrix       = Rotation_matrix(m_rotation);
+    m_matrix_dirty = false;
 }
 
 Vector
 Coordinate_space::transform(const Local_vector& v) const
 {
-    // https://en.wikipedia.org/wiki/Quaternions_and_spatial_rotation
-    // I have to do some (hacky) direct converstions between local and
-    // global space... but that's because this function is meant to do that
-    // exact conversion. I do it in global space because that's how
-    // m_rotation is stored.
-    Quaternion diff(0, Vector(v.x(), v.y(), v.z()));
-    Quaternion rotated = m_rotation * diff * m_rotation.conjugate();
-    return rotated.v();
+    // https://en.wikipedia.org/wiki/Rotation_matrix#Quaternion
+    // This used to be the q * v * q^-1 sandwich, which is the same thing
+    // but takes about four times the work
+    if (m_matrix_dirty) {
+        return Rotation_matrix(m_rotation).transform(v);
+    }
+    return m_matrix.transform(v);
 }
 
 Local_vector
 Coordinate_space::transform(const Vector& v) const
 {
     // The inverse of Vector Coordinate_space::transform(const Local_vector& v)
-    Quaternion diff(0, v);
-    Quaternion rotated = m_rotation.conjugate() * diff * m_rotation;
-    return Local_vector(rotated.v().x(), rotated.v().y(), rotated.v().z());
+    if (m_matrix_dirty) {
+        return Rotation_matrix(m_rotation).transform(v);
+    }
+    return m_matrix.transform(v);
 }
 
 Point
@@ -3,6 +3,7 @@
 
 #include "Point.h"
 #include "Unit_quaternion.h"
+#include "Rotation_matrix.h"
 
 namespace Physics_test {
 class Collision_solver_test;
@@ -23,6 +24,9 @@ namespace Math {
 ///	and positive Z is going from this text to your eye.  If you hold up your right hand and
 ///	place your thumb along positive X and your index finger along positive Y then your middle
 ///	finger is pointing along positive Z (at you).
+///
+///	The rotation is also kept as a Rotation_matrix, which makes the transform functions
+///	much cheaper than rotating with the quaternion.
 class Coordinate_space {
 public:
     Coordinate_space() = default;
@@ -46,8 +50,24 @@ public:
     Point&       position() { return m_position; }
 
     /// @brief Rotation accessor
+    ///
+    /// Since the rotation can be changed through the non-const version, the
+    /// Rotation_matrix is out of date after calling it. The transform
+    /// functions still work, but they build a matrix every time until
+    /// update_matrix is called.
     const Unit_quaternion& rotation() const { return m_rotation; }
-    Unit_quaternion&       rotation() { return m_rotation; }
+    Unit_quaternion&       rotation()
+    {
+        m_matrix_dirty = true;
+        return m_rotation;
+    }
+
+    /// @brief Bring the Rotation_matrix up to date with the rotation
+    ///
+    /// Call this after changing rotation() directly and before doing a
+    /// lot of transforms. The transform functions never change the
+    /// Coordinate_space, so they're safe to call from many threads at once.
+    void update_matrix();
 
     /// @brief Move by the amount specified
     ///
@@ -112,6 +132,8 @@ private:
 
     Point           m_position;
     Unit_quaternion m_rotation;
+    Rotation_matrix m_matrix;
+    bool            m_matrix_dirty = false;
 };
 
 bool          operator==(const Coordinate_space& a, const Coordinate_space& b);
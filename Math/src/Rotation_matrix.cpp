@@ -0,0 +1,31 @@
+#include "Rotation_matrix.h"
+
+namespace Dubious {
+namespace Math {
+
+Rotation_matrix::Rotation_matrix(const Unit_quaternion& q)
+{
+    // Same as Unit_quaternion::get_matrix, but only the 3x3 part
+    const float x  = q.v().x();
+    const float y  = q.v().y();
+    const float z  = q.v().z();
+    const float w  = q.w();
+    const float xx = x * x;
+    const float yy = y * y;
+    const float zz = z * z;
+
+    m_m[0][0] = 1.0f - 2.0f * (yy + zz);
+    m_m[0][1] = 2.0f * (x * y - w * z);
+    m_m[0][2] = 2.0f * (x * z + w * y);
+
+    m_m[1][0] = 2.0f * (x * y + w * z);
+    m_m[1][1] = 1.0f - 2.0f * (xx + zz);
+    m_m[1][2] = 2.0f * (y * z - w * x);
+
+    m_m[2][0] = 2.0f * (x * z - w * y);
+    m_m[2][1] = 2.0f * (y * z + w * x);
+    m_m[2][2] = 1.0f - 2.0f * (xx + yy);
+}
+
+}  // namespace Math
+}  // namespace Dubious
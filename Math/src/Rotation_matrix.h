@@ -0,0 +1,63 @@
+#ifndef INCLUDED_MATH_ROTATIONMATRIX
+#define INCLUDED_MATH_ROTATIONMATRIX
+
+#include "Vector.h"
+#include "Unit_quaternion.h"
+
+namespace Dubious {
+namespace Math {
+
+/// @brief A 3x3 rotation matrix
+///
+/// Rotating a vector with a Unit_quaternion takes two quaternion products,
+/// about 60 flops, where a matrix only needs 15. Building the matrix costs
+/// about as much as one quaternion rotation, so when the same rotation is
+/// applied over and over (collision detection does this a lot) it's well
+/// worth having.
+///
+/// Rotating the other way uses the transpose, which is the inverse for a
+/// rotation. That's just reading the same matrix in a different order.
+class Rotation_matrix {
+public:
+    /// @brief Default Constructor
+    ///
+    /// The identity, same as a default Unit_quaternion
+    Rotation_matrix() = default;
+
+    /// @brief Construct from a Unit_quaternion
+    ///
+    /// @param q - [in] the rotation
+    explicit Rotation_matrix(const Unit_quaternion& q);
+
+    /// @brief Rotate from local to global space
+    ///
+    /// Gives the same result as rotating with the Unit_quaternion
+    /// @param v - [in] a vector in local coordinate space
+    /// @returns The same vector in world coordinate space
+    Vector transform(const Local_vector& v) const
+    {
+        return Vector(m_m[0][0] * v.x() + m_m[0][1] * v.y() + m_m[0][2] * v.z(),
+                      m_m[1][0] * v.x() + m_m[1][1] * v.y() + m_m[1][2] * v.z(),
+                      m_m[2][0] * v.x() + m_m[2][1] * v.y() + m_m[2][2] * v.z());
+    }
+
+    /// @brief Rotate from global to local space, with the transpose
+    ///
+    /// @param v - [in] a vector in world coordinate space
+    /// @returns The same vector in local coordinate space
+    Local_vector transform(const Vector& v) const
+    {
+        return Local_vector(m_m[0][0] * v.x() + m_m[1][0] * v.y() + m_m[2][0] * v.z(),
+                            m_m[0][1] * v.x() + m_m[1][1] * v.y() + m_m[2][1] * v.z(),
+                            m_m[0][2] * v.x() + m_m[1][2] * v.y() + m_m[2][2] * v.z());
+    }
+
+private:
+    // Row x Column
+    float m_m[3][3] = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+};
+
+}  // namespace Math
+}  // namespace Dubious
+
+#endif
@@ -0,0 +1,41 @@
+#include "CppUnitTest.h"
+
+#include <Rotation_matrix.h>
+#include <Quaternion.h>
+#include <Utils.h>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+using namespace Dubious::Math;
+
+namespace Math_test {
+
+class Rotation_matrix_test
+    : public ::Microsoft::VisualStudio::CppUnitTestFramework::TestClass<Rotation_matrix_test> {
+public:
+    TEST_METHOD(rotation_matrix_identity)
+    {
+        Rotation_matrix m;
+        Assert::IsTrue(m.transform(Local_vector(1, 2, 3)) == Vector(1, 2, 3));
+        Assert::IsTrue(m.transform(Vector(1, 2, 3)) == Local_vector(1, 2, 3));
+    }
+
+    TEST_METHOD(rotation_matrix_rotation)
+    {
+        // Should match the quaternion sandwich both ways
+        Unit_quaternion q = Unit_quaternion(Unit_vector(0, 1, 0), to_radians(30)) *
+                            Unit_quaternion(Unit_vector(1, 2, 3), to_radians(-75));
+        Rotation_matrix m(q);
+        Vector          v(1, -2, 0.5f);
+        Quaternion      rotated = q * Quaternion(0, v) * q.conjugate();
+        Assert::IsTrue(m.transform(Local_vector(v.x(), v.y(), v.z())) == rotated.v());
+        Quaternion back = q.conjugate() * Quaternion(0, v) * q;
+        Assert::IsTrue(m.transform(v) == Local_vector(back.v().x(), back.v().y(), back.v().z()));
+
+        // Quarter turn around z takes x to y
+        Rotation_matrix quarter(Unit_quaternion(Unit_vector(0, 0, 1), to_radians(90)));
+        Assert::IsTrue(quarter.transform(Local_vector(1, 0, 0)) == Vector(0, 1, 0));
+        Assert::IsTrue(quarter.transform(Vector(0, 1, 0)) == Local_vector(1, 0, 0));
+    }
+};
+}  // namespace Math_test
@@ -4,12 +4,16 @@
 #include "Collision_strategy_simple.h"
 #include "Collision_strategy_multi_threaded.h"
 #include "Collision_strategy_open_cl.h"
+#include "Collision_strategy_sweep_and_prune.h"
+#include "Collision_strategy_aabb_tree.h"
+#include "Collision_strategy_spatial_hash.h"
 
 #include <Quaternion.h>
 
+#include <algorithm>
 #include <set>
 #include <iostream>
-#include <future>
+#include <thread>
 
 namespace Dubious {
 namespace Physics {
@@ -18,26 +22,38 @@ Arena::Arena(const Settings& settings)
     : m_constraint_solver(settings.constraint.step_size, settings.constraint.beta,
                           settings.constraint.coefficient_of_restitution, settings.constraint.slop)
     , m_settings(settings)
+    , m_manifolds(settings.collision.manifold_persistent_threshold,
+                  settings.collision.manifold_movement_threshold)
+    , m_solver_workers(std::max(1u, settings.constraint.solver_threads))
 {
     switch (m_settings.collision.strategy) {
     case Collision_solver_settings::Strategy::SINGLE_THREADED:
         m_collision_strategy = std::make_unique<Collision_strategy_simple>(
-            m_settings.collision.manifold_persistent_threshold,
-            m_settings.collision.manifold_movement_threshold, m_settings.collision.greedy_manifold);
+            m_settings.collision.greedy_manifold);
         break;
     case Collision_solver_settings::Strategy::MULTI_THREADED:
         m_collision_strategy = std::make_unique<Collision_strategy_multi_threaded>(
-            m_settings.collision.manifold_persistent_threshold,
-            m_settings.collision.manifold_movement_threshold, m_settings.collision.greedy_manifold,
+            m_settings.collision.greedy_manifold,
             m_settings.collision.mt_collisions_work_group_size);
         break;
     case Collision_solver_settings::Strategy::OPENCL:
         m_collision_strategy = std::make_unique<Collision_strategy_open_cl>(
-            m_settings.collision.manifold_persistent_threshold,
-            m_settings.collision.manifold_movement_threshold, m_settings.collision.greedy_manifold,
-            m_settings.collision.cl_collisions_per_thread,
+            m_settings.collision.greedy_manifold, m_settings.collision.cl_collisions_per_thread,
             m_settings.collision.cl_collisions_work_group_size);
         break;
+    case Collision_solver_settings::Strategy::SWEEP_AND_PRUNE:
+        m_collision_strategy = std::make_unique<Collision_strategy_sweep_and_prune>(
+            m_settings.collision.greedy_manifold);
+        break;
+    case Collision_solver_settings::Strategy::AABB_TREE:
+        m_collision_strategy = std::make_unique<Collision_strategy_aabb_tree>(
+            m_settings.collision.greedy_manifold, m_settings.collision.aabb_margin,
+            m_settings.collision.aabb_velocity_multiplier, m_settings.constraint.step_size);
+        break;
+    case Collision_solver_settings::Strategy::SPATIAL_HASH:
+        m_collision_strategy = std::make_unique<Collision_strategy_spatial_hash>(
+            m_settings.collision.greedy_manifold, m_settings.collision.grid_cell_size);
+        break;
     default:
         throw std::runtime_error("Unknown collision strategy requested");
     }
@@ -47,6 +63,8 @@ void
 Arena::push_back(std::shared_ptr<Physics_object> obj)
 {
     obj->id() = ++m_next_object_id;
+    m_body_indices.resize(m_next_object_id + 1, 0);
+    m_body_indices[obj->id()] = static_cast<int>(m_objects.size());
     m_objects.push_back(obj);
 }
 
@@ -54,8 +72,17 @@ void
 Arena::run_physics(float elapsed)
 {
     m_elapsed += elapsed;
+    m_manifolds.clear_events();
     while (m_elapsed > m_settings.constraint.step_size) {
         for (const auto& o : m_objects) {
+            // Last step's integration changed the rotation, get the matrix
+            // ready before the collision strategy (and its threads) use it.
+            // Sleeping objects too, they may have been rotated the step they
+            // fell asleep, or by whoever owns them.
+            o->coordinate_space().update_matrix();
+            if (o->asleep()) {
+                continue;
+            }
             o->velocity() =
                 o->velocity() + (o->force() * o->inverse_mass()) * m_settings.constraint.step_size;
             o->angular_velocity() =
@@ -64,37 +91,78 @@ Arena::run_physics(float elapsed)
         }
 
         m_collision_strategy->find_contacts(m_objects, m_manifolds);
+        if (m_settings.constraint.allow_sleeping) {
+            build_islands();
+        }
 
-        if (m_settings.constraint.warm_start_scale > 0) {
-            for (auto& manifold : m_manifolds) {
-                manifold.second.scale_contact_impulses(m_settings.constraint.warm_start_scale);
-                m_constraint_solver.warm_start(manifold.second);
+        // The solvers work on the bodies, which are packed together in the same order as
+        // m_objects. The velocities are copied back to the objects once solving is done.
+        m_bodies.resize(m_objects.size());
+        for (size_t i = 0; i < m_objects.size(); ++i) {
+            m_bodies[i] = Constraint_solver::Body(*m_objects[i]);
+        }
+
+        // Sleeping manifolds aren't prepared or solved, and keep their impulses for when they
+        // wake up
+        m_constraint_solver.begin_step();
+        for (auto& manifold : m_manifolds) {
+            Physics_object& a = manifold.object_a();
+            Physics_object& b = manifold.object_b();
+            if (asleep(a, b)) {
+                continue;
+            }
+            const size_t prepared = m_constraint_solver.prepare(manifold, m_body_indices[a.id()],
+                                                                m_body_indices[b.id()]);
+            if (m_settings.constraint.warm_start_scale > 0) {
+                manifold.scale_contact_impulses(m_settings.constraint.warm_start_scale);
+                m_constraint_solver.warm_start(prepared, m_bodies);
+            }
+            else {
+                manifold.scale_contact_impulses(0);
             }
         }
-        else {
-            for (auto& manifold : m_manifolds) {
-                manifold.second.scale_contact_impulses(0);
+        if (m_settings.constraint.wide_solver) {
+            m_wide_solver.solve(m_constraint_solver, m_bodies, m_settings.constraint.iterations);
+        }
+        else if (m_settings.constraint.solver_threads > 1) {
+            // With only a few manifolds the threads spend longer waiting for each other
+            // than solving, so use fewer of them. The batches are the same either way.
+            batch_manifolds();
+            const unsigned int workers = static_cast<unsigned int>(
+                std::min<size_t>(m_solver_workers.size(),
+                                 std::max<size_t>(1, m_batched.size() / MIN_MANIFOLDS_PER_WORKER)));
+            std::atomic<unsigned int> finished(0);
+            if (workers == 1) {
+                solve_batches(0, 1, finished);
+            }
+            else {
+                auto job = [&](unsigned int worker) {
+                    if (worker < workers) {
+                        solve_batches(worker, workers, finished);
+                    }
+                };
+                m_solver_workers.run(job);
             }
         }
-        for (int i = 0; i < m_settings.constraint.iterations; ++i) {
-            for (auto& manifold : m_manifolds) {
-                m_constraint_solver.solve(manifold.second);
-
-                // There's a pretty important thing happening right here. I'm applying the velocity
-                // back to objects while I'm in the middle of solving constraints. This makes for a
-                // much more stable simulation, but you can't parallelize it. If I instead collect
-                // all of the delta velocity and then loop through and apply them later it can be
-                // multi-threaded.
-                manifold.second.object_a().velocity() += manifold.second.a_delta_velocity();
-                manifold.second.object_a().angular_velocity() +=
-                    manifold.second.a_delta_angular_velocity();
-                manifold.second.object_b().velocity() += manifold.second.b_delta_velocity();
-                manifold.second.object_b().angular_velocity() +=
-                    manifold.second.b_delta_angular_velocity();
+        else {
+            // There's a pretty important thing happening right here. Each manifold's velocities
+            // go straight back into the bodies while I'm in the middle of solving constraints.
+            // This makes for a much more stable simulation. It means two manifolds that share a
+            // moving object can't be solved at the same time, which is what the batches are for.
+            for (int i = 0; i < m_settings.constraint.iterations; ++i) {
+                for (size_t j = 0; j < m_constraint_solver.prepared_count(); ++j) {
+                    m_constraint_solver.solve(j, m_bodies);
+                }
             }
         }
 
-        for (const auto& o : m_objects) {
+        for (size_t i = 0; i < m_objects.size(); ++i) {
+            const auto& o = m_objects[i];
+            if (o->asleep()) {
+                continue;
+            }
+            o->velocity()         = m_bodies[i].velocity;
+            o->angular_velocity() = m_bodies[i].angular_velocity;
             o->coordinate_space().position() =
                 o->coordinate_space().position() + o->velocity() * m_settings.constraint.step_size;
             o->coordinate_space().rotation() =
@@ -103,9 +171,166 @@ Arena::run_physics(float elapsed)
                     m_settings.constraint.step_size;
         }
 
+        if (m_settings.constraint.allow_sleeping) {
+            sleep_islands();
+        }
+
         m_elapsed -= m_settings.constraint.step_size;
     }
 }
 
+// Greedy graph colouring. The objects are the nodes and the manifolds are
+// the edges, each manifold goes in the first batch that neither of its
+// moving objects is in yet. Only the manifolds prepared this step are
+// batched, and within a batch they stay in the order they were prepared.
+void
+Arena::batch_manifolds()
+{
+    const size_t count = m_constraint_solver.prepared_count();
+    m_object_batches.assign(m_next_object_id + 1, 0);
+    m_manifold_batches.clear();
+    m_batch_starts.assign(MAX_BATCHES + 2, 0);
+    for (size_t i = 0; i < count; ++i) {
+        Contact_manifold& manifold = *m_constraint_solver.prepared(i).manifold;
+        Physics_object&   a        = manifold.object_a();
+        Physics_object&   b        = manifold.object_b();
+        uint64_t          used     = 0;
+        if (a.inverse_mass() > 0) {
+            used |= m_object_batches[a.id()];
+        }
+        if (b.inverse_mass() > 0) {
+            used |= m_object_batches[b.id()];
+        }
+        int batch = 0;
+        while (batch < MAX_BATCHES && (used & (uint64_t(1) << batch))) {
+            ++batch;
+        }
+        if (batch < MAX_BATCHES) {
+            m_object_batches[a.id()] |= uint64_t(1) << batch;
+            m_object_batches[b.id()] |= uint64_t(1) << batch;
+        }
+        m_manifold_batches.push_back(batch);
+        ++m_batch_starts[batch + 1];
+    }
+    for (int i = 0; i <= MAX_BATCHES; ++i) {
+        m_batch_starts[i + 1] += m_batch_starts[i];
+    }
+
+    m_batched.resize(m_batch_starts.back());
+    size_t next[MAX_BATCHES + 1];
+    std::copy(m_batch_starts.begin(), m_batch_starts.end() - 1, next);
+    for (size_t i = 0; i < count; ++i) {
+        m_batched[next[m_manifold_batches[i]]++] = i;
+    }
+}
+
+// Every worker takes its share of each batch, then waits for the others to
+// finish before moving on to the next batch. finished counts how many
+// workers are done with a batch, so it goes up by the number of threads
+// for every batch.
+void
+Arena::solve_batches(unsigned int worker, unsigned int threads, std::atomic<unsigned int>& finished)
+{
+    unsigned int waiting_for = 0;
+    for (int i = 0; i < m_settings.constraint.iterations; ++i) {
+        for (int batch = 0; batch <= MAX_BATCHES; ++batch) {
+            size_t start = m_batch_starts[batch];
+            size_t end   = m_batch_starts[batch + 1];
+            if (start == end) {
+                continue;
+            }
+            if (batch < MAX_BATCHES) {
+                const size_t share = (end - start + threads - 1) / threads;
+                start              = std::min(end, start + share * worker);
+                end                = std::min(end, start + share);
+            }
+            else if (worker != 0) {
+                start = end;
+            }
+            for (size_t j = start; j < end; ++j) {
+                m_constraint_solver.solve(m_batched[j], m_bodies);
+            }
+            waiting_for += threads;
+            ++finished;
+            while (finished < waiting_for) {
+                std::this_thread::yield();
+            }
+        }
+    }
+}
+
+// Union find with path halving. Islands are only joined through moving
+// objects, a floor touching everything shouldn't make one huge island.
+int
+Arena::island(int id)
+{
+    while (m_island_parents[id] != id) {
+        m_island_parents[id] = m_island_parents[m_island_parents[id]];
+        id                   = m_island_parents[id];
+    }
+    return id;
+}
+
+void
+Arena::build_islands()
+{
+    m_island_parents.resize(m_next_object_id + 1);
+    for (const auto& o : m_objects) {
+        m_island_parents[o->id()] = o->id();
+    }
+    for (auto& manifold : m_manifolds) {
+        Physics_object& a = manifold.object_a();
+        Physics_object& b = manifold.object_b();
+        if (a.inverse_mass() > 0 && b.inverse_mass() > 0) {
+            m_island_parents[island(a.id())] = island(b.id());
+        }
+    }
+
+    // Anything awake in an island wakes up the whole island
+    m_island_flags.assign(m_next_object_id + 1, false);
+    for (const auto& o : m_objects) {
+        if (!o->at_rest()) {
+            m_island_flags[island(o->id())] = true;
+        }
+    }
+    for (const auto& o : m_objects) {
+        if (o->asleep() && m_island_flags[island(o->id())]) {
+            o->wake();
+        }
+    }
+}
+
+void
+Arena::sleep_islands()
+{
+    const Constraint_solver_settings& settings = m_settings.constraint;
+
+    const float linear  = settings.sleep_velocity * settings.sleep_velocity;
+    const float angular = settings.sleep_angular_velocity * settings.sleep_angular_velocity;
+
+    // Flag every island with something in it that isn't ready to sleep
+    m_island_flags.assign(m_next_object_id + 1, false);
+    for (const auto& o : m_objects) {
+        if (o->at_rest()) {
+            continue;
+        }
+        if (o->velocity().length_squared() < linear &&
+            o->angular_velocity().length_squared() < angular) {
+            ++o->resting_steps();
+        }
+        else {
+            o->resting_steps() = 0;
+        }
+        if (o->resting_steps() < settings.sleep_steps) {
+            m_island_flags[island(o->id())] = true;
+        }
+    }
+    for (const auto& o : m_objects) {
+        if (!o->at_rest() && !m_island_flags[island(o->id())]) {
+            o->sleep();
+        }
+    }
+}
+
 }  // namespace Physics
 }  // namespace Dubious
@@ -3,7 +3,12 @@
 
 #include "Collision_strategy.h"
 #include "Constraint_solver.h"
+#include "Constraint_solver_wide.h"
+#include "Pair_cache.h"
+#include "Worker_pool.h"
 
+#include <atomic>
+#include <cstdint>
 #include <vector>
 #include <memory>
 #include <map>
@@ -24,7 +29,14 @@ public:
     ///
     /// Settings specific to collision detection.
     struct Collision_solver_settings {
-        enum class Strategy { SINGLE_THREADED, MULTI_THREADED, OPENCL };
+        enum class Strategy {
+            SINGLE_THREADED,
+            MULTI_THREADED,
+            OPENCL,
+            SWEEP_AND_PRUNE,
+            AABB_TREE,
+            SPATIAL_HASH
+        };
 
         /// When a point is being added to the contact manifold it needs to be tested against
         /// existing points to see if it is new, or is already in the manifold. If the distance
@@ -33,17 +45,18 @@ public:
         /// as the old.
         float manifold_persistent_threshold = 0.05f;
 
-        /// When the manifold is pruned it will examine all existing contact points. If any of them
-        /// have moved too far since the last update (for example if the object is moving too fast)
-        /// they will be removed as they are probably no longer valid.
-        /// The movemenet threshold is the distance squared above which
+        /// When the manifold is pruned it will examine all existing contact points. If the point on
+        /// A and the point on B have slid too far apart along the contact surface (for example if
+        /// the objects are sliding or rolling over each other) they will be removed as they are
+        /// probably no longer valid. The movement threshold is the distance squared above which
         /// a contact has moved.
         float manifold_movement_threshold = 0.05f;
 
         /// When the collision solver tries to find contact points it can choose to just find one
         /// contact point per cycle (the deepest penetration) or it can try to find all contact
         /// points per cycle. Finding all results in a stabler simulation
-        /// but it costs more.
+        /// but it costs more. For models with faces it costs a lot less, the faces touching
+        /// are clipped against each other to find all of the points at once.
         bool greedy_manifold = false;
 
         /// After broad phase collision detection we create a vector of potentially colliding pairs.
@@ -60,10 +73,25 @@ public:
         /// work group
         unsigned int mt_collisions_work_group_size = 1000;
 
+        /// When using Collision_strategy_aabb_tree each object's box in the tree is made bigger
+        /// than the object by this much, so small movements don't require updating the tree.
+        float aabb_margin = 0.1f;
+
+        /// When using Collision_strategy_aabb_tree each object's box is also stretched in the
+        /// direction the object is moving. It covers this many time steps worth of travel.
+        float aabb_velocity_multiplier = 2.0f;
+
+        /// When using Collision_strategy_spatial_hash this is the length of the side of each grid
+        /// cell. It should be a bit bigger than the diameter of a typical object.
+        float grid_cell_size = 2.5f;
+
         /// Which collision strategy should be used:
         /// SINGLE_THREADED -> Collision_strategy_simple
         /// MULTI_THREADED  -> Collision_strategy_multithreaded
         /// OPENCL          -> Collision_strategy_open_cl
+        /// SWEEP_AND_PRUNE -> Collision_strategy_sweep_and_prune
+        /// AABB_TREE       -> Collision_strategy_aabb_tree
+        /// SPATIAL_HASH    -> Collision_strategy_spatial_hash
         Strategy strategy = Strategy::SINGLE_THREADED;
     };
 
@@ -98,6 +126,34 @@ public:
         /// Warm starting is when we apply some percentage of the previous physics run's force as a
         /// first guess to the current run. This amount is the scaling factor, 1.0 = 100%
         float warm_start_scale = 0.5f;
+
+        /// How many threads solve the constraints. With more than 1 the manifolds are split into
+        /// batches where no two manifolds in a batch share a moving object. Each batch is solved in
+        /// parallel, and the velocities are still applied as soon as each manifold is solved, so
+        /// it's just as stable. The manifolds get solved in a different order than with 1 thread,
+        /// but that order doesn't depend on how many threads there are.
+        unsigned int solver_threads = 1;
+
+        /// Solve the contacts 4 at a time with SSE instead of one manifold at a time, see
+        /// Constraint_solver_wide. This is a lot quicker for big piles of contacts. It only uses
+        /// one thread, solver_threads is ignored.
+        bool wide_solver = false;
+
+        /// Objects that have come to rest can be put to sleep. Every step the objects are split
+        /// into islands of objects that are touching each other (stationary objects don't join
+        /// islands together). When every object in an island has been slower than the sleep
+        /// velocities for sleep_steps steps in a row the whole island goes to sleep. Sleeping
+        /// objects aren't moved, collided or solved until something awake touches their island.
+        bool allow_sleeping = false;
+
+        /// Linear speed, in m/s, below which an object is slow enough to sleep
+        float sleep_velocity = 0.1f;
+
+        /// Angular speed, in radians/s, below which an object is slow enough to sleep
+        float sleep_angular_velocity = 0.1f;
+
+        /// How many steps in a row an island has to be slow before it goes to sleep
+        int sleep_steps = 30;
     };
 
     /// @brief Physics settings
@@ -139,16 +195,30 @@ public:
 
     /// @brief Manifold accessor
     ///
-    /// Not sure if this is useful in any situation EXCEPT the one in which I'm trying to debug by
-    /// drawing the contacts
-    const std::map<std::tuple<int, int>, Contact_manifold>& manifolds() const
-    {
-        return m_manifolds;
-    }
+    /// Iterating this gives every Contact_manifold, which is handy when drawing the contacts to
+    /// debug. It also holds the pairs that began and ended colliding during the last call to
+    /// run_physics, so game code can react to things starting or stopping touching.
+    const Pair_cache& manifolds() const { return m_manifolds; }
 
 private:
+    // Manifolds that don't fit into one of these many batches go into
+    // one more batch at the end that is solved on a single thread
+    static const int MAX_BATCHES = 64;
+
+    // Each solver thread needs at least this many manifolds to be worth
+    // waiting for at the end of every batch
+    static const size_t MIN_MANIFOLDS_PER_WORKER = 64;
+
+    void batch_manifolds();
+    void solve_batches(unsigned int worker, unsigned int threads,
+                       std::atomic<unsigned int>& finished);
+    void build_islands();
+    void sleep_islands();
+    int  island(int id);
+
     std::unique_ptr<Collision_strategy> m_collision_strategy;
     Constraint_solver                   m_constraint_solver;
+    Constraint_solver_wide              m_wide_solver;
     float                               m_elapsed = 0.0f;
     const Settings                      m_settings;
     int                                 m_next_object_id = 1;
@@ -160,8 +230,29 @@ private:
     // The Physics_object::id() is used as a key into the manifolds. I was using the objects'
     // pointer, but that meant that the order of the manifolds would change for each run, meaning I
     // couldn't get reproducible test cases.
-    std::vector<std::shared_ptr<Physics_object>>     m_objects;
-    std::map<std::tuple<int, int>, Contact_manifold> m_manifolds;
+    std::vector<std::shared_ptr<Physics_object>> m_objects;
+    Pair_cache                                   m_manifolds;
+
+    // What the constraint solvers work on, one body for each of m_objects in the same order.
+    // m_body_indices is where each object's body is, indexed by the object's id.
+    std::vector<Constraint_solver::Body> m_bodies;
+    std::vector<int>                     m_body_indices;
+
+    // Scratch space for solving on more than one thread. m_batched holds
+    // the indices of the prepared manifolds batch after batch, m_batch_starts
+    // is where each batch begins. m_object_batches has a bit for every batch
+    // an object is in, indexed by the object's id.
+    std::vector<size_t>   m_batched;
+    std::vector<size_t>   m_batch_starts;
+    std::vector<int>      m_manifold_batches;
+    std::vector<uint64_t> m_object_batches;
+    Worker_pool           m_solver_workers;
+
+    // Scratch space for the islands. m_island_parents is a union find
+    // forest indexed by object id. m_island_flags holds a flag for each
+    // island, indexed by the id of the object at its root.
+    std::vector<int>  m_island_parents;
+    std::vector<char> m_island_flags;
 };
 
 }  // namespace Physics
@@ -6,7 +6,13 @@
 #include "Minkowski_polytope.h"
 
 #include <Vector_math.h>
+#include <Coordinate_space.h>
+#include <Rotation_matrix.h>
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
 #include <vector>
 #include <list>
 #include <tuple>
@@ -14,26 +20,76 @@
 namespace Dubious {
 namespace Physics {
 
-Collision_solver::Collision_solver(bool greedy_manifold) : m_greedy_manifold(greedy_manifold)
-{
-}
-
 namespace {
 
-Math::Local_vector
-support(const Physics_model& model, const Math::Local_vector& direction)
-{
-    Math::Local_vector result;
-    float              max_dot = std::numeric_limits<float>::lowest();
-    for (const auto& v : model.vectors()) {
-        float dot = Math::dot_product(v, direction);
-        if (dot > max_dot) {
-            max_dot = dot;
-            result  = v;
-        }
+// GJK and EPA work in a's local space rather than world space. a's vertices
+// can be used just as they are, and b's only need one rotation and offset to
+// get there, worked out once for the pair. In world space every support
+// point on both models would be rotated into local space and back. Only the
+// final contact points go back out to world space. It also keeps the
+// numbers small when the objects are far away from the world origin.
+//
+// Points and directions in this space are Math::Vectors, the same as the
+// world space ones they replace.
+class Relative_frame {
+public:
+    Relative_frame(const Math::Coordinate_space& ca, const Math::Coordinate_space& cb)
+        : m_ca(ca)
+        , m_rotation(ca.rotation().conjugate() * cb.rotation())
+        , m_offset(to_frame(ca.transform(cb.position() - ca.position())))
+    {
+    }
+
+    Math::Vector vertex_a(const Math::Local_vector& v) const { return to_frame(v); }
+    Math::Vector vertex_b(const Math::Local_vector& v) const
+    {
+        return m_rotation.transform(v) + m_offset;
+    }
+
+    Math::Vector support_a(const Physics_model& a, const Math::Vector& direction, int& hint) const
+    {
+        return vertex_a(a.support(Math::Local_vector(direction.x(), direction.y(), direction.z()),
+                                  hint));
+    }
+    Math::Vector support_b(const Physics_model& b, const Math::Vector& direction, int& hint) const
+    {
+        return vertex_b(b.support(m_rotation.transform(direction), hint));
+    }
+
+    Math::Vector world_vector(const Math::Vector& v) const
+    {
+        return m_ca.transform(Math::Local_vector(v.x(), v.y(), v.z()));
+    }
+    Math::Point world_point(const Math::Vector& p) const
+    {
+        return m_ca.transform(Math::Local_point(p.x(), p.y(), p.z()));
+    }
+    Math::Vector direction_a(const Math::Local_vector& v) const { return to_frame(v); }
+    Math::Vector direction_b(const Math::Local_vector& v) const
+    {
+        return m_rotation.transform(v);
+    }
+    Math::Vector frame_vector(const Math::Vector& v) const { return to_frame(m_ca.transform(v)); }
+
+    Math::Local_point local_point_a(const Math::Vector& p) const
+    {
+        return Math::Local_point(p.x(), p.y(), p.z());
+    }
+    Math::Local_point local_point_b(const Math::Vector& p) const
+    {
+        return Math::to_point(m_rotation.transform(p - m_offset));
     }
-    return result;
-}
+
+private:
+    static Math::Vector to_frame(const Math::Local_vector& v)
+    {
+        return Math::Vector(v.x(), v.y(), v.z());
+    }
+
+    const Math::Coordinate_space& m_ca;
+    Math::Rotation_matrix         m_rotation;  // b's local space to a's
+    Math::Vector                  m_offset;    // b's origin in a's local space
+};
 
 // This function is used to check the top level models a and b.
 // The children of these models are not tested at this level.
@@ -42,19 +98,17 @@ support(const Physics_model& model, const Math::Local_vector& direction)
 // collision point and normal.
 // Children of models a and b are tested in other functions
 bool
-model_intersection(const Physics_model& a, const Math::Coordinate_space& ca, const Physics_model& b,
-                   const Math::Coordinate_space& cb, const Math::Vector& start_direction,
-                   Minkowski_simplex& simplex)
+model_intersection(const Physics_model& a, const Physics_model& b, const Relative_frame& frame,
+                   const Math::Vector& start_direction, Minkowski_simplex& simplex, int& hint_a,
+                   int& hint_b)
 {
     if (a.vectors().empty() || b.vectors().empty()) {
         return false;
     }
 
     Math::Vector direction = start_direction;
-    Math::Vector support_a =
-        ca.transform(support(a, ca.transform(direction))) + (Math::to_vector(ca.position()));
-    Math::Vector support_b =
-        cb.transform(support(b, cb.transform(direction * -1))) + (Math::to_vector(cb.position()));
+    Math::Vector support_a     = frame.support_a(a, direction, hint_a);
+    Math::Vector support_b     = frame.support_b(b, direction * -1, hint_b);
     Math::Vector support_point = support_a - support_b;
     if (support_point == Math::Vector()) {
         // If we go as far as possible in one direction and we are exactly at the origin, then
@@ -62,7 +116,8 @@ model_intersection(const Physics_model& a, const Math::Coordinate_space& ca, con
         // touching contact is not a collision
         return false;
     }
-    simplex   = Minkowski_simplex(Minkowski_vector(support_point, support_a, support_b));
+    simplex =
+        Minkowski_simplex(Minkowski_vector(support_point, support_a, support_b, hint_a, hint_b));
     direction = support_point * -1;
 
     // In a perfect world this would be an infinite loop. However in reality, we can get
@@ -70,10 +125,8 @@ model_intersection(const Physics_model& a, const Math::Coordinate_space& ca, con
     // converge on a solution in 20 steps then just give up
     int i = 0;
     for (i = 0; i < 20; ++i) {
-        support_a =
-            ca.transform(support(a, ca.transform(direction))) + (Math::to_vector(ca.position()));
-        support_b = cb.transform(support(b, cb.transform(direction * -1))) +
-                    (Math::to_vector(cb.position()));
+        support_a     = frame.support_a(a, direction, hint_a);
+        support_b     = frame.support_b(b, direction * -1, hint_b);
         support_point = support_a - support_b;
         // If this next check is < 0 then touching will be considered a collision. If it's
         // <= 0 then touching will not be a collision. For EPA to work, our GJK must exit with a
@@ -93,7 +146,7 @@ model_intersection(const Physics_model& a, const Math::Coordinate_space& ca, con
         if (Math::dot_product(support_point, direction) <= 0.0000001) {
             return false;
         }
-        simplex.push_back(Minkowski_vector(support_point, support_a, support_b));
+        simplex.push_back(Minkowski_vector(support_point, support_a, support_b, hint_a, hint_b));
         bool collision_found;
         std::tie(collision_found, direction) = simplex.build();
         if (collision_found) {
@@ -107,6 +160,56 @@ model_intersection(const Physics_model& a, const Math::Coordinate_space& ca, con
     return false;
 }
 
+// Rebuild the tetrahedron GJK finished with last step, using the same model
+// vertices where they are now. If it still holds the origin then the objects
+// are still colliding and this is a perfectly good simplex to hand to EPA.
+// Otherwise GJK has to start over.
+bool
+warm_start(const Physics_model& a, const Physics_model& b, const Relative_frame& frame,
+           const Collision_solver::Pair_state::Simplex& cached, Minkowski_simplex& simplex)
+{
+    if (cached.size != 4) {
+        return false;
+    }
+    Minkowski_vector v[4];
+    for (int i = 0; i < 4; ++i) {
+        const int index_a = cached.index_a[i];
+        const int index_b = cached.index_b[i];
+        if (index_a >= static_cast<int>(a.vectors().size()) ||
+            index_b >= static_cast<int>(b.vectors().size())) {
+            return false;
+        }
+        Math::Vector support_a = frame.vertex_a(a.vectors()[index_a]);
+        Math::Vector support_b = frame.vertex_b(b.vectors()[index_b]);
+        v[i] = Minkowski_vector(support_a - support_b, support_a, support_b, index_a, index_b);
+    }
+
+    // Same winding as Minkowski_simplex::build_4 leaves it in. v[3] is on top
+    // of the triangle made by the other three, and that triangle is wound
+    // counter clockwise when seen from v[3].
+    if (Math::dot_product(Math::cross_product(v[0].v() - v[2].v(), v[1].v() - v[2].v()),
+                          v[3].v() - v[2].v()) > 0) {
+        std::swap(v[1], v[2]);
+    }
+
+    // The origin needs to be properly inside every face, the same as GJK
+    // insists on, or EPA can end up with a flat polytope
+    const int faces[4][3] = {{3, 2, 1}, {3, 1, 0}, {3, 0, 2}, {2, 0, 1}};
+    for (const auto& face : faces) {
+        const Math::Vector& p      = v[face[0]].v();
+        const Math::Vector  normal = Math::cross_product(v[face[1]].v() - p, v[face[2]].v() - p);
+        const float         length = normal.length();
+        if (length <= 0.0000001f || Math::dot_product(normal, p) <= 0.0000001f * length) {
+            return false;
+        }
+    }
+    simplex = Minkowski_simplex();
+    for (const auto& vector : v) {
+        simplex.push_back(vector);
+    }
+    return true;
+}
+
 // Taken from http://hacktank.net/blog/?p=119 , which was apparently
 // taken from Crister Erickson's Real-Time Collision Detection
 std::tuple<float, float, float>
@@ -128,11 +231,25 @@ barycentric(const Math::Vector& p, const Math::Vector& a, const Math::Vector& b,
     return std::make_tuple(u, v, w);
 }
 
+// Fill in the contact's tangents from its normal
+// http://box2d.org/2014/02/computing-a-basis/
+void
+set_tangents(Contact_manifold::Contact& contact)
+{
+    if (fabs(contact.normal.x()) >= 0.57735f) {
+        contact.tangent1 = Math::Vector(contact.normal.y(), -contact.normal.x(), 0.0f);
+    }
+    else {
+        contact.tangent1 = Math::Vector(0.0f, contact.normal.z(), -contact.normal.y());
+    }
+    contact.tangent2 = Math::cross_product(contact.normal, contact.tangent1);
+}
+
 // Perform EPA to find the point of collision
 void
-find_collision_point(const Physics_model& a, const Math::Coordinate_space& ca,
-                     const Physics_model& b, const Math::Coordinate_space& cb,
-                     const Minkowski_simplex& simplex, Contact_manifold::Contact& contact)
+find_collision_point(const Physics_model& a, const Physics_model& b, const Relative_frame& frame,
+                     const Minkowski_simplex& simplex, Contact_manifold::Contact& contact,
+                     int& hint_a, int& hint_b)
 {
     Minkowski_polytope polytope(simplex);
     // In a perfect world, this would always break out when the collision
@@ -142,69 +259,320 @@ find_collision_point(const Physics_model& a, const Math::Coordinate_space& ca,
         Minkowski_polytope::Triangle triangle;
         std::tie(triangle, min_distance) = polytope.find_closest_triangle();
         Math::Vector direction(triangle.normal);
-        Math::Vector support_a =
-            ca.transform(support(a, ca.transform(direction))) + (Math::to_vector(ca.position()));
-        Math::Vector support_b = cb.transform(support(b, cb.transform(direction * -1))) +
-                                 (Math::to_vector(cb.position()));
+        Math::Vector support_a     = frame.support_a(a, direction, hint_a);
+        Math::Vector support_b     = frame.support_b(b, direction * -1, hint_b);
         Math::Vector support_point = support_a - support_b;
         if (Math::dot_product(support_point, Math::Vector(triangle.normal)) <=
             min_distance + 0.001f) {
-            contact.normal = triangle.normal;
-            // http://box2d.org/2014/02/computing-a-basis/
-            if (fabs(contact.normal.x()) >= 0.57735f) {
-                contact.tangent1 = Math::Vector(contact.normal.y(), -contact.normal.x(), 0.0f);
-            }
-            else {
-                contact.tangent1 = Math::Vector(0.0f, contact.normal.z(), -contact.normal.y());
-            }
-            contact.tangent2          = Math::cross_product(contact.normal, contact.tangent1);
+            contact.normal = Math::Unit_vector(frame.world_vector(Math::Vector(triangle.normal)));
+            set_tangents(contact);
             contact.penetration_depth = min_distance;
             Math::Point contact_point =
                 Math::to_point(Math::Vector(triangle.normal) * min_distance);
             float u, v, w;
             std::tie(u, v, w) = barycentric(Math::to_vector(contact_point), triangle.a.v(),
                                             triangle.b.v(), triangle.c.v());
-            contact_point = Math::to_point(triangle.a.support_a() * u + triangle.b.support_a() * v +
-                                           triangle.c.support_a() * w);
-            contact.contact_point_a = contact_point;
-            contact.local_point_a   = ca.transform(contact_point);
-            contact_point = Math::to_point(triangle.a.support_b() * u + triangle.b.support_b() * v +
-                                           triangle.c.support_b() * w);
-            contact.contact_point_b = contact_point;
-            contact.local_point_b   = cb.transform(contact_point);
+            Math::Vector point_a = triangle.a.support_a() * u + triangle.b.support_a() * v +
+                                   triangle.c.support_a() * w;
+            contact.contact_point_a = frame.world_point(point_a);
+            contact.local_point_a   = frame.local_point_a(point_a);
+            Math::Vector point_b = triangle.a.support_b() * u + triangle.b.support_b() * v +
+                                   triangle.c.support_b() * w;
+            contact.contact_point_b = frame.world_point(point_b);
+            contact.local_point_b   = frame.local_point_b(point_b);
             return;
         }
         polytope.push_back(Minkowski_vector(support_point, support_a, support_b));
     }
 }
 
+// Whether two bounding spheres touch. Each is in its own model's space.
+bool
+bounds_overlap(const Physics_model::Bounds& a, const Math::Coordinate_space& ca,
+               const Physics_model::Bounds& b, const Math::Coordinate_space& cb)
+{
+    if (a.radius < 0 || b.radius < 0) {
+        return false;
+    }
+    const Math::Vector center_a = ca.transform(a.center) + Math::to_vector(ca.position());
+    const Math::Vector center_b = cb.transform(b.center) + Math::to_vector(cb.position());
+    const float        radius   = a.radius + b.radius;
+    return (center_b - center_a).length_squared() <= radius * radius;
+}
+
+// If GJK didn't run then there's nothing to warm start from next time
+void
+forget_simplex(Collision_solver::Pair_state* state)
+{
+    if (state) {
+        for (auto& simplex : state->simplex) {
+            simplex.size = 0;
+        }
+    }
+}
+
+// One pass of Sutherland-Hodgman. Keeps the part of the polygon where
+// dot(normal, p) <= offset. Each pass can add at most one point, so out
+// needs room for count + 1.
+int
+clip(const Math::Vector* in, int count, const Math::Vector& normal, float offset,
+     Math::Vector* out)
+{
+    int out_count = 0;
+    for (int i = 0; i < count; ++i) {
+        const Math::Vector& p        = in[i];
+        const Math::Vector& q        = in[(i + 1) % count];
+        const float         p_offset = Math::dot_product(normal, p) - offset;
+        const float         q_offset = Math::dot_product(normal, q) - offset;
+        if (p_offset <= 0) {
+            out[out_count++] = p;
+        }
+        if ((p_offset < 0 && q_offset > 0) || (p_offset > 0 && q_offset < 0)) {
+            out[out_count++] = p + (q - p) * (p_offset / (p_offset - q_offset));
+        }
+    }
+    return out_count;
+}
+
+// Keep at most 4 of the points, the ones that cover the most area: the
+// deepest, the one furthest from it, and then the ones that make the biggest
+// triangle with those two on either side of the line between them. The
+// points are in a plane with the given normal. Returns the new count.
+int
+keep_four(Math::Vector* points, float* depths, int count, const Math::Vector& normal)
+{
+    if (count <= 4) {
+        return count;
+    }
+    auto keep = [&](int kept, int index) {
+        std::swap(points[kept], points[index]);
+        std::swap(depths[kept], depths[index]);
+    };
+    int best = 0;
+    for (int i = 1; i < count; ++i) {
+        if (depths[i] > depths[best]) {
+            best = i;
+        }
+    }
+    keep(0, best);
+    best = 1;
+    for (int i = 2; i < count; ++i) {
+        if ((points[i] - points[0]).length_squared() >
+            (points[best] - points[0]).length_squared()) {
+            best = i;
+        }
+    }
+    keep(1, best);
+    auto area = [&](int index) {
+        return Math::dot_product(
+            Math::cross_product(points[1] - points[0], points[index] - points[0]), normal);
+    };
+    int most  = 2;
+    int least = 2;
+    for (int i = 3; i < count; ++i) {
+        most  = area(i) > area(most) ? i : most;
+        least = area(i) < area(least) ? i : least;
+    }
+    keep(2, most);
+    if (least == 2) {
+        least = most;
+    }
+    keep(3, least);
+    return 4;
+}
+
+// The full manifold for two hulls that have faces, once EPA has found the
+// normal (in the frame's space). Of a's face that points most along the
+// normal and b's that points most against it, the one that lines up better
+// is the reference face. The face on the other hull pointing most against
+// that is the incident face. Just like the box collider, the incident face
+// is clipped to the sides of the reference face and every corner that's
+// left under the reference face is a contact, or the best 4 of them if
+// there are more.
+//
+// If the normal isn't close to any face then it's an edge against an edge,
+// and the one point EPA found is all there is. This returns false then, and
+// whenever there's nothing left after clipping.
+const int MAX_CLIP_VERTICES = 64;
+
+bool
+hull_face_contacts(const Physics_model& a, const Physics_model& b, const Relative_frame& frame,
+                   const Math::Vector& normal, std::vector<Contact_manifold::Contact>& contacts)
+{
+    int   face_a  = 0;
+    int   face_b  = 0;
+    float align_a = -2;
+    float align_b = -2;
+    for (int i = 0; i < static_cast<int>(a.faces().size()); ++i) {
+        const float align = Math::dot_product(frame.direction_a(a.faces()[i].normal), normal);
+        if (align > align_a) {
+            align_a = align;
+            face_a  = i;
+        }
+    }
+    for (int i = 0; i < static_cast<int>(b.faces().size()); ++i) {
+        const float align = -Math::dot_product(frame.direction_b(b.faces()[i].normal), normal);
+        if (align > align_b) {
+            align_b = align;
+            face_b  = i;
+        }
+    }
+    if (std::max(align_a, align_b) < 0.95f) {
+        return false;
+    }
+
+    // a's face is preferred, so that the manifold doesn't flip back and forth
+    // between steps when there's not much in it
+    const bool           reference_is_a = align_a + 0.01f >= align_b;
+    const Physics_model& reference      = reference_is_a ? a : b;
+    const Physics_model& incident       = reference_is_a ? b : a;
+    auto                 reference_vertex = [&](int index) {
+        const Math::Local_vector& v = reference.vectors()[reference.face_vertices()[index]];
+        return reference_is_a ? frame.vertex_a(v) : frame.vertex_b(v);
+    };
+    auto incident_vertex = [&](int index) {
+        const Math::Local_vector& v = incident.vectors()[incident.face_vertices()[index]];
+        return reference_is_a ? frame.vertex_b(v) : frame.vertex_a(v);
+    };
+    auto incident_direction = [&](const Math::Local_vector& v) {
+        return reference_is_a ? frame.direction_b(v) : frame.direction_a(v);
+    };
+    const Physics_model::Face& reference_face =
+        reference.faces()[reference_is_a ? face_a : face_b];
+    const Math::Vector face_normal = reference_is_a ? frame.direction_a(reference_face.normal)
+                                                    : frame.direction_b(reference_face.normal);
+    const float face_offset =
+        Math::dot_product(face_normal, reference_vertex(reference_face.first));
+
+    int   incident_index = 0;
+    float most_against   = 2;
+    for (int i = 0; i < static_cast<int>(incident.faces().size()); ++i) {
+        const float dot =
+            Math::dot_product(incident_direction(incident.faces()[i].normal), face_normal);
+        if (dot < most_against) {
+            most_against   = dot;
+            incident_index = i;
+        }
+    }
+    const Physics_model::Face& incident_face = incident.faces()[incident_index];
+    if (incident_face.count + reference_face.count > MAX_CLIP_VERTICES) {
+        return false;
+    }
+
+    Math::Vector buffers[2][MAX_CLIP_VERTICES];
+    Math::Vector* polygon = buffers[0];
+    Math::Vector* clipped = buffers[1];
+    int           count   = incident_face.count;
+    for (int i = 0; i < count; ++i) {
+        polygon[i] = incident_vertex(incident_face.first + i);
+    }
+    // The faces are counter clockwise from outside, so edge cross normal
+    // points out of the reference face's side
+    for (int i = 0; i < reference_face.count && count > 0; ++i) {
+        const Math::Vector p    = reference_vertex(reference_face.first + i);
+        const Math::Vector q    = reference_vertex(reference_face.first +
+                                                (i + 1) % reference_face.count);
+        const Math::Vector side = Math::cross_product(q - p, face_normal);
+        count = clip(polygon, count, side, Math::dot_product(side, p), clipped);
+        std::swap(polygon, clipped);
+    }
+
+    float depths[MAX_CLIP_VERTICES];
+    int   under = 0;
+    for (int i = 0; i < count; ++i) {
+        const float depth = face_offset - Math::dot_product(face_normal, polygon[i]);
+        if (depth >= 0) {
+            polygon[under]  = polygon[i];
+            depths[under++] = depth;
+        }
+    }
+    count = keep_four(polygon, depths, under, face_normal);
+
+    const Math::Vector contact_normal = reference_is_a ? face_normal : face_normal * -1;
+    for (int i = 0; i < count; ++i) {
+        // The incident point is inside the reference hull, push it back out
+        // to the reference face to get the point on the reference hull
+        const float               depth        = depths[i];
+        const Math::Vector        on_reference = polygon[i] + face_normal * depth;
+        const Math::Vector&       point_a      = reference_is_a ? on_reference : polygon[i];
+        const Math::Vector&       point_b      = reference_is_a ? polygon[i] : on_reference;
+        Contact_manifold::Contact contact;
+        contact.normal            = Math::Unit_vector(frame.world_vector(contact_normal));
+        contact.penetration_depth = depth;
+        contact.contact_point_a   = frame.world_point(point_a);
+        contact.local_point_a     = frame.local_point_a(point_a);
+        contact.contact_point_b   = frame.world_point(point_b);
+        contact.local_point_b     = frame.local_point_b(point_b);
+        set_tangents(contact);
+        contacts.push_back(contact);
+    }
+    return count > 0;
+}
+
+// a against b and all of b's kids. The kids' bounds are a tree, so a whole
+// branch of b can be skipped if its tree_bounds are too far from a.
+// The state is only passed in for the top level models, the kids get nullptr
 bool
 intersection_recurse_b(const Physics_model& a, const Math::Coordinate_space& ca,
                        const Physics_model& b, const Math::Coordinate_space& cb,
-                       bool greedy_manifold, std::vector<Contact_manifold::Contact>& contacts)
+                       const Relative_frame& frame, bool greedy_manifold,
+                       std::vector<Contact_manifold::Contact>& contacts,
+                       Collision_solver::Pair_state*           state)
 {
-    bool                ret_val       = false;
-    static Math::Vector directions[6] = {
+    if (!bounds_overlap(a.bounds(), ca, b.tree_bounds(), cb)) {
+        forget_simplex(state);
+        return false;
+    }
+
+    bool                ret_val                                  = false;
+    static Math::Vector directions[Collision_solver::DIRECTIONS] = {
         Math::Vector(1, 0, 0),  Math::Vector(-1, 0, 0), Math::Vector(0, 1, 0),
         Math::Vector(0, -1, 0), Math::Vector(0, 0, 1),  Math::Vector(0, 0, -1),
     };
 
-    for (const auto& d : directions) {
+    // With faces on both sides one EPA normal is enough to clip out the
+    // whole manifold, the other directions are only needed without them
+    const bool clip_faces = greedy_manifold && !a.faces().empty() && !b.faces().empty();
+
+    // b's tree is close enough, but b itself might not be
+    const bool near = bounds_overlap(a.bounds(), ca, b.bounds(), cb);
+    if (!near) {
+        forget_simplex(state);
+    }
+    for (int i = 0; near && i < Collision_solver::DIRECTIONS; ++i) {
+        int               scratch_a = 0;
+        int               scratch_b = 0;
+        int&              hint_a    = state ? state->support_a[i] : scratch_a;
+        int&              hint_b    = state ? state->support_b[i] : scratch_b;
         Minkowski_simplex simplex;
-        bool              found = model_intersection(a, ca, b, cb, d, simplex);
+        bool              found =
+            (state && warm_start(a, b, frame, state->simplex[i], simplex)) ||
+            model_intersection(a, b, frame, directions[i], simplex, hint_a, hint_b);
+        if (state) {
+            Collision_solver::Pair_state::Simplex& cached = state->simplex[i];
+            cached.size                                   = found ? 4 : 0;
+            for (int j = 0; j < cached.size; ++j) {
+                cached.index_a[j] = simplex.v()[j].index_a();
+                cached.index_b[j] = simplex.v()[j].index_b();
+            }
+        }
         if (found) {
             Contact_manifold::Contact contact;
-            find_collision_point(a, ca, b, cb, simplex, contact);
-            contacts.push_back(contact);
+            find_collision_point(a, b, frame, simplex, contact, hint_a, hint_b);
+            if (!clip_faces || !hull_face_contacts(a, b, frame,
+                                                   frame.frame_vector(Math::Vector(contact.normal)),
+                                                   contacts)) {
+                contacts.push_back(contact);
+            }
             ret_val = true;
         }
-        if (!greedy_manifold) {
+        if (!greedy_manifold || clip_faces) {
             break;
         }
     }
 
     for (const auto& kid : b.kids()) {
-        if (intersection_recurse_b(a, ca, *kid, cb, greedy_manifold, contacts)) {
+        if (intersection_recurse_b(a, ca, *kid, cb, frame, greedy_manifold, contacts, nullptr)) {
             ret_val = true;
         }
     }
@@ -215,14 +583,21 @@ intersection_recurse_b(const Physics_model& a, const Math::Coordinate_space& ca,
 bool
 intersection_recurse_a(const Physics_model& a, const Math::Coordinate_space& ca,
                        const Physics_model& b, const Math::Coordinate_space& cb,
-                       bool greedy_manifold, std::vector<Contact_manifold::Contact>& contacts)
+                       const Relative_frame& frame, bool greedy_manifold,
+                       std::vector<Contact_manifold::Contact>& contacts,
+                       Collision_solver::Pair_state*           state)
 {
+    if (!bounds_overlap(a.tree_bounds(), ca, b.tree_bounds(), cb)) {
+        forget_simplex(state);
+        return false;
+    }
+
     bool ret_val = false;
-    if (intersection_recurse_b(a, ca, b, cb, greedy_manifold, contacts)) {
+    if (intersection_recurse_b(a, ca, b, cb, frame, greedy_manifold, contacts, state)) {
         ret_val = true;
     }
     for (const auto& kid : a.kids()) {
-        if (intersection_recurse_a(*kid, ca, b, cb, greedy_manifold, contacts)) {
+        if (intersection_recurse_a(*kid, ca, b, cb, frame, greedy_manifold, contacts, nullptr)) {
             ret_val = true;
         }
     }
@@ -230,8 +605,714 @@ intersection_recurse_a(const Physics_model& a, const Math::Coordinate_space& ca,
     return ret_val;
 }
 
+// Box against box, with the separating axis test
+// http://www.randygaul.net/2014/05/22/deriving-obb-to-obb-intersection-sat/
+// http://media.steampowered.com/apps/valve/2015/DirkGregorius_Contacts.pdf
+// Two boxes are apart if there's some axis where their shadows don't overlap.
+// There are only 15 axes worth checking: the 3 face normals of each box and
+// the cross products of each pair of edges. If they all overlap then the
+// boxes intersect, and the axis with the least overlap is the contact normal.
+//
+// If that axis is a face normal, the face of the other box that points most
+// against it (the incident face) is clipped to the sides of the reference
+// face, and every corner of what's left that's under the reference face is a
+// contact. This gives the whole manifold in one go, rather than the one
+// point at a time that EPA finds. If the axis is an edge pair then there's a
+// single contact between the closest points of the two edges.
+struct Box {
+    Math::Vector                center;
+    std::array<Math::Vector, 3> axes;
+    std::array<float, 3>        half_extents;
+};
+
+Box
+make_box(const Physics_model& model, const Math::Coordinate_space& space)
+{
+    Box box;
+    box.center          = Math::to_vector(space.position());
+    box.axes[0]         = space.transform(Math::Local_vector(1, 0, 0));
+    box.axes[1]         = space.transform(Math::Local_vector(0, 1, 0));
+    box.axes[2]         = space.transform(Math::Local_vector(0, 0, 1));
+    box.half_extents[0] = model.half_extents().x();
+    box.half_extents[1] = model.half_extents().y();
+    box.half_extents[2] = model.half_extents().z();
+    return box;
+}
+
+// Half the length of the box's shadow on the axis
+float
+projected_radius(const Box& box, const Math::Vector& axis)
+{
+    return std::abs(Math::dot_product(box.axes[0], axis)) * box.half_extents[0] +
+           std::abs(Math::dot_product(box.axes[1], axis)) * box.half_extents[1] +
+           std::abs(Math::dot_product(box.axes[2], axis)) * box.half_extents[2];
+}
+
+// reference_is_a says which box owns the face. normal always points from a
+// to b, the reference face is the one facing the other box.
+void
+box_face_contacts(const Box& reference, const Box& incident, int axis, bool reference_is_a,
+                  const Math::Vector& normal, const Math::Coordinate_space& ca,
+                  const Math::Coordinate_space&           cb,
+                  std::vector<Contact_manifold::Contact>& contacts)
+{
+    const Math::Vector face_normal = reference_is_a ? normal : normal * -1;
+    const Math::Vector face_center =
+        reference.center + face_normal * reference.half_extents[axis];
+    const float face_offset = Math::dot_product(face_normal, face_center);
+
+    // The incident face is the one pointing most against the reference face
+    int   incident_axis = 0;
+    float most_against  = 0;
+    for (int i = 0; i < 3; ++i) {
+        const float dot = Math::dot_product(incident.axes[i], face_normal);
+        if (std::abs(dot) > std::abs(most_against)) {
+            most_against  = dot;
+            incident_axis = i;
+        }
+    }
+    const int          u      = (incident_axis + 1) % 3;
+    const int          v      = (incident_axis + 2) % 3;
+    const Math::Vector u_edge = incident.axes[u] * incident.half_extents[u];
+    const Math::Vector v_edge = incident.axes[v] * incident.half_extents[v];
+    const float        side   = most_against > 0 ? -incident.half_extents[incident_axis]
+                                                 : incident.half_extents[incident_axis];
+    const Math::Vector center = incident.center + incident.axes[incident_axis] * side;
+    Math::Vector polygon[8] = {center + u_edge + v_edge, center - u_edge + v_edge,
+                               center - u_edge - v_edge, center + u_edge - v_edge};
+    Math::Vector clipped[8];  // 4 points and 4 clips, each adds at most one
+    int          count = 4;
+    for (int i = 1; i < 3; ++i) {
+        const Math::Vector& side        = reference.axes[(axis + i) % 3];
+        const float         side_offset = Math::dot_product(side, face_center);
+        const float         extent      = reference.half_extents[(axis + i) % 3];
+        count = clip(polygon, count, side, side_offset + extent, clipped);
+        count = clip(clipped, count, side * -1, extent - side_offset, polygon);
+    }
+
+    for (int i = 0; i < count; ++i) {
+        const float depth = face_offset - Math::dot_product(face_normal, polygon[i]);
+        if (depth < 0) {
+            continue;
+        }
+        // The incident point is inside the reference box, push it back out
+        // to the reference face to get the point on the reference box
+        const Math::Point         on_incident  = Math::to_point(polygon[i]);
+        const Math::Point         on_reference = Math::to_point(polygon[i] + face_normal * depth);
+        Contact_manifold::Contact contact;
+        contact.normal            = Math::Unit_vector(normal);
+        contact.penetration_depth = depth;
+        contact.contact_point_a   = reference_is_a ? on_reference : on_incident;
+        contact.contact_point_b   = reference_is_a ? on_incident : on_reference;
+        contact.local_point_a     = ca.transform(contact.contact_point_a);
+        contact.local_point_b     = cb.transform(contact.contact_point_b);
+        set_tangents(contact);
+        contacts.push_back(contact);
+    }
+}
+
+// The edge of the box that's furthest along direction and parallel to axis.
+// Returns its middle.
+Math::Vector
+support_edge(const Box& box, int axis, const Math::Vector& direction)
+{
+    Math::Vector middle = box.center;
+    for (int i = 0; i < 3; ++i) {
+        if (i != axis) {
+            const float sign = Math::dot_product(box.axes[i], direction) > 0 ? 1.0f : -1.0f;
+            middle           = middle + box.axes[i] * (sign * box.half_extents[i]);
+        }
+    }
+    return middle;
+}
+
+// Closest points between two edges, taken from Crister Erickson's Real-Time
+// Collision Detection. The edge directions are unit length and not parallel
+// (their cross product was a separating axis candidate).
+void
+box_edge_contact(const Box& a, int axis_a, const Box& b, int axis_b, const Math::Vector& normal,
+                 float depth, const Math::Coordinate_space& ca, const Math::Coordinate_space& cb,
+                 std::vector<Contact_manifold::Contact>& contacts)
+{
+    const Math::Vector  middle_a = support_edge(a, axis_a, normal);
+    const Math::Vector  middle_b = support_edge(b, axis_b, normal * -1);
+    const Math::Vector& dir_a    = a.axes[axis_a];
+    const Math::Vector& dir_b    = b.axes[axis_b];
+    const Math::Vector  r        = middle_a - middle_b;
+    const float         d        = Math::dot_product(dir_a, dir_b);
+    const float         c        = Math::dot_product(dir_a, r);
+    const float         f        = Math::dot_product(dir_b, r);
+    const float         extent_a = a.half_extents[axis_a];
+    const float         extent_b = b.half_extents[axis_b];
+    const float         s = std::max(-extent_a, std::min(extent_a, (d * f - c) / (1 - d * d)));
+    const float         t = std::max(-extent_b, std::min(extent_b, d * s + f));
+
+    Contact_manifold::Contact contact;
+    contact.normal            = Math::Unit_vector(normal);
+    contact.penetration_depth = depth;
+    contact.contact_point_a   = Math::to_point(middle_a + dir_a * s);
+    contact.contact_point_b   = Math::to_point(middle_b + dir_b * t);
+    contact.local_point_a     = ca.transform(contact.contact_point_a);
+    contact.local_point_b     = cb.transform(contact.contact_point_b);
+    set_tangents(contact);
+    contacts.push_back(contact);
+}
+
+bool
+box_intersection(const Physics_model& model_a, const Math::Coordinate_space& ca,
+                 const Physics_model& model_b, const Math::Coordinate_space& cb,
+                 std::vector<Contact_manifold::Contact>& contacts)
+{
+    const Box          a      = make_box(model_a, ca);
+    const Box          b      = make_box(model_b, cb);
+    const Math::Vector offset = b.center - a.center;
+
+    // Axes 0-2 are a's faces, 3-5 are b's, 6-14 are a's edges crossed with
+    // b's. An axis where the boxes only touch doesn't count as a collision,
+    // just like in GJK. Keep the best axis of each of those three groups.
+    std::array<int, 3>          best         = {{-1, -1, -1}};
+    std::array<float, 3>        best_overlap = {};
+    std::array<Math::Vector, 3> best_axis;
+    for (int i = 0; i < 15; ++i) {
+        Math::Vector axis;
+        if (i < 3) {
+            axis = a.axes[i];
+        }
+        else if (i < 6) {
+            axis = b.axes[i - 3];
+        }
+        else {
+            axis               = Math::cross_product(a.axes[(i - 6) / 3], b.axes[(i - 6) % 3]);
+            const float length = axis.length();
+            // Nearly parallel edges give a garbage axis, and the face axes
+            // already cover that case
+            if (length < 0.001f) {
+                continue;
+            }
+            axis = axis / length;
+        }
+        const float distance = Math::dot_product(offset, axis);
+        const float overlap =
+            projected_radius(a, axis) + projected_radius(b, axis) - std::abs(distance);
+        if (overlap <= 0) {
+            return false;
+        }
+        if (distance < 0) {
+            axis = axis * -1;
+        }
+        const int group = std::min(i / 3, 2);
+        if (best[group] == -1 || overlap < best_overlap[group]) {
+            best[group]         = i;
+            best_overlap[group] = overlap;
+            best_axis[group]    = axis;
+        }
+    }
+
+    // a's faces are preferred over b's, and faces over edges. The later group
+    // only wins if it's quite a bit better, that way the manifold doesn't
+    // flip back and forth between steps when there's not much in it.
+    auto clearly_better = [&](int lhs, int rhs) {
+        return best[lhs] != -1 && best_overlap[lhs] < best_overlap[rhs] * 0.95f - 0.001f;
+    };
+    const size_t first = contacts.size();
+    const int    face  = clearly_better(1, 0) ? 1 : 0;
+    if (clearly_better(2, face)) {
+        box_edge_contact(a, (best[2] - 6) / 3, b, (best[2] - 6) % 3, best_axis[2],
+                         best_overlap[2], ca, cb, contacts);
+    }
+    else if (face == 0) {
+        box_face_contacts(a, b, best[0], true, best_axis[0], ca, cb, contacts);
+    }
+    else {
+        box_face_contacts(b, a, best[1] - 3, false, best_axis[1], ca, cb, contacts);
+    }
+    return contacts.size() > first;
+}
+
+// Spheres and capsules are a core (a point or a segment) with a margin
+// around it. Two of them touch if their cores are closer than the sum of the
+// margins, and a rounded shape touches a hull if its core is closer to the
+// hull than its margin. So all of these come down to finding the closest
+// points between the cores, and the normal runs between those.
+//
+// This is the core of a rounded model in world space. A sphere's segment has
+// both ends at the center.
+std::array<Math::Vector, 2>
+core(const Physics_model& model, const Math::Coordinate_space& space)
+{
+    const Math::Vector position = Math::to_vector(space.position());
+    return {{space.transform(model.vectors().front()) + position,
+             space.transform(model.vectors().back()) + position}};
+}
+
+// Contact between two rounded shapes given the closest points on their
+// cores. Either margin can be 0, which makes that side a plain point.
+bool
+rounded_contact(const Math::Vector& core_a, float margin_a, const Math::Vector& core_b,
+                float margin_b, const Math::Coordinate_space& ca, const Math::Coordinate_space& cb,
+                std::vector<Contact_manifold::Contact>& contacts)
+{
+    const Math::Vector between  = core_b - core_a;
+    const float        distance = between.length();
+    if (distance >= margin_a + margin_b) {
+        return false;
+    }
+    // With the cores right on top of each other there's no good normal, so
+    // any one will do
+    const Math::Vector normal = distance > 0.000001f ? between / distance : Math::Vector(0, 1, 0);
+
+    Contact_manifold::Contact contact;
+    contact.normal            = Math::Unit_vector(normal);
+    contact.penetration_depth = margin_a + margin_b - distance;
+    contact.contact_point_a   = Math::to_point(core_a + normal * margin_a);
+    contact.contact_point_b   = Math::to_point(core_b - normal * margin_b);
+    contact.local_point_a     = ca.transform(contact.contact_point_a);
+    contact.local_point_b     = cb.transform(contact.contact_point_b);
+    set_tangents(contact);
+    contacts.push_back(contact);
+    return true;
+}
+
+float
+clamp(float value)
+{
+    return std::max(0.0f, std::min(1.0f, value));
+}
+
+// Closest points between segments p1-q1 and p2-q2, taken from Crister
+// Erickson's Real-Time Collision Detection. Either segment can be a point.
+// Returns the fractions along each segment.
+std::tuple<float, float>
+closest_on_segments(const Math::Vector& p1, const Math::Vector& q1, const Math::Vector& p2,
+                    const Math::Vector& q2)
+{
+    const float        epsilon = 0.000001f;
+    const Math::Vector d1      = q1 - p1;
+    const Math::Vector d2      = q2 - p2;
+    const Math::Vector r       = p1 - p2;
+    const float        a       = Math::dot_product(d1, d1);
+    const float        e       = Math::dot_product(d2, d2);
+    const float        f       = Math::dot_product(d2, r);
+    if (a <= epsilon && e <= epsilon) {
+        return std::make_tuple(0.0f, 0.0f);
+    }
+    if (a <= epsilon) {
+        return std::make_tuple(0.0f, clamp(f / e));
+    }
+    const float c = Math::dot_product(d1, r);
+    if (e <= epsilon) {
+        return std::make_tuple(clamp(-c / a), 0.0f);
+    }
+    const float b     = Math::dot_product(d1, d2);
+    const float denom = a * e - b * b;
+    float       s     = denom > 0 ? clamp((b * f - c * e) / denom) : 0.0f;
+    float       t     = (b * s + f) / e;
+    if (t < 0) {
+        t = 0;
+        s = clamp(-c / a);
+    }
+    else if (t > 1) {
+        t = 1;
+        s = clamp((b - c) / a);
+    }
+    return std::make_tuple(s, t);
+}
+
+// Sphere and capsule against sphere and capsule
+bool
+rounded_intersection(const Physics_model& a, const Math::Coordinate_space& ca,
+                     const Physics_model& b, const Math::Coordinate_space& cb,
+                     std::vector<Contact_manifold::Contact>& contacts)
+{
+    const std::array<Math::Vector, 2> core_a = core(a, ca);
+    const std::array<Math::Vector, 2> core_b = core(b, cb);
+    const Math::Vector                dir_a  = core_a[1] - core_a[0];
+    const Math::Vector                dir_b  = core_b[1] - core_b[0];
+
+    // Two capsules lying side by side touch along a line, one contact in
+    // the middle of that would let them roll. Use the ends of the overlap.
+    const float length_a = dir_a.length_squared();
+    const float length_b = dir_b.length_squared();
+    if (length_a > 0 && length_b > 0 &&
+        Math::cross_product(dir_a, dir_b).length_squared() < 0.0001f * length_a * length_b) {
+        float s0 = clamp(Math::dot_product(core_b[0] - core_a[0], dir_a) / length_a);
+        float s1 = clamp(Math::dot_product(core_b[1] - core_a[0], dir_a) / length_a);
+        if (std::abs(s1 - s0) * std::sqrt(length_a) > 0.001f) {
+            bool ret_val = false;
+            for (float s : {s0, s1}) {
+                const Math::Vector on_a = core_a[0] + dir_a * s;
+                const float        t = clamp(Math::dot_product(on_a - core_b[0], dir_b) / length_b);
+                if (rounded_contact(on_a, a.margin(), core_b[0] + dir_b * t, b.margin(), ca, cb,
+                                    contacts)) {
+                    ret_val = true;
+                }
+            }
+            return ret_val;
+        }
+    }
+
+    float s, t;
+    std::tie(s, t) = closest_on_segments(core_a[0], core_a[1], core_b[0], core_b[1]);
+    return rounded_contact(core_a[0] + dir_a * s, a.margin(), core_b[0] + dir_b * t, b.margin(),
+                           ca, cb, contacts);
+}
+
+// Closest point to the origin on a triangle of Minkowski vectors, again from
+// Real-Time Collision Detection, with p at the origin. Drops the vertices
+// that aren't needed to reach that point and sets the weights of the rest.
+void
+closest_on_triangle(std::array<Minkowski_vector, 4>& simplex, int& size,
+                    std::array<float, 4>& weights)
+{
+    const Minkowski_vector a  = simplex[0];
+    const Minkowski_vector b  = simplex[1];
+    const Minkowski_vector c  = simplex[2];
+    const Math::Vector     ab = b.v() - a.v();
+    const Math::Vector     ac = c.v() - a.v();
+    const float            d1 = -Math::dot_product(ab, a.v());
+    const float            d2 = -Math::dot_product(ac, a.v());
+    if (d1 <= 0 && d2 <= 0) {
+        simplex[0] = a;
+        size       = 1;
+        weights    = {{1, 0, 0, 0}};
+        return;
+    }
+    const float d3 = -Math::dot_product(ab, b.v());
+    const float d4 = -Math::dot_product(ac, b.v());
+    if (d3 >= 0 && d4 <= d3) {
+        simplex[0] = b;
+        size       = 1;
+        weights    = {{1, 0, 0, 0}};
+        return;
+    }
+    const float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0 && d1 >= 0 && d3 <= 0) {
+        const float v = d1 / (d1 - d3);
+        simplex[0]    = a;
+        simplex[1]    = b;
+        size          = 2;
+        weights       = {{1 - v, v, 0, 0}};
+        return;
+    }
+    const float d5 = -Math::dot_product(ab, c.v());
+    const float d6 = -Math::dot_product(ac, c.v());
+    if (d6 >= 0 && d5 <= d6) {
+        simplex[0] = c;
+        size       = 1;
+        weights    = {{1, 0, 0, 0}};
+        return;
+    }
+    const float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0 && d2 >= 0 && d6 <= 0) {
+        const float w = d2 / (d2 - d6);
+        simplex[0]    = a;
+        simplex[1]    = c;
+        size          = 2;
+        weights       = {{1 - w, w, 0, 0}};
+        return;
+    }
+    const float va = d3 * d6 - d5 * d4;
+    if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0) {
+        const float w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+        simplex[0]    = b;
+        simplex[1]    = c;
+        size          = 2;
+        weights       = {{1 - w, w, 0, 0}};
+        return;
+    }
+    const float denom = va + vb + vc;
+    if (denom <= 0) {
+        // Flat triangle, it's no closer than its first edge
+        simplex[0] = a;
+        simplex[1] = b;
+        size       = 2;
+        weights    = {{1, 0, 0, 0}};
+        return;
+    }
+    const float v = vb / denom;
+    const float w = vc / denom;
+    size          = 3;
+    weights       = {{1 - v - w, v, w, 0}};
+}
+
+// Shrink the simplex to the smallest one that still holds the point
+// closest to the origin, and set the weights that make that point. Returns
+// false if the origin is inside the tetrahedron.
+bool
+closest_on_simplex(std::array<Minkowski_vector, 4>& simplex, int& size,
+                   std::array<float, 4>& weights)
+{
+    if (size == 1) {
+        weights = {{1, 0, 0, 0}};
+    }
+    else if (size == 2) {
+        const Math::Vector ab     = simplex[1].v() - simplex[0].v();
+        const float        length = Math::dot_product(ab, ab);
+        const float t = length > 0 ? -Math::dot_product(simplex[0].v(), ab) / length : 0.0f;
+        if (t <= 0) {
+            size    = 1;
+            weights = {{1, 0, 0, 0}};
+        }
+        else if (t >= 1) {
+            simplex[0] = simplex[1];
+            size       = 1;
+            weights    = {{1, 0, 0, 0}};
+        }
+        else {
+            weights = {{1 - t, t, 0, 0}};
+        }
+    }
+    else if (size == 3) {
+        closest_on_triangle(simplex, size, weights);
+    }
+    else {
+        // Try each face that has the origin on its outside, and keep
+        // whichever gets closest
+        static const int faces[4][4] = {{0, 1, 2, 3}, {0, 1, 3, 2}, {0, 2, 3, 1}, {1, 2, 3, 0}};
+        float            best        = std::numeric_limits<float>::max();
+        bool             outside     = false;
+        const auto       tetrahedron = simplex;
+        for (const auto& face : faces) {
+            const Math::Vector& a = tetrahedron[face[0]].v();
+            const Math::Vector  n =
+                Math::cross_product(tetrahedron[face[1]].v() - a, tetrahedron[face[2]].v() - a);
+            const float origin_side = -Math::dot_product(n, a);
+            const float other_side  = Math::dot_product(n, tetrahedron[face[3]].v() - a);
+            // A flat tetrahedron has no inside, treat every face as outside
+            if (std::abs(other_side) > 0.0000001f && origin_side * other_side >= 0) {
+                continue;
+            }
+            std::array<Minkowski_vector, 4> triangle = {
+                {tetrahedron[face[0]], tetrahedron[face[1]], tetrahedron[face[2]]}};
+            int                  triangle_size = 3;
+            std::array<float, 4> triangle_weights;
+            closest_on_triangle(triangle, triangle_size, triangle_weights);
+            Math::Vector closest;
+            for (int i = 0; i < triangle_size; ++i) {
+                closest = closest + triangle[i].v() * triangle_weights[i];
+            }
+            if (closest.length_squared() < best) {
+                best    = closest.length_squared();
+                outside = true;
+                simplex = triangle;
+                size    = triangle_size;
+                weights = triangle_weights;
+            }
+        }
+        return outside;
+    }
+    return true;
+}
+
+// GJK again, but this time to find how far apart the core of a rounded shape
+// is from a hull, rather than just if they touch.
+// http://www.dtecta.com/papers/jgt98convex.pdf
+// Returns false if they overlap, otherwise point_core and point_hull are
+// the closest points.
+bool
+closest_points(const Math::Vector* core, int core_size, const Physics_model& hull,
+               const Math::Coordinate_space& ch, int& hint, Math::Vector& point_core,
+               Math::Vector& point_hull)
+{
+    auto support = [&](const Math::Vector& direction) {
+        const Math::Vector* support_core = core;
+        for (int i = 1; i < core_size; ++i) {
+            if (Math::dot_product(core[i], direction) >
+                Math::dot_product(*support_core, direction)) {
+                support_core = &core[i];
+            }
+        }
+        const Math::Vector support_hull =
+            ch.transform(hull.support(ch.transform(direction * -1), hint)) +
+            Math::to_vector(ch.position());
+        return Minkowski_vector(*support_core - support_hull, *support_core, support_hull);
+    };
+
+    std::array<Minkowski_vector, 4> simplex;
+    std::array<float, 4>            weights;
+    int                             size = 1;
+    simplex[0]                           = support(Math::Vector(1, 0, 0));
+    // Every step gets closer, so this should never run out, but just in case
+    for (int i = 0; i < 32; ++i) {
+        if (!closest_on_simplex(simplex, size, weights)) {
+            return false;
+        }
+        Math::Vector closest;
+        for (int j = 0; j < size; ++j) {
+            closest = closest + simplex[j].v() * weights[j];
+        }
+        const float distance_squared = closest.length_squared();
+        if (distance_squared < 0.0000001f) {
+            return false;
+        }
+        // If the next support point doesn't get any closer to the origin
+        // then we're already as close as it gets
+        const Minkowski_vector next = support(closest * -1);
+        if (distance_squared - Math::dot_product(closest, next.v()) <=
+            0.00001f * distance_squared) {
+            break;
+        }
+        bool repeat = false;
+        for (int j = 0; j < size; ++j) {
+            repeat = repeat || simplex[j].v() == next.v();
+        }
+        if (repeat) {
+            break;
+        }
+        simplex[size++] = next;
+    }
+    point_core = Math::Vector();
+    point_hull = Math::Vector();
+    for (int i = 0; i < size; ++i) {
+        point_core = point_core + simplex[i].support_a() * weights[i];
+        point_hull = point_hull + simplex[i].support_b() * weights[i];
+    }
+    return true;
+}
+
+// Sphere or capsule against a hull and its kids. The contacts all have the
+// rounded shape as a.
+bool
+rounded_hull_intersection(const Physics_model& rounded, const Math::Coordinate_space& cr,
+                          const Physics_model& hull, const Math::Coordinate_space& ch, int& hint,
+                          std::vector<Contact_manifold::Contact>& contacts)
+{
+    bool ret_val = false;
+    for (const auto& kid : hull.kids()) {
+        int kid_hint = 0;
+        if (rounded_hull_intersection(rounded, cr, *kid, ch, kid_hint, contacts)) {
+            ret_val = true;
+        }
+    }
+    if (hull.vectors().empty()) {
+        return ret_val;
+    }
+
+    const std::array<Math::Vector, 2> segment = core(rounded, cr);
+    const int    size = rounded.shape() == Physics_model::Shape::CAPSULE ? 2 : 1;
+    Math::Vector point_core;
+    Math::Vector point_hull;
+    if (!closest_points(segment.data(), size, hull, ch, hint, point_core, point_hull)) {
+        // The core is inside the hull, so there's no closest point. Use EPA
+        // to find how deep the core is, then add the margin on.
+        const Relative_frame frame(cr, ch);
+        Minkowski_simplex    simplex;
+        int                  hint_core = 0;
+        if (!model_intersection(rounded, hull, frame, Math::Vector(1, 0, 0), simplex, hint_core,
+                                hint)) {
+            return ret_val;
+        }
+        Contact_manifold::Contact contact;
+        find_collision_point(rounded, hull, frame, simplex, contact, hint_core, hint);
+        contact.penetration_depth += rounded.margin();
+        contact.contact_point_a = contact.contact_point_a + contact.normal * rounded.margin();
+        contact.local_point_a   = cr.transform(contact.contact_point_a);
+        contacts.push_back(contact);
+        return true;
+    }
+
+    const size_t       first      = contacts.size();
+    const Math::Vector first_core = point_core;
+    if (!rounded_contact(point_core, rounded.margin(), point_hull, 0, cr, ch, contacts)) {
+        return ret_val;
+    }
+    // A capsule lying flat on a face only gets one contact from that, and
+    // would roll about it. Both of its ends should be touching too.
+    const Math::Vector axis = segment[1] - segment[0];
+    if (size == 2 && std::abs(Math::dot_product(Math::Vector(contacts[first].normal), axis)) <
+                         0.1f * axis.length()) {
+        for (const auto& end : segment) {
+            int end_hint = hint;
+            if (closest_points(&end, 1, hull, ch, end_hint, point_core, point_hull) &&
+                (point_core - first_core).length_squared() >
+                    0.01f * rounded.margin() * rounded.margin()) {
+                rounded_contact(point_core, rounded.margin(), point_hull, 0, cr, ch, contacts);
+            }
+        }
+    }
+    return true;
+}
+
+// Swap a and b in the contacts from first on
+void
+flip_contacts(std::vector<Contact_manifold::Contact>& contacts, size_t first)
+{
+    for (size_t i = first; i < contacts.size(); ++i) {
+        Contact_manifold::Contact& contact = contacts[i];
+        std::swap(contact.contact_point_a, contact.contact_point_b);
+        std::swap(contact.local_point_a, contact.local_point_b);
+        contact.normal = Math::Unit_vector(Math::Vector(contact.normal) * -1);
+        set_tangents(contact);
+    }
+}
+
+// The Colliders for the special purpose tests above. None of them use the
+// greedy flag or the pair's state, they always find the whole manifold.
+bool
+box_collider(const Physics_model& a, const Math::Coordinate_space& ca, const Physics_model& b,
+             const Math::Coordinate_space& cb, bool,
+             std::vector<Contact_manifold::Contact>& contacts, Collision_solver::Pair_state&)
+{
+    return box_intersection(a, ca, b, cb, contacts);
+}
+
+bool
+rounded_collider(const Physics_model& a, const Math::Coordinate_space& ca, const Physics_model& b,
+                 const Math::Coordinate_space& cb, bool,
+                 std::vector<Contact_manifold::Contact>& contacts, Collision_solver::Pair_state&)
+{
+    return rounded_intersection(a, ca, b, cb, contacts);
+}
+
+// Except this one, which starts the hull's support queries from last time
+bool
+rounded_hull_collider(const Physics_model& a, const Math::Coordinate_space& ca,
+                      const Physics_model& b, const Math::Coordinate_space& cb, bool,
+                      std::vector<Contact_manifold::Contact>& contacts,
+                      Collision_solver::Pair_state&           state)
+{
+    return rounded_hull_intersection(a, ca, b, cb, state.support_b[0], contacts);
+}
+
 }  // namespace
 
+Collision_solver::Collision_solver(bool greedy_manifold) : m_greedy_manifold(greedy_manifold)
+{
+    for (auto& row : m_colliders) {
+        for (auto& dispatch : row) {
+            dispatch.collider = gjk_collider;
+        }
+    }
+    typedef Physics_model::Shape Shape;
+    set_collider(Shape::BOX, Shape::BOX, box_collider);
+    set_collider(Shape::SPHERE, Shape::SPHERE, rounded_collider);
+    set_collider(Shape::SPHERE, Shape::CAPSULE, rounded_collider);
+    set_collider(Shape::CAPSULE, Shape::CAPSULE, rounded_collider);
+    set_collider(Shape::SPHERE, Shape::HULL, rounded_hull_collider);
+    set_collider(Shape::SPHERE, Shape::BOX, rounded_hull_collider);
+    set_collider(Shape::CAPSULE, Shape::HULL, rounded_hull_collider);
+    set_collider(Shape::CAPSULE, Shape::BOX, rounded_hull_collider);
+}
+
+bool
+Collision_solver::gjk_collider(const Physics_model& a, const Math::Coordinate_space& ca,
+                               const Physics_model& b, const Math::Coordinate_space& cb,
+                               bool                                    greedy_manifold,
+                               std::vector<Contact_manifold::Contact>& contacts, Pair_state& state)
+{
+    const Relative_frame frame(ca, cb);
+    return intersection_recurse_a(a, ca, b, cb, frame, greedy_manifold, contacts, &state);
+}
+
+void
+Collision_solver::set_collider(Physics_model::Shape a, Physics_model::Shape b, Collider collider)
+{
+    m_colliders[static_cast<int>(a)][static_cast<int>(b)] = {collider, false};
+    if (a != b) {
+        m_colliders[static_cast<int>(b)][static_cast<int>(a)] = {collider, true};
+    }
+}
+
 bool
 Collision_solver::broad_phase_intersection(const Physics_object& a, const Physics_object& b) const
 {
@@ -248,8 +1329,28 @@ bool
 Collision_solver::intersection(const Physics_object& a, const Physics_object& b,
                                std::vector<Contact_manifold::Contact>& contacts) const
 {
-    return intersection_recurse_a(a.model(), a.coordinate_space(), b.model(), b.coordinate_space(),
-                                  m_greedy_manifold, contacts);
+    Pair_state state;
+    return intersection(a, b, contacts, state);
+}
+
+bool
+Collision_solver::intersection(const Physics_object& a, const Physics_object& b,
+                               std::vector<Contact_manifold::Contact>& contacts,
+                               Pair_state&                             state) const
+{
+    const Dispatch& dispatch = m_colliders[static_cast<int>(a.model().shape())]
+                                          [static_cast<int>(b.model().shape())];
+    if (!dispatch.flip) {
+        return dispatch.collider(a.model(), a.coordinate_space(), b.model(), b.coordinate_space(),
+                                 m_greedy_manifold, contacts, state);
+    }
+    // The pair's state is only ever used from this side, so it doesn't
+    // matter that a and b are the wrong way round in it
+    const size_t first = contacts.size();
+    const bool   found = dispatch.collider(b.model(), b.coordinate_space(), a.model(),
+                                         a.coordinate_space(), m_greedy_manifold, contacts, state);
+    flip_contacts(contacts, first);
+    return found;
 }
 
 }  // namespace Physics
@@ -2,10 +2,17 @@
 #define INCLUDED_PHYSICS_COLLISIONSOLVER
 
 #include "Contact_manifold.h"
+#include "Physics_model.h"
 
+#include <array>
 #include <vector>
 
 namespace Dubious {
+
+namespace Math {
+class Coordinate_space;
+}  // namespace Math
+
 namespace Physics {
 
 class Physics_object;
@@ -20,16 +27,87 @@ class Physics_object;
 /// http://hacktank.net/blog/?p=119
 /// http://allenchou.net/2013/12/game-physics-contact-generation-epa/
 /// http://stackoverflow.com/questions/31764305/im-implementing-the-expanding-polytope-algorithm-and-i-am-unsure-how-to-deduce
+///
+/// Some pairs of shapes have faster tests than GJK. Which test is used for
+/// each pair of shapes is looked up in a table, with GJK and EPA as the
+/// fallback for everything that doesn't have anything better.
 class Collision_solver {
 public:
     /// @brief Constructor
     /// @param greedy_manifold - [in] sets whether this will try to find as many
-    ///                          contacts as possible when finding intersections
+    ///                          contacts as possible when finding intersections.
+    ///                          Hulls with faces get them by clipping faces
+    ///                          against each other, anything else by starting
+    ///                          GJK from each of the DIRECTIONS
     Collision_solver(bool greedy_manifold);
 
     Collision_solver(const Collision_solver&) = delete;
     Collision_solver& operator=(const Collision_solver&) = delete;
 
+    /// How many directions GJK is started from when looking for contacts. The
+    /// non-greedy solver, and the greedy one when it can clip faces, only
+    /// use the first.
+    static const int DIRECTIONS = 6;
+
+    /// @brief What the solver remembers about a pair between steps
+    ///
+    /// For each starting direction this holds the vertex of each model that
+    /// the last support query landed on. Objects don't move much in one step,
+    /// so starting the next search there usually finds the answer right away.
+    ///
+    /// It also holds the model vertices that made up the tetrahedron GJK
+    /// finished with. Next step that tetrahedron is rebuilt where the objects
+    /// are now, and if it still holds the origin GJK is skipped.
+    ///
+    /// Only the top level models use this, their kids start from scratch.
+    struct Pair_state {
+        struct Simplex {
+            int                size    = 0;  // 0 if GJK found nothing last time
+            std::array<int, 4> index_a = {};
+            std::array<int, 4> index_b = {};
+        };
+
+        std::array<int, DIRECTIONS>     support_a = {};
+        std::array<int, DIRECTIONS>     support_b = {};
+        std::array<Simplex, DIRECTIONS> simplex;
+    };
+
+    /// @brief A collision test for one pair of shapes
+    ///
+    /// These work like intersection, but are given the top level models of
+    /// the two objects. Contact normals point from a to b.
+    /// @param a - [in] the first model
+    /// @param ca - [in] the first model's coordinate space
+    /// @param b - [in] the second model
+    /// @param cb - [in] the second model's coordinate space
+    /// @param greedy_manifold - [in] whether to find as many contacts as possible
+    /// @param contacts - [out] contact information
+    /// @param state - [in,out] what was remembered about this pair last time
+    /// @returns true if they collide
+    typedef bool (*Collider)(const Physics_model& a, const Math::Coordinate_space& ca,
+                             const Physics_model& b, const Math::Coordinate_space& cb,
+                             bool greedy_manifold, std::vector<Contact_manifold::Contact>& contacts,
+                             Pair_state& state);
+
+    /// @brief The fallback Collider, GJK and EPA
+    ///
+    /// Works on any models, and their kids, by looking at their vectors().
+    /// That's not the whole shape for a SPHERE or a CAPSULE though.
+    static bool gjk_collider(const Physics_model& a, const Math::Coordinate_space& ca,
+                             const Physics_model& b, const Math::Coordinate_space& cb,
+                             bool greedy_manifold, std::vector<Contact_manifold::Contact>& contacts,
+                             Pair_state& state);
+
+    /// @brief Set the Collider for a pair of shapes
+    ///
+    /// The same Collider is used for b against a, by swapping the models
+    /// going in and flipping the contacts coming out. Setting the Collider
+    /// for b against a afterwards replaces that.
+    /// @param a - [in] the first shape
+    /// @param b - [in] the second shape
+    /// @param collider - [in] the Collider to use for them
+    void set_collider(Physics_model::Shape a, Physics_model::Shape b, Collider collider);
+
     /// @brief find the intersection of 2 objects
     ///
     /// This is the main entry point to the collision solver.
@@ -42,6 +120,15 @@ public:
     bool intersection(const Physics_object& a, const Physics_object& b,
                       std::vector<Contact_manifold::Contact>& contacts) const;
 
+    /// @brief find the intersection of 2 objects, using and updating the pair's state
+    /// @param a - [in] the first object
+    /// @param b - [in] the second object
+    /// @param contacts - [out] contact information
+    /// @param state - [in,out] what was remembered about this pair last time
+    /// @returns true if they collide
+    bool intersection(const Physics_object& a, const Physics_object& b,
+                      std::vector<Contact_manifold::Contact>& contacts, Pair_state& state) const;
+
     /// @brief cheap and cheerful intersection test
     ///
     /// This is a cheap and very rough intersection test. It only
@@ -54,7 +141,13 @@ public:
     bool broad_phase_intersection(const Physics_object& a, const Physics_object& b) const;
 
 private:
-    bool m_greedy_manifold;
+    struct Dispatch {
+        Collider collider = nullptr;
+        bool     flip     = false;  // call it with a and b swapped
+    };
+
+    bool                                                                         m_greedy_manifold;
+    std::array<std::array<Dispatch, Physics_model::SHAPES>, Physics_model::SHAPES> m_colliders;
 };
 
 }  // namespace Physics
@@ -0,0 +1,94 @@
+#include "Collision_strategy.h"
+#include "Physics_object.h"
+#include "Pair_cache.h"
+
+#include <algorithm>
+
+namespace Dubious {
+namespace Physics {
+
+void
+Collision_strategy::Collision_buffer::narrow_phase(const Collision_solver& solver,
+                                                   const Pair_cache& pairs, Physics_object& a,
+                                                   Physics_object& b)
+{
+    if (m_size == m_collisions.size()) {
+        m_collisions.push_back(Collision());
+    }
+    // Reuse the slot. It only counts if the pair actually collides,
+    // otherwise the next pair writes over it, and its contacts.
+    Collision& collision    = m_collisions[m_size];
+    collision.a             = &a;
+    collision.b             = &b;
+    collision.first_contact = m_contacts.size();
+    const Collision_solver::Pair_state* state = pairs.state(std::make_tuple(a.id(), b.id()));
+    collision.state  = state ? *state : Collision_solver::Pair_state();
+    collision.asleep = asleep(a, b);
+    if (collision.asleep) {
+        // Nothing has moved since they went to sleep. If they were colliding
+        // then they still are, and the contacts in the cache are still good.
+        collision.contact_count = 0;
+        if (state) {
+            ++m_size;
+        }
+    }
+    else if (solver.intersection(a, b, m_contacts, collision.state)) {
+        collision.contact_count = m_contacts.size() - collision.first_contact;
+        ++m_size;
+    }
+    else {
+        m_contacts.resize(collision.first_contact);
+    }
+}
+
+Collision_strategy::Collision_buffer&
+Collision_strategy::buffer(size_t index)
+{
+    // a deque so that growing it doesn't move the buffers already handed out
+    while (m_buffers.size() <= index) {
+        m_buffers.emplace_back();
+    }
+    return m_buffers[index];
+}
+
+void
+Collision_strategy::clear_buffers()
+{
+    for (auto& buffer : m_buffers) {
+        buffer.clear();
+    }
+}
+
+void
+Collision_strategy::merge_buffers(Pair_cache& pairs)
+{
+    m_sorted.clear();
+    for (const auto& buffer : m_buffers) {
+        for (size_t i = 0; i < buffer.size(); ++i) {
+            m_sorted.push_back({&buffer[i], buffer.contacts(buffer[i])});
+        }
+    }
+    // Object ids are unique, so this is a total order and doesn't depend on
+    // which buffer a collision landed in.
+    std::sort(m_sorted.begin(), m_sorted.end(), [](const Merge_entry& lhs, const Merge_entry& rhs) {
+        const int lhs_a = lhs.collision->a->id();
+        const int rhs_a = rhs.collision->a->id();
+        return lhs_a < rhs_a || (lhs_a == rhs_a && lhs.collision->b->id() < rhs.collision->b->id());
+    });
+
+    pairs.begin_step();
+    for (const Merge_entry& entry : m_sorted) {
+        const Collision&  collision = *entry.collision;
+        Contact_manifold& manifold  = pairs.touch(*collision.a, *collision.b);
+        if (collision.asleep) {
+            continue;
+        }
+        manifold.prune_old_contacts();
+        manifold.insert(entry.contacts, collision.contact_count);
+        *pairs.state(std::make_tuple(collision.a->id(), collision.b->id())) = collision.state;
+    }
+    pairs.end_step();
+}
+
+}  // namespace Physics
+}  // namespace Dubious
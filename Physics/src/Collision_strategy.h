@@ -1,8 +1,11 @@
 #ifndef INCLUDED_PHYSICS_COLLISIONSTRATEGY
 #define INCLUDED_PHYSICS_COLLISIONSTRATEGY
 
+#include "Contact_manifold.h"
+#include "Collision_solver.h"
+
 #include <vector>
-#include <map>
+#include <deque>
 #include <tuple>
 #include <memory>
 
@@ -10,7 +13,7 @@ namespace Dubious {
 namespace Physics {
 
 class Physics_object;
-class Contact_manifold;
+class Pair_cache;
 
 /// @brief Interface for finding collisions between all objects
 ///
@@ -20,6 +23,10 @@ class Contact_manifold;
 /// is a separate interface because there are a number of ways to
 /// do this work. Currently I've implemented a single threaded
 /// solver, a multi-threaded solver, and one that uses OpenCL.
+///
+/// However the work is split up, the narrow phase results go into
+/// Collision_buffers and are then merged into the Pair_cache on one
+/// thread in a fixed order.
 class Collision_strategy {
 public:
     Collision_strategy(const Collision_strategy&) = delete;
@@ -34,14 +41,102 @@ public:
     ///
     /// This is the main point of the Collision Strategy implementations.
     /// Given a vector of all of the objects in the universe, create (or
-    /// update) contacts manifolds for each colliding pair.
+    /// update) contacts manifolds for each colliding pair. Implementations
+    /// should call Pair_cache::begin_step, touch every colliding pair, then
+    /// call Pair_cache::end_step to remove the pairs that are no longer colliding.
     /// @param objects - [in] All of the objects to compare
-    /// @param manifolds - [in,out] contact information between each pair
+    /// @param pairs - [in,out] contact information between each pair
     virtual void find_contacts(const std::vector<std::shared_ptr<Physics_object>>& objects,
-                               std::map<Physics_object_ids, Contact_manifold>&     manifolds) = 0;
+                               Pair_cache&                                         pairs) = 0;
 
 protected:
     Collision_strategy() = default;
+
+    /// @brief Narrow phase result for one colliding pair
+    ///
+    /// The contacts are in the Collision_buffer that holds this Collision.
+    struct Collision {
+        Physics_object*              a;
+        Physics_object*              b;
+        size_t                       first_contact;
+        size_t                       contact_count;
+        Collision_solver::Pair_state state;
+        bool                         asleep;
+    };
+
+    /// @brief Narrow phase output for one worker
+    ///
+    /// Each worker writes into its own buffer so the narrow phase doesn't need
+    /// any locks. The buffer is the worker's scratch memory for the step. The
+    /// Collisions, and the contacts for all of them, are bumped onto the end of
+    /// two arrays and the whole lot is thrown away at once by clear(). The
+    /// arrays keep their memory between steps, so once they've grown to fit
+    /// the busiest step nothing is allocated.
+    class Collision_buffer {
+    public:
+        /// @brief Run the narrow phase on a pair, keeping the result if they collide
+        ///
+        /// If the pair was colliding last step the solver starts from the state
+        /// saved in the pair cache. The cache is only read here, the updated
+        /// state is written back by merge_buffers. A pair that is asleep isn't
+        /// solved at all, it's kept as it is if it was colliding.
+        /// @param solver - [in] the collision solver to use
+        /// @param pairs - [in] the pair cache, not in a step
+        /// @param a - [in] first object, the one with the lower index
+        /// @param b - [in] second object
+        void narrow_phase(const Collision_solver& solver, const Pair_cache& pairs,
+                          Physics_object& a, Physics_object& b);
+
+        void clear()
+        {
+            m_size = 0;
+            m_contacts.clear();
+        }
+        size_t           size() const { return m_size; }
+        const Collision& operator[](size_t index) const { return m_collisions[index]; }
+
+        /// @brief The contacts of a collision in this buffer
+        ///
+        /// Good until the next call to narrow_phase or clear.
+        const Contact_manifold::Contact* contacts(const Collision& collision) const
+        {
+            return m_contacts.data() + collision.first_contact;
+        }
+
+    private:
+        std::vector<Collision>                 m_collisions;
+        size_t                                 m_size = 0;
+        std::vector<Contact_manifold::Contact> m_contacts;
+    };
+
+    /// @brief Get a buffer for a worker
+    ///
+    /// Only call this from the thread that starts the workers, never from the
+    /// workers themselves. It's fine to hand out more buffers while earlier
+    /// workers are already using theirs, growing the buffers never moves the
+    /// ones already handed out. The returned reference is good until the
+    /// Collision_strategy is destroyed.
+    /// @param index - [in] which buffer
+    Collision_buffer& buffer(size_t index);
+
+    /// @brief Empty out all of the buffers ready for a new step
+    void clear_buffers();
+
+    /// @brief Feed every buffered collision into the pair cache
+    ///
+    /// The collisions are sorted by object id first, so the results are the
+    /// same no matter how the work was divided up between threads.
+    /// @param pairs - [in,out] the pair cache to update
+    void merge_buffers(Pair_cache& pairs);
+
+private:
+    struct Merge_entry {
+        const Collision*                 collision;
+        const Contact_manifold::Contact* contacts;
+    };
+
+    std::deque<Collision_buffer> m_buffers;
+    std::vector<Merge_entry>     m_sorted;
 };
 
 }  // namespace Physics
@@ -0,0 +1,93 @@
+#include "Collision_strategy_aabb_tree.h"
+#include "Physics_object.h"
+#include "Physics_model.h"
+#include "Pair_cache.h"
+
+namespace Dubious {
+namespace Physics {
+
+Collision_strategy_aabb_tree::Collision_strategy_aabb_tree(bool  greedy_manifold,
+                                                           float aabb_margin,
+                                                           float aabb_velocity_multiplier,
+                                                           float step_size)
+    : m_collision_solver(greedy_manifold)
+    , m_aabb_margin(aabb_margin)
+    , m_aabb_velocity_multiplier(aabb_velocity_multiplier)
+    , m_step_size(step_size)
+{
+}
+
+void
+Collision_strategy_aabb_tree::find_contacts(
+    const std::vector<std::shared_ptr<Physics_object>>& objects,
+    Pair_cache&                                         pairs)
+{
+    if (objects.size() < m_proxies.size()) {
+        for (auto proxy : m_proxies) {
+            m_tree.remove(proxy);
+        }
+        m_proxies.clear();
+    }
+    for (size_t i = 0; i < m_proxies.size(); ++i) {
+        const auto& object = *objects[i];
+        m_tree.move(m_proxies[i], tight_box(object), fat_box(object));
+    }
+    for (size_t i = m_proxies.size(); i < objects.size(); ++i) {
+        m_proxies.push_back(m_tree.insert(fat_box(*objects[i]), i));
+    }
+
+    m_pairs.clear();
+    m_tree.overlapping_pairs(m_pairs);
+
+    clear_buffers();
+    Collision_buffer& collisions = buffer(0);
+    for (const auto& pair : m_pairs) {
+        auto a = objects[std::get<0>(pair)].get();
+        auto b = objects[std::get<1>(pair)].get();
+        if (!m_collision_solver.broad_phase_intersection(*a, *b)) {
+            continue;
+        }
+        collisions.narrow_phase(m_collision_solver, pairs, *a, *b);
+    }
+    merge_buffers(pairs);
+}
+
+Dynamic_aabb_tree::Aabb
+Collision_strategy_aabb_tree::tight_box(const Physics_object& object) const
+{
+    const auto&             position = object.coordinate_space().position();
+    const float             radius   = object.model().radius();
+    Dynamic_aabb_tree::Aabb box;
+    box.min[0] = position.x() - radius;
+    box.min[1] = position.y() - radius;
+    box.min[2] = position.z() - radius;
+    box.max[0] = position.x() + radius;
+    box.max[1] = position.y() + radius;
+    box.max[2] = position.z() + radius;
+    return box;
+}
+
+Dynamic_aabb_tree::Aabb
+Collision_strategy_aabb_tree::fat_box(const Physics_object& object) const
+{
+    // Grow the box by the margin in all directions, then stretch it out in
+    // the direction of travel so it covers where the object is heading.
+    Dynamic_aabb_tree::Aabb box      = tight_box(object);
+    const float             scale    = m_step_size * m_aabb_velocity_multiplier;
+    const Math::Vector      travel   = object.velocity() * scale;
+    const float             delta[3] = {travel.x(), travel.y(), travel.z()};
+    for (int axis = 0; axis < 3; ++axis) {
+        box.min[axis] -= m_aabb_margin;
+        box.max[axis] += m_aabb_margin;
+        if (delta[axis] < 0) {
+            box.min[axis] += delta[axis];
+        }
+        else {
+            box.max[axis] += delta[axis];
+        }
+    }
+    return box;
+}
+
+}  // namespace Physics
+}  // namespace Dubious
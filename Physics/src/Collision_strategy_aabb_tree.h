@@ -0,0 +1,62 @@
+#ifndef INCLUDED_PHYSICS_COLLISIONSTRATEGYAABBTREE
+#define INCLUDED_PHYSICS_COLLISIONSTRATEGYAABBTREE
+
+#include "Collision_strategy.h"
+#include "Collision_solver.h"
+#include "Dynamic_aabb_tree.h"
+
+namespace Dubious {
+namespace Physics {
+
+class Physics_object;
+class Pair_cache;
+
+/// @brief Dynamic AABB Tree Collision Strategy
+///
+/// Every object gets a leaf in a Dynamic_aabb_tree. The leaf's box is made
+/// bigger than the object, both by a fixed margin and in the direction the
+/// object is moving, so the object can wander around for a few steps before
+/// the tree has to be updated. Potentially colliding pairs come from walking
+/// the tree against itself, which copes much better than a grid when the
+/// objects are all different sizes.
+class Collision_strategy_aabb_tree : public Collision_strategy {
+public:
+    /// @brief Constructor
+    ///
+    /// @param greedy_manifold - [in] see Arena::Settings
+    /// @param aabb_margin - [in] see Arena::Settings
+    /// @param aabb_velocity_multiplier - [in] see Arena::Settings
+    /// @param step_size - [in] see Arena::Settings
+    Collision_strategy_aabb_tree(bool greedy_manifold, float aabb_margin,
+                                 float aabb_velocity_multiplier, float step_size);
+
+    /// @brief Destructor
+    ~Collision_strategy_aabb_tree() = default;
+
+    Collision_strategy_aabb_tree(const Collision_strategy_aabb_tree&) = delete;
+    Collision_strategy_aabb_tree& operator=(const Collision_strategy_aabb_tree&) = delete;
+
+    /// @brief See Collision_strategy::find_contacts
+    void find_contacts(const std::vector<std::shared_ptr<Physics_object>>& objects,
+                       Pair_cache&                                         pairs) final;
+
+private:
+    Collision_solver m_collision_solver;
+    const float      m_aabb_margin;
+    const float      m_aabb_velocity_multiplier;
+    const float      m_step_size;
+
+    // Leaves are indexed by the object's position in the objects vector. If
+    // the vector shrinks we throw the whole tree away and start again.
+    Dynamic_aabb_tree                       m_tree;
+    std::vector<int>                        m_proxies;
+    std::vector<std::tuple<size_t, size_t>> m_pairs;
+
+    Dynamic_aabb_tree::Aabb tight_box(const Physics_object& object) const;
+    Dynamic_aabb_tree::Aabb fat_box(const Physics_object& object) const;
+};
+
+}  // namespace Physics
+}  // namespace Dubious
+
+#endif
@@ -1,77 +1,69 @@
 #include "Collision_strategy_multi_threaded.h"
 #include "Physics_object.h"
 #include "Physics_model.h"
-#include "Contact_manifold.h"
+#include "Pair_cache.h"
 
-#include <set>
-#include <future>
+#include <algorithm>
+#include <atomic>
+#include <thread>
 
 namespace Dubious {
 namespace Physics {
 
-Collision_strategy_multi_threaded::Collision_strategy_multi_threaded(
-    float manifold_persistent_threshold, float manifold_movement_threshold, bool greedy_manifold,
-    unsigned int workgroup_size)
+Collision_strategy_multi_threaded::Collision_strategy_multi_threaded(bool         greedy_manifold,
+                                                                     unsigned int workgroup_size)
     : m_collision_solver(greedy_manifold)
-    , m_manifold_persistent_threshold(manifold_persistent_threshold)
-    , m_manifold_movement_threshold(manifold_movement_threshold)
     , m_workgroup_size(workgroup_size)
+    , m_workers(std::max(1u, std::thread::hardware_concurrency()))
 {
 }
 
 void
 Collision_strategy_multi_threaded::find_contacts(
     const std::vector<std::shared_ptr<Physics_object>>& objects,
-    std::map<Physics_object_ids, Contact_manifold>&     manifolds)
+    Pair_cache&                                         pairs)
 {
-    std::vector<std::future<std::set<Physics_object_ids>>> local_pairs;
+    clear_buffers();
+    m_tasks.clear();
 
+    // Every group of objects against itself, then against every group after it
     for (size_t i = 0; i < objects.size(); i += m_workgroup_size) {
-        size_t length = m_workgroup_size;
-        if (i + length > objects.size()) {
-            length = objects.size() - i;
-        }
-        local_pairs.push_back(std::async(std::launch::async,
-                                         &Collision_strategy_multi_threaded::solve_inner, this, i,
-                                         length, std::cref(objects), std::ref(manifolds)));
+        const size_t length = std::min<size_t>(m_workgroup_size, objects.size() - i);
+        m_tasks.push_back(Task{true, i, length, i, length, nullptr});
     }
     for (size_t i = 0; i < objects.size(); i += m_workgroup_size) {
         for (size_t j = i + m_workgroup_size; j < objects.size(); j += m_workgroup_size) {
-            size_t length = m_workgroup_size;
-            if (j + length > objects.size()) {
-                length = objects.size() - j;
-            }
-            local_pairs.push_back(std::async(
-                std::launch::async, &Collision_strategy_multi_threaded::solve_outer, this, i,
-                m_workgroup_size, j, length, std::cref(objects), std::ref(manifolds)));
+            const size_t length = std::min<size_t>(m_workgroup_size, objects.size() - j);
+            m_tasks.push_back(Task{false, i, m_workgroup_size, j, length, nullptr});
         }
     }
-
-    // collect the results
-    std::set<Physics_object_ids> new_pairs;
-    for (auto& results : local_pairs) {
-        const auto& result_set = results.get();
-        new_pairs.insert(result_set.begin(), result_set.end());
+    for (size_t i = 0; i < m_tasks.size(); ++i) {
+        m_tasks[i].collisions = &buffer(i);
     }
 
-    // remove any stale contacts
-    for (auto iter = manifolds.begin(), end = manifolds.end(); iter != end;) {
-        if (new_pairs.find(iter->first) == new_pairs.end()) {
-            manifolds.erase(iter++);
-        }
-        else {
-            ++iter;
+    // The workers take tasks off the list until there are none left
+    std::atomic<size_t> next_task(0);
+    auto                job = [&](unsigned int) {
+        for (size_t i = next_task++; i < m_tasks.size(); i = next_task++) {
+            const Task& task = m_tasks[i];
+            if (task.inner) {
+                solve_inner(task.a_start, task.a_length, objects, pairs, *task.collisions);
+            }
+            else {
+                solve_outer(task.a_start, task.a_length, task.b_start, task.b_length, objects,
+                            pairs, *task.collisions);
+            }
         }
-    }
+    };
+    m_workers.run(job);
+    merge_buffers(pairs);
 }
 
-#pragma warning(disable : 4503)  // decorated name length exceeded, name was truncated
-std::set<Collision_strategy::Physics_object_ids>
+void
 Collision_strategy_multi_threaded::solve_inner(
     size_t start, size_t length, const std::vector<std::shared_ptr<Physics_object>>& objects,
-    std::map<Physics_object_ids, Contact_manifold>& manifolds)
+    const Pair_cache& pairs, Collision_buffer& collisions)
 {
-    std::set<Physics_object_ids> new_pairs;
     for (size_t i = start; i < start + length; ++i) {
         auto a = objects[i].get();
         for (size_t j = i + 1; j < start + length; ++j) {
@@ -79,36 +71,17 @@ Collision_strategy_multi_threaded::solve_inner(
             if (!m_collision_solver.broad_phase_intersection(*a, *b)) {
                 continue;
             }
-            std::vector<Contact_manifold::Contact> contacts;
-            if (m_collision_solver.intersection(*a, *b, contacts)) {
-                auto id_pair          = std::make_tuple(a->id(), b->id());
-                auto contact_manifold = manifolds.find(id_pair);
-                if (contact_manifold == manifolds.end()) {
-                    std::unique_lock<std::mutex> lock(m_manifolds_mutex);
-                    contact_manifold =
-                        manifolds
-                            .insert(std::make_pair(
-                                id_pair, Contact_manifold(*a, *b, m_manifold_persistent_threshold,
-                                                          m_manifold_movement_threshold)))
-                            .first;
-                }
-                contact_manifold->second.prune_old_contacts();
-                contact_manifold->second.insert(contacts);
-                new_pairs.insert(id_pair);
-            }
+            collisions.narrow_phase(m_collision_solver, pairs, *a, *b);
         }
     }
-    return new_pairs;
 }
 
-#pragma warning(disable : 4503)  // decorated name length exceeded, name was truncated
-std::set<Collision_strategy::Physics_object_ids>
+void
 Collision_strategy_multi_threaded::solve_outer(
     size_t a_start, size_t a_length, size_t b_start, size_t b_length,
-    const std::vector<std::shared_ptr<Physics_object>>& objects,
-    std::map<Physics_object_ids, Contact_manifold>&     manifolds)
+    const std::vector<std::shared_ptr<Physics_object>>& objects, const Pair_cache& pairs,
+    Collision_buffer& collisions)
 {
-    std::set<Physics_object_ids> new_pairs;
     for (size_t i = a_start; i < a_start + a_length; ++i) {
         auto a = objects[i].get();
         for (size_t j = b_start; j < b_start + b_length; ++j) {
@@ -116,26 +89,9 @@ Collision_strategy_multi_threaded::solve_outer(
             if (!m_collision_solver.broad_phase_intersection(*a, *b)) {
                 continue;
             }
-            std::vector<Contact_manifold::Contact> contacts;
-            if (m_collision_solver.intersection(*a, *b, contacts)) {
-                auto id_pair          = std::make_tuple(a->id(), b->id());
-                auto contact_manifold = manifolds.find(id_pair);
-                if (contact_manifold == manifolds.end()) {
-                    std::unique_lock<std::mutex> lock(m_manifolds_mutex);
-                    contact_manifold =
-                        manifolds
-                            .insert(std::make_pair(
-                                id_pair, Contact_manifold(*a, *b, m_manifold_persistent_threshold,
-                                                          m_manifold_movement_threshold)))
-                            .first;
-                }
-                contact_manifold->second.prune_old_contacts();
-                contact_manifold->second.insert(contacts);
-                new_pairs.insert(id_pair);
-            }
+            collisions.narrow_phase(m_collision_solver, pairs, *a, *b);
         }
     }
-    return new_pairs;
 }
 
 }  // namespace Physics
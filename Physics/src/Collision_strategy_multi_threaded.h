@@ -3,32 +3,29 @@
 
 #include "Collision_strategy.h"
 #include "Collision_solver.h"
-
-#include <set>
-#include <mutex>
+#include "Worker_pool.h"
 
 namespace Dubious {
 namespace Physics {
 
 class Physics_object;
-class Contact_manifold;
+class Pair_cache;
 
 /// @brief Multi-threaded Collision Strategy
 ///
-/// This one uses multiple CPU threads. It makes use of the new
-/// C++11 async and future interface to spin up threads. This
-/// should probably be the fallback option if OpenCL isn't available
+/// This one uses multiple CPU threads. The objects are split into
+/// groups, and each group is checked against itself and every other
+/// group as a separate task. A Worker_pool with a thread for each
+/// core works through the tasks. This should probably be the fallback
+/// option if OpenCL isn't available. Every task gets its own
+/// Collision_buffer, so the threads never share anything they write to.
 class Collision_strategy_multi_threaded : public Collision_strategy {
 public:
     /// @brief Constructor
     ///
-    /// @param manifold_persistent_threshold - [in] see Arena::Settings
-    /// @param manifold_movement_threshold - [in] see Arena::Settings
     /// @param greedy_manifold - [in] see Arena::Settings
     /// @param workgroup_size - [in] see Arena::Settings
-    Collision_strategy_multi_threaded(float manifold_persistent_threshold,
-                                      float manifold_movement_threshold, bool greedy_manifold,
-                                      unsigned int workgroup_size);
+    Collision_strategy_multi_threaded(bool greedy_manifold, unsigned int workgroup_size);
 
     /// @brief Destructor
     ~Collision_strategy_multi_threaded() = default;
@@ -38,23 +35,30 @@ public:
 
     /// @brief See Collision_strategy::find_contacts
     void find_contacts(const std::vector<std::shared_ptr<Physics_object>>& objects,
-                       std::map<Physics_object_ids, Contact_manifold>&     manifolds) final;
+                       Pair_cache&                                         pairs) final;
 
 private:
+    struct Task {
+        bool              inner;
+        size_t            a_start;
+        size_t            a_length;
+        size_t            b_start;
+        size_t            b_length;
+        Collision_buffer* collisions;
+    };
+
     Collision_solver   m_collision_solver;
-    const float        m_manifold_persistent_threshold;
-    const float        m_manifold_movement_threshold;
     const unsigned int m_workgroup_size;
-    std::mutex         m_manifolds_mutex;
+    Worker_pool        m_workers;
+    std::vector<Task>  m_tasks;
 
-    std::set<Physics_object_ids> solve_inner(
-        size_t start, size_t length, const std::vector<std::shared_ptr<Physics_object>>& objects,
-        std::map<Physics_object_ids, Contact_manifold>& manifolds);
+    void solve_inner(size_t start, size_t length,
+                     const std::vector<std::shared_ptr<Physics_object>>& objects,
+                     const Pair_cache& pairs, Collision_buffer& collisions);
 
-    std::set<Physics_object_ids> solve_outer(
-        size_t a_start, size_t a_length, size_t b_start, size_t b_length,
-        const std::vector<std::shared_ptr<Physics_object>>& objects,
-        std::map<Physics_object_ids, Contact_manifold>&     manifolds);
+    void solve_outer(size_t a_start, size_t a_length, size_t b_start, size_t b_length,
+                     const std::vector<std::shared_ptr<Physics_object>>& objects,
+                     const Pair_cache& pairs, Collision_buffer& collisions);
 };
 
 }  // namespace Physics
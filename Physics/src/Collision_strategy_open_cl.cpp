@@ -1,11 +1,9 @@
 #include "Collision_strategy_open_cl.h"
 #include "Physics_object.h"
-#include "Contact_manifold.h"
 #include "Physics_model.h"
 
 #include "Broad_phase.cl"
 
-#include <set>
 #include <future>
 #include <iostream>
 
@@ -13,14 +11,10 @@
 namespace Dubious {
 namespace Physics {
 
-Collision_strategy_open_cl::Collision_strategy_open_cl(float        manifold_persistent_threshold,
-                                                       float        manifold_movement_threshold,
-                                                       bool         greedy_manifold,
+Collision_strategy_open_cl::Collision_strategy_open_cl(bool         greedy_manifold,
                                                        unsigned int collisions_per_thread,
                                                        int          cl_broadphase_work_group_size)
     : m_collision_solver(greedy_manifold)
-    , m_manifold_persistent_threshold(manifold_persistent_threshold)
-    , m_manifold_movement_threshold(manifold_movement_threshold)
     , m_collisions_per_thread(collisions_per_thread)
     , m_cl_broadphase_work_group_size(cl_broadphase_work_group_size)
 {
@@ -91,11 +85,14 @@ Collision_strategy_open_cl::~Collision_strategy_open_cl()
 void
 Collision_strategy_open_cl::find_contacts(
     const std::vector<std::shared_ptr<Physics_object>>& objects,
-    std::map<Physics_object_ids, Contact_manifold>&     manifolds)
+    Pair_cache&                                         pairs)
 {
     size_t                                                    objects_size = objects.size();
     std::vector<std::tuple<Physics_object*, Physics_object*>> object_pairs;
-    std::vector<std::future<std::set<Physics_object_ids>>>    results;
+    std::vector<std::future<void>>                            results;
+    size_t                                                    job = 0;
+
+    clear_buffers();
 
     // inner comparisons
     for (size_t i = 0; i < objects_size; i += m_cl_broadphase_work_group_size) {
@@ -107,7 +104,8 @@ Collision_strategy_open_cl::find_contacts(
             if (object_pairs.size() > m_collisions_per_thread) {
                 results.push_back(std::async(std::launch::async,
                                              &Collision_strategy_open_cl::solve_collisions, this,
-                                             std::move(object_pairs), std::ref(manifolds)));
+                                             std::move(object_pairs), std::cref(pairs),
+                                             std::ref(buffer(job++))));
                 object_pairs.clear();
             }
         }
@@ -132,7 +130,7 @@ Collision_strategy_open_cl::find_contacts(
                 if (object_pairs.size() > m_collisions_per_thread) {
                     results.push_back(std::async(
                         std::launch::async, &Collision_strategy_open_cl::solve_collisions, this,
-                        std::move(object_pairs), std::ref(manifolds)));
+                        std::move(object_pairs), std::cref(pairs), std::ref(buffer(job++))));
                     object_pairs.clear();
                 }
             }
@@ -143,25 +141,15 @@ Collision_strategy_open_cl::find_contacts(
     if (!object_pairs.empty()) {
         results.push_back(std::async(std::launch::async,
                                      &Collision_strategy_open_cl::solve_collisions, this,
-                                     std::move(object_pairs), std::ref(manifolds)));
+                                     std::move(object_pairs), std::cref(pairs),
+                                     std::ref(buffer(job++))));
     }
 
-    // collect results from threads
-    std::set<Physics_object_ids> colliding_pairs;
+    // wait for the threads to finish
     for (auto& result : results) {
-        const auto& result_set = result.get();
-        colliding_pairs.insert(result_set.begin(), result_set.end());
-    }
-
-    // remove any stale contacts
-    for (auto iter = manifolds.begin(), end = manifolds.end(); iter != end;) {
-        if (colliding_pairs.find(iter->first) == colliding_pairs.end()) {
-            manifolds.erase(iter++);
-        }
-        else {
-            ++iter;
-        }
+        result.get();
     }
+    merge_buffers(pairs);
 }
 
 std::vector<std::tuple<size_t, size_t>>
@@ -265,36 +253,15 @@ Collision_strategy_open_cl::openCL_broad_phase_outer(
     return result_vector;
 }
 
-std::set<Collision_strategy::Physics_object_ids>
+void
 Collision_strategy_open_cl::solve_collisions(
-    std::vector<std::tuple<Physics_object*, Physics_object*>>&& inputs,
-    std::map<Physics_object_ids, Contact_manifold>&             manifolds)
+    std::vector<std::tuple<Physics_object*, Physics_object*>>&& inputs, const Pair_cache& pairs,
+    Collision_buffer& collisions)
 {
-    std::set<Physics_object_ids> new_pairs;
     for (const auto& object_tuple : inputs) {
-        std::vector<Contact_manifold::Contact> contacts;
-        if (m_collision_solver.intersection(*std::get<0>(object_tuple), *std::get<1>(object_tuple),
-                                            contacts)) {
-            auto id_pair =
-                std::make_tuple(std::get<0>(object_tuple)->id(), std::get<1>(object_tuple)->id());
-            auto contact_manifold = manifolds.find(id_pair);
-            if (contact_manifold == manifolds.end()) {
-                std::unique_lock<std::mutex> lock(m_manifolds_mutex);
-                contact_manifold =
-                    manifolds
-                        .insert(std::make_pair(
-                            id_pair,
-                            Contact_manifold(*std::get<0>(object_tuple), *std::get<1>(object_tuple),
-                                             m_manifold_persistent_threshold,
-                                             m_manifold_movement_threshold)))
-                        .first;
-            }
-            contact_manifold->second.prune_old_contacts();
-            contact_manifold->second.insert(contacts);
-            new_pairs.insert(id_pair);
-        }
+        collisions.narrow_phase(m_collision_solver, pairs, *std::get<0>(object_tuple),
+                                *std::get<1>(object_tuple));
     }
-    return new_pairs;
 }
 
 }  // namespace Physics
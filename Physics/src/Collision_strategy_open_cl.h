@@ -5,14 +5,11 @@
 #include "Collision_solver.h"
 #include "Open_cl.h"
 
-#include <set>
-#include <mutex>
-
 namespace Dubious {
 namespace Physics {
 
 class Physics_object;
-class Contact_manifold;
+class Pair_cache;
 
 /// @brief Collision Strategy using OpenCL
 ///
@@ -23,15 +20,11 @@ class Collision_strategy_open_cl : public Collision_strategy {
 public:
     /// @brief Constructor
     ///
-    /// @param manifold_persistent_threshold - [in] see Arena::Settings
-    /// @param manifold_movement_threshold - [in] see Arena::Settings
     /// @param greedy_manifold - [in] see Arena::Settings
     /// @param collisions_per_thread - [in] see Arena::Settings
     /// @param cl_broadphase_work_group_size - [in] see Arena::Settings
-    Collision_strategy_open_cl(float manifold_persistent_threshold,
-                               float manifold_movement_threshold, bool greedy_manifold,
-                               unsigned int collisions_per_thread,
-                               int          cl_broadphase_work_group_size);
+    Collision_strategy_open_cl(bool greedy_manifold, unsigned int collisions_per_thread,
+                               int cl_broadphase_work_group_size);
 
     /// @brief Destructor
     ~Collision_strategy_open_cl();
@@ -41,15 +34,12 @@ public:
 
     /// @brief See Collision_strategy::find_contacts
     void find_contacts(const std::vector<std::shared_ptr<Physics_object>>& objects,
-                       std::map<Physics_object_ids, Contact_manifold>&     manifolds) final;
+                       Pair_cache&                                         pairs) final;
 
 private:
     Collision_solver   m_collision_solver;
-    const float        m_manifold_persistent_threshold;
-    const float        m_manifold_movement_threshold;
     const unsigned int m_collisions_per_thread;
     const int          m_cl_broadphase_work_group_size;
-    std::mutex         m_manifolds_mutex;
 
     cl_platform_id   m_platform_id;
     cl_device_id     m_device_id;
@@ -64,9 +54,8 @@ private:
     cl_float*        m_broad_phase_objects = nullptr;
     cl_char*         m_broad_phase_results = nullptr;
 
-    std::set<Physics_object_ids> solve_collisions(
-        std::vector<std::tuple<Physics_object*, Physics_object*>>&& inputs,
-        std::map<Physics_object_ids, Contact_manifold>&             manifolds);
+    void solve_collisions(std::vector<std::tuple<Physics_object*, Physics_object*>>&& inputs,
+                          const Pair_cache& pairs, Collision_buffer& collisions);
     std::vector<std::tuple<size_t, size_t>> openCL_broad_phase_inner(
         const std::vector<std::shared_ptr<Physics_object>>& objects, size_t offset, size_t length);
     std::vector<std::tuple<size_t, size_t>> openCL_broad_phase_outer(
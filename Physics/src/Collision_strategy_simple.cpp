@@ -1,27 +1,22 @@
 #include "Collision_strategy_simple.h"
 #include "Physics_object.h"
-#include "Contact_manifold.h"
-
-#include <set>
+#include "Pair_cache.h"
 
 namespace Dubious {
 namespace Physics {
 
-Collision_strategy_simple::Collision_strategy_simple(float manifold_persistent_threshold,
-                                                     float manifold_movement_threshold,
-                                                     bool  greedy_manifold)
+Collision_strategy_simple::Collision_strategy_simple(bool greedy_manifold)
     : m_collision_solver(greedy_manifold)
-    , m_manifold_persistent_threshold(manifold_persistent_threshold)
-    , m_manifold_movement_threshold(manifold_movement_threshold)
 {
 }
 
 void
 Collision_strategy_simple::find_contacts(
     const std::vector<std::shared_ptr<Physics_object>>& objects,
-    std::map<Physics_object_ids, Contact_manifold>&     manifolds)
+    Pair_cache&                                         pairs)
 {
-    std::set<Physics_object_ids> new_pairs;
+    clear_buffers();
+    Collision_buffer& collisions = buffer(0);
     for (size_t i = 0; i < objects.size(); ++i) {
         auto a = objects[i].get();
         for (size_t j = i + 1; j < objects.size(); ++j) {
@@ -29,33 +24,10 @@ Collision_strategy_simple::find_contacts(
             if (!m_collision_solver.broad_phase_intersection(*a, *b)) {
                 continue;
             }
-            std::vector<Contact_manifold::Contact> contacts;
-            if (m_collision_solver.intersection(*a, *b, contacts)) {
-                auto id_pair          = std::make_tuple(a->id(), b->id());
-                auto contact_manifold = manifolds.find(id_pair);
-                if (contact_manifold == manifolds.end()) {
-                    contact_manifold =
-                        manifolds
-                            .insert(std::make_pair(
-                                id_pair, Contact_manifold(*a, *b, m_manifold_persistent_threshold,
-                                                          m_manifold_movement_threshold)))
-                            .first;
-                }
-                contact_manifold->second.prune_old_contacts();
-                contact_manifold->second.insert(contacts);
-                new_pairs.insert(id_pair);
-            }
-        }
-    }
-    // remove any stale contacts
-    for (auto iter = manifolds.begin(), end = manifolds.end(); iter != end;) {
-        if (new_pairs.find(iter->first) == new_pairs.end()) {
-            manifolds.erase(iter++);
-        }
-        else {
-            ++iter;
+            collisions.narrow_phase(m_collision_solver, pairs, *a, *b);
         }
     }
+    merge_buffers(pairs);
 }
 
 }  // namespace Physics
@@ -8,7 +8,7 @@ namespace Dubious {
 namespace Physics {
 
 class Physics_object;
-class Contact_manifold;
+class Pair_cache;
 
 /// @brief Simple, single threaded Collision Strategy
 ///
@@ -20,11 +20,8 @@ class Collision_strategy_simple : public Collision_strategy {
 public:
     /// @brief Constructor
     ///
-    /// @param manifold_persistent_threshold - [in] see Arena::Settings
-    /// @param manifold_movement_threshold - [in] see Arena::Settings
     /// @param greedy_manifold - [in] see Arena::Settings
-    Collision_strategy_simple(float manifold_persistent_threshold,
-                              float manifold_movement_threshold, bool greedy_manifold);
+    Collision_strategy_simple(bool greedy_manifold);
 
     /// @brief Destructor
     ~Collision_strategy_simple() = default;
@@ -34,12 +31,10 @@ public:
 
     /// @brief See Collision_strategy::find_contacts
     void find_contacts(const std::vector<std::shared_ptr<Physics_object>>& m_objects,
-                       std::map<Physics_object_ids, Contact_manifold>&     manifolds) final;
+                       Pair_cache&                                         pairs) final;
 
 private:
     Collision_solver m_collision_solver;
-    const float      m_manifold_persistent_threshold;
-    const float      m_manifold_movement_threshold;
 };
 
 }  // namespace Physics
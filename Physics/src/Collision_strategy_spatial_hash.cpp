@@ -0,0 +1,169 @@
+#include "Collision_strategy_spatial_hash.h"
+#include "Physics_object.h"
+#include "Physics_model.h"
+#include "Pair_cache.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Dubious {
+namespace Physics {
+
+namespace {
+uint32_t
+hash_cell(const int cell[3])
+{
+    // Large primes from "Optimized Spatial Hashing for Collision Detection of
+    // Deformable Objects", Teschner et al.
+    return (static_cast<uint32_t>(cell[0]) * 73856093u) ^
+           (static_cast<uint32_t>(cell[1]) * 19349663u) ^
+           (static_cast<uint32_t>(cell[2]) * 83492791u);
+}
+}
+
+Collision_strategy_spatial_hash::Collision_strategy_spatial_hash(bool  greedy_manifold,
+                                                                 float grid_cell_size)
+    : m_collision_solver(greedy_manifold)
+    , m_inverse_cell_size(1.0f / grid_cell_size)
+{
+}
+
+void
+Collision_strategy_spatial_hash::find_contacts(
+    const std::vector<std::shared_ptr<Physics_object>>& objects,
+    Pair_cache&                                         pairs)
+{
+    build_table(objects);
+    find_pairs(objects.size());
+
+    clear_buffers();
+    Collision_buffer& collisions = buffer(0);
+    for (const auto& pair : m_pairs) {
+        auto a = objects[std::get<0>(pair)].get();
+        auto b = objects[std::get<1>(pair)].get();
+        if (!m_collision_solver.broad_phase_intersection(*a, *b)) {
+            continue;
+        }
+        collisions.narrow_phase(m_collision_solver, pairs, *a, *b);
+    }
+    merge_buffers(pairs);
+}
+
+void
+Collision_strategy_spatial_hash::build_table(
+    const std::vector<std::shared_ptr<Physics_object>>& objects)
+{
+    // Work out which cells every object touches, and make an entry for each
+    m_ranges.resize(objects.size());
+    m_large.clear();
+    m_unsorted.clear();
+    for (size_t i = 0; i < objects.size(); ++i) {
+        const auto& position  = objects[i]->coordinate_space().position();
+        const float radius    = objects[i]->model().radius();
+        const float center[3] = {position.x(), position.y(), position.z()};
+        auto&       range     = m_ranges[i];
+        for (int axis = 0; axis < 3; ++axis) {
+            range.min[axis] =
+                static_cast<int>(std::floor((center[axis] - radius) * m_inverse_cell_size));
+            range.max[axis] =
+                static_cast<int>(std::floor((center[axis] + radius) * m_inverse_cell_size));
+        }
+        range.large = range.max[0] - range.min[0] >= MAX_CELLS_PER_AXIS ||
+                      range.max[1] - range.min[1] >= MAX_CELLS_PER_AXIS ||
+                      range.max[2] - range.min[2] >= MAX_CELLS_PER_AXIS;
+        if (range.large) {
+            m_large.push_back(i);
+            continue;
+        }
+        Entry entry;
+        entry.object = i;
+        for (int x = range.min[0]; x <= range.max[0]; ++x) {
+            for (int y = range.min[1]; y <= range.max[1]; ++y) {
+                for (int z = range.min[2]; z <= range.max[2]; ++z) {
+                    entry.cell[0] = x;
+                    entry.cell[1] = y;
+                    entry.cell[2] = z;
+                    m_unsorted.push_back(entry);
+                }
+            }
+        }
+    }
+
+    // The table is a power of two at least twice the number of entries, which
+    // keeps the buckets short and lets us mask instead of mod.
+    uint32_t table_size = 1;
+    while (table_size < m_unsorted.size() * 2) {
+        table_size <<= 1;
+    }
+    const uint32_t mask = table_size - 1;
+
+    // Counting sort the entries by bucket. After the running total each start
+    // points at the end of its bucket, then filling from the back walks each
+    // one down to the real start (and keeps the entries in order).
+    m_bucket_starts.assign(table_size + 1, 0);
+    for (auto& entry : m_unsorted) {
+        entry.bucket = hash_cell(entry.cell) & mask;
+        ++m_bucket_starts[entry.bucket];
+    }
+    for (uint32_t i = 1; i < table_size; ++i) {
+        m_bucket_starts[i] += m_bucket_starts[i - 1];
+    }
+    m_bucket_starts[table_size] = static_cast<uint32_t>(m_unsorted.size());
+    m_entries.resize(m_unsorted.size());
+    for (auto iter = m_unsorted.rbegin(), end = m_unsorted.rend(); iter != end; ++iter) {
+        m_entries[--m_bucket_starts[iter->bucket]] = *iter;
+    }
+}
+
+void
+Collision_strategy_spatial_hash::find_pairs(size_t object_count)
+{
+    // The large objects aren't in the grid, they're paired with everything
+    m_pairs.clear();
+    for (size_t k = 0; k < m_large.size(); ++k) {
+        const size_t large = m_large[k];
+        for (size_t i = 0; i < object_count; ++i) {
+            if (!m_ranges[i].large) {
+                m_pairs.push_back(std::make_tuple(std::min(i, large), std::max(i, large)));
+            }
+        }
+        for (size_t j = k + 1; j < m_large.size(); ++j) {
+            m_pairs.push_back(std::make_tuple(large, m_large[j]));
+        }
+    }
+
+    // Two objects may share several cells, and different cells may land in the
+    // same bucket. So a pair is only reported from its "home" cell, which is
+    // the lowest corner of the cells the two objects have in common.
+    const uint32_t table_size = static_cast<uint32_t>(m_bucket_starts.size()) - 1;
+    for (uint32_t bucket = 0; bucket < table_size; ++bucket) {
+        const uint32_t begin = m_bucket_starts[bucket];
+        const uint32_t end   = m_bucket_starts[bucket + 1];
+        for (uint32_t i = begin; i < end; ++i) {
+            const Entry& a = m_entries[i];
+            for (uint32_t j = i + 1; j < end; ++j) {
+                const Entry& b = m_entries[j];
+                if (a.object == b.object || a.cell[0] != b.cell[0] || a.cell[1] != b.cell[1] ||
+                    a.cell[2] != b.cell[2]) {
+                    continue;
+                }
+                const Cell_range& range_a = m_ranges[a.object];
+                const Cell_range& range_b = m_ranges[b.object];
+                bool              home    = true;
+                for (int axis = 0; axis < 3; ++axis) {
+                    if (a.cell[axis] != std::max(range_a.min[axis], range_b.min[axis])) {
+                        home = false;
+                        break;
+                    }
+                }
+                if (home) {
+                    m_pairs.push_back(std::make_tuple(std::min(a.object, b.object),
+                                                      std::max(a.object, b.object)));
+                }
+            }
+        }
+    }
+}
+
+}  // namespace Physics
+}  // namespace Dubious
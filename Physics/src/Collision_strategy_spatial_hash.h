@@ -0,0 +1,79 @@
+#ifndef INCLUDED_PHYSICS_COLLISIONSTRATEGYSPATIALHASH
+#define INCLUDED_PHYSICS_COLLISIONSTRATEGYSPATIALHASH
+
+#include "Collision_strategy.h"
+#include "Collision_solver.h"
+
+#include <cstdint>
+
+namespace Dubious {
+namespace Physics {
+
+class Physics_object;
+class Pair_cache;
+
+/// @brief Spatial Hash Collision Strategy
+///
+/// Space is chopped up into a uniform grid of cubes and each object is put
+/// into every cell that its bounding sphere's box touches. Only objects that
+/// share a cell are tested against each other. The cells are hashed into a
+/// table which is rebuilt from scratch each step with a counting sort, so the
+/// build is linear in the number of objects. This works best when all of the
+/// objects are roughly the same size, and the cell size is a bit bigger than
+/// the objects. Something that would cover more than a few cells on any axis
+/// (like the floor) isn't put in the grid at all. Those go in a separate list
+/// and are tested against every other object, which is a lot cheaper than
+/// putting the floor in thousands of cells every step.
+class Collision_strategy_spatial_hash : public Collision_strategy {
+public:
+    /// @brief Constructor
+    ///
+    /// @param greedy_manifold - [in] see Arena::Settings
+    /// @param grid_cell_size - [in] see Arena::Settings
+    Collision_strategy_spatial_hash(bool greedy_manifold, float grid_cell_size);
+
+    /// @brief Destructor
+    ~Collision_strategy_spatial_hash() = default;
+
+    Collision_strategy_spatial_hash(const Collision_strategy_spatial_hash&) = delete;
+    Collision_strategy_spatial_hash& operator=(const Collision_strategy_spatial_hash&) = delete;
+
+    /// @brief See Collision_strategy::find_contacts
+    void find_contacts(const std::vector<std::shared_ptr<Physics_object>>& objects,
+                       Pair_cache&                                         pairs) final;
+
+private:
+    // Objects that would cover more cells than this on any axis go in m_large
+    static const int MAX_CELLS_PER_AXIS = 4;
+
+    struct Cell_range {
+        int  min[3];
+        int  max[3];
+        bool large;
+    };
+
+    struct Entry {
+        int      cell[3];
+        uint32_t bucket;
+        size_t   object;
+    };
+
+    Collision_solver m_collision_solver;
+    const float      m_inverse_cell_size;
+
+    // These are rebuilt every step, they're only members so the memory is reused
+    std::vector<Cell_range>                 m_ranges;
+    std::vector<size_t>                     m_large;
+    std::vector<Entry>                      m_unsorted;
+    std::vector<Entry>                      m_entries;
+    std::vector<uint32_t>                   m_bucket_starts;
+    std::vector<std::tuple<size_t, size_t>> m_pairs;
+
+    void build_table(const std::vector<std::shared_ptr<Physics_object>>& objects);
+    void find_pairs(size_t object_count);
+};
+
+}  // namespace Physics
+}  // namespace Dubious
+
+#endif
@@ -0,0 +1,152 @@
+#include "Collision_strategy_sweep_and_prune.h"
+#include "Physics_object.h"
+#include "Physics_model.h"
+#include "Pair_cache.h"
+
+#include <algorithm>
+
+namespace Dubious {
+namespace Physics {
+
+Collision_strategy_sweep_and_prune::Collision_strategy_sweep_and_prune(bool greedy_manifold)
+    : m_collision_solver(greedy_manifold)
+{
+}
+
+void
+Collision_strategy_sweep_and_prune::find_contacts(
+    const std::vector<std::shared_ptr<Physics_object>>& objects,
+    Pair_cache&                                         pairs)
+{
+    if (objects.size() != m_bounds.size()) {
+        rebuild(objects);
+    }
+    else {
+        update_bounds(objects);
+        for (int axis = 0; axis < 3; ++axis) {
+            sort_axis(axis);
+        }
+    }
+
+    clear_buffers();
+    Collision_buffer& collisions = buffer(0);
+    for (const auto& pair : m_overlapping_pairs) {
+        auto a = objects[std::get<0>(pair)].get();
+        auto b = objects[std::get<1>(pair)].get();
+        if (!m_collision_solver.broad_phase_intersection(*a, *b)) {
+            continue;
+        }
+        collisions.narrow_phase(m_collision_solver, pairs, *a, *b);
+    }
+    merge_buffers(pairs);
+}
+
+void
+Collision_strategy_sweep_and_prune::update_bounds(
+    const std::vector<std::shared_ptr<Physics_object>>& objects)
+{
+    for (size_t i = 0; i < objects.size(); ++i) {
+        const auto& position = objects[i]->coordinate_space().position();
+        const float radius   = objects[i]->model().radius();
+        auto&       bounds   = m_bounds[i];
+        bounds.min[0]        = position.x() - radius;
+        bounds.min[1]        = position.y() - radius;
+        bounds.min[2]        = position.z() - radius;
+        bounds.max[0]        = position.x() + radius;
+        bounds.max[1]        = position.y() + radius;
+        bounds.max[2]        = position.z() + radius;
+    }
+    for (int axis = 0; axis < 3; ++axis) {
+        for (auto& endpoint : m_endpoints[axis]) {
+            endpoint.value = endpoint.is_min ? m_bounds[endpoint.object].min[axis]
+                                             : m_bounds[endpoint.object].max[axis];
+        }
+    }
+}
+
+void
+Collision_strategy_sweep_and_prune::rebuild(
+    const std::vector<std::shared_ptr<Physics_object>>& objects)
+{
+    // Starting from scratch there's no coherence to take advantage of, so just
+    // sort everything and sweep the x axis once to find the overlapping pairs.
+    m_bounds.resize(objects.size());
+    for (int axis = 0; axis < 3; ++axis) {
+        m_endpoints[axis].clear();
+        m_endpoints[axis].reserve(objects.size() * 2);
+        for (size_t i = 0; i < objects.size(); ++i) {
+            m_endpoints[axis].push_back(Endpoint{0, i, true});
+            m_endpoints[axis].push_back(Endpoint{0, i, false});
+        }
+    }
+    update_bounds(objects);
+    for (int axis = 0; axis < 3; ++axis) {
+        std::sort(m_endpoints[axis].begin(), m_endpoints[axis].end(),
+                  [](const Endpoint& a, const Endpoint& b) { return a.value < b.value; });
+    }
+
+    m_overlapping_pairs.clear();
+    std::vector<size_t> active;
+    for (const auto& endpoint : m_endpoints[0]) {
+        if (endpoint.is_min) {
+            for (auto other : active) {
+                if (overlaps(endpoint.object, other)) {
+                    m_overlapping_pairs.insert(std::make_tuple(std::min(endpoint.object, other),
+                                                               std::max(endpoint.object, other)));
+                }
+            }
+            active.push_back(endpoint.object);
+        }
+        else {
+            active.erase(std::find(active.begin(), active.end(), endpoint.object));
+        }
+    }
+}
+
+void
+Collision_strategy_sweep_and_prune::sort_axis(int axis)
+{
+    // Insertion sort. Every time a min passes to the left of a max those two
+    // boxes may have started overlapping, and every time a max passes to the
+    // left of a min they've definitely stopped. Passing a min past a min (or
+    // max past a max) doesn't change anything.
+    auto& endpoints = m_endpoints[axis];
+    for (size_t i = 1; i < endpoints.size(); ++i) {
+        const Endpoint endpoint = endpoints[i];
+        size_t         j        = i;
+        while (j > 0 && endpoints[j - 1].value > endpoint.value) {
+            const Endpoint& other = endpoints[j - 1];
+            if (endpoint.is_min != other.is_min) {
+                auto pair = std::make_tuple(std::min(endpoint.object, other.object),
+                                            std::max(endpoint.object, other.object));
+                if (endpoint.is_min) {
+                    if (overlaps(endpoint.object, other.object)) {
+                        m_overlapping_pairs.insert(pair);
+                    }
+                }
+                else {
+                    m_overlapping_pairs.erase(pair);
+                }
+            }
+            endpoints[j] = other;
+            --j;
+        }
+        endpoints[j] = endpoint;
+    }
+}
+
+bool
+Collision_strategy_sweep_and_prune::overlaps(size_t a, size_t b) const
+{
+    const auto& bounds_a = m_bounds[a];
+    const auto& bounds_b = m_bounds[b];
+    for (int axis = 0; axis < 3; ++axis) {
+        if (bounds_a.max[axis] < bounds_b.min[axis] || bounds_b.max[axis] < bounds_a.min[axis]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace Physics
+}  // namespace Dubious
@@ -0,0 +1,73 @@
+#ifndef INCLUDED_PHYSICS_COLLISIONSTRATEGYSWEEPANDPRUNE
+#define INCLUDED_PHYSICS_COLLISIONSTRATEGYSWEEPANDPRUNE
+
+#include "Collision_strategy.h"
+#include "Collision_solver.h"
+
+#include <set>
+
+namespace Dubious {
+namespace Physics {
+
+class Physics_object;
+class Pair_cache;
+
+/// @brief Sweep and Prune Collision Strategy
+///
+/// Each object is wrapped in an axis aligned box (built from its position and
+/// radius) and the start and end of those boxes are kept in a sorted list for
+/// each axis. The lists are kept between calls, and since most things don't
+/// move very far in one time step they're almost sorted when we get them back.
+/// An insertion sort on almost sorted data is close to linear, and every swap
+/// it makes tells us that a pair of boxes either started or stopped overlapping.
+/// So rather than testing every pair every step we only narrow phase the pairs
+/// whose boxes overlap on all three axis.
+/// http://www.codercorner.com/SAP.pdf
+class Collision_strategy_sweep_and_prune : public Collision_strategy {
+public:
+    /// @brief Constructor
+    ///
+    /// @param greedy_manifold - [in] see Arena::Settings
+    Collision_strategy_sweep_and_prune(bool greedy_manifold);
+
+    /// @brief Destructor
+    ~Collision_strategy_sweep_and_prune() = default;
+
+    Collision_strategy_sweep_and_prune(const Collision_strategy_sweep_and_prune&) = delete;
+    Collision_strategy_sweep_and_prune& operator=(const Collision_strategy_sweep_and_prune&) =
+        delete;
+
+    /// @brief See Collision_strategy::find_contacts
+    void find_contacts(const std::vector<std::shared_ptr<Physics_object>>& objects,
+                       Pair_cache&                                         pairs) final;
+
+private:
+    struct Endpoint {
+        float  value;
+        size_t object;
+        bool   is_min;
+    };
+
+    struct Bounds {
+        float min[3];
+        float max[3];
+    };
+
+    Collision_solver m_collision_solver;
+
+    // These all persist between calls to find_contacts. The objects are referred to by their
+    // index in the objects vector, so if that changes size we throw it all away and start again.
+    std::vector<Bounds>                  m_bounds;
+    std::vector<Endpoint>                m_endpoints[3];
+    std::set<std::tuple<size_t, size_t>> m_overlapping_pairs;
+
+    void update_bounds(const std::vector<std::shared_ptr<Physics_object>>& objects);
+    void rebuild(const std::vector<std::shared_ptr<Physics_object>>& objects);
+    void sort_axis(int axis);
+    bool overlaps(size_t a, size_t b) const;
+};
+
+}  // namespace Physics
+}  // namespace Dubious
+
+#endif
@@ -10,6 +10,14 @@
 namespace Dubious {
 namespace Physics {
 
+Constraint_solver::Body::Body(const Physics_object& object)
+    : velocity(object.velocity())
+    , angular_velocity(object.angular_velocity())
+    , inverse_mass(object.inverse_mass())
+    , inverse_moment_of_inertia(object.inverse_moment_of_inertia())
+{
+}
+
 Constraint_solver::Constraint_solver(float time_step, float beta, float cor, float slop)
     : m_time_step(time_step), m_beta(beta), m_coefficient_of_restitution(cor), m_slop(slop)
 {
@@ -26,169 +34,181 @@ baumgarte_term(float time_step, float beta, float penetration_depth)
     return -(beta / time_step) * penetration_depth;
 }
 
-// The restitution part responds stronger to objects that are moving faster. This
-// will add bounce to high speed collisions, and have almost no effect for low
-// speed collisions. This can be tweaked with the coefficient of restitution
+// One over the effective mass of the two objects for an impulse along a direction. The moment
+// of inertia is the same about every axis, so it only scales the angular part.
 float
-restitution_term(const Math::Vector& n, float coefficient_of_restitution, const Math::Vector& r_a,
-                 const Math::Vector& r_b, const Math::Vector& v_a, const Math::Vector& av_a,
-                 const Math::Vector& v_b, const Math::Vector& av_b)
+inverse_effective_mass(float inverse_ma, float inverse_mb, float inverse_ia, float inverse_ib,
+                       const Math::Vector& ra_x_d, const Math::Vector& rb_x_d)
 {
-    Math::Vector a_part = -v_a - Math::cross_product(av_a, r_a);
-    Math::Vector b_part = v_b + Math::cross_product(av_b, r_b);
+    const float mass = inverse_ma + inverse_mb + inverse_ia * ra_x_d.length_squared() +
+                       inverse_ib * rb_x_d.length_squared();
+    return mass > 0 ? 1.0f / mass : 0.0f;
+}
 
-    return Math::dot_product((a_part + b_part) * coefficient_of_restitution, n);
+// How fast the contact points are moving into each other along a direction
+float
+relative_velocity(const Math::Vector& d, const Math::Vector& ra_x_d, const Math::Vector& rb_x_d,
+                  const Constraint_solver::Body& a, const Constraint_solver::Body& b)
+{
+    return Math::dot_product((b.velocity - a.velocity), d) +
+           Math::dot_product(rb_x_d, b.angular_velocity) -
+           Math::dot_product(ra_x_d, a.angular_velocity);
 }
 
-// We take a local copy of an object's velocity so that we can update it without writing back to the
-// underlying object. This allows us to resolve collision in parallel
-struct Object {
-    Object(const Physics_object& p)
-        : v(p.velocity())
-        , w(p.angular_velocity())
-        , inverse_mass(p.inverse_mass())
-        , inverse_moment_of_inertia(p.inverse_moment_of_inertia())
-    {
-    }
-    Math::Vector v;
-    Math::Vector w;
-    float        inverse_mass;
-    float        inverse_moment_of_inertia;
-};
+// Push the objects apart by an impulse of lambda along a direction
+void
+apply(float lambda, const Math::Vector& d, const Math::Vector& ra_x_d, const Math::Vector& rb_x_d,
+      Constraint_solver::Body& a, Constraint_solver::Body& b)
+{
+    a.velocity -= d * (lambda * a.inverse_mass);
+    a.angular_velocity -= ra_x_d * (lambda * a.inverse_moment_of_inertia);
+    b.velocity += d * (lambda * b.inverse_mass);
+    b.angular_velocity += rb_x_d * (lambda * b.inverse_moment_of_inertia);
+}
+
+}  // namespace
 
 // This seems to be a pretty vanilla formula for impulse I found at
 // https://www.euclideanspace.com/physics/dynamics/collision/threed/index.htm
 //
+// lambda = -(bias + relative velocity along n) / effective mass
+//
 // It's been augmented by the baumgarte and restitution ideas I've picked up from Erin Cotto's work.
 // These are both fake forces to respond when normal simulation breaks down
-float
-impulse(const Math::Vector& n, const Math::Vector& r_a, const Math::Vector& r_b, const Object& a,
-        const Object& b, float penetration_depth, float slop, float dt, float beta, float cor)
+//  - baumgarte   : greater then penetration depth is deeper
+//  - restitution : greater when incident collision velocity is greater
+// The restitution part is the coefficient of restitution times the relative velocity along n,
+// which is the same velocity the impulse is worked out from. So rather than a bias it's kept as
+// a scale on that velocity, and nothing here depends on the velocities.
+void
+Constraint_solver::begin_step()
 {
-    const Math::Vector& va         = a.v;
-    const Math::Vector& wa         = a.w;
-    const Math::Vector& vb         = b.v;
-    const Math::Vector& wb         = b.w;
-    const Math::Vector& ra_x_n     = Math::cross_product(r_a, n);
-    const Math::Vector& rb_x_n     = Math::cross_product(r_b, n);
-    const float         inverse_ma = a.inverse_mass;
-    const float         inverse_mb = b.inverse_mass;
-    const float         inverse_ia = a.inverse_moment_of_inertia;
-    const float         inverse_ib = b.inverse_moment_of_inertia;
-
-    // baumgarte and restitution are fake forces.
-    //  - baumgarte   : greater then penetration depth is deeper
-    //  - restitution : creater when incident collision velocity is greater
-    float baumgarte   = 0;
-    float restitution = 0;
-    if (penetration_depth > slop) {
-        baumgarte   = baumgarte_term(dt, beta, penetration_depth);
-        restitution = restitution_term(n, cor, r_a, r_b, va, wa, vb, wb);
-    }
-
-    return -1 *
-           (baumgarte + restitution +
-            (Math::dot_product((vb - va), n) + Math::dot_product(rb_x_n, wb) -
-             Math::dot_product(ra_x_n, wa))) /
-           (inverse_ma + inverse_mb + Math::dot_product(ra_x_n, inverse_ia * ra_x_n) +
-            Math::dot_product(rb_x_n, inverse_ib * rb_x_n));
+    m_prepared.clear();
+    m_contacts.clear();
 }
 
-float
-friction_impulse(const Math::Vector& t, const Math::Vector& r_a, const Math::Vector& r_b,
-                 const Object& a, const Object& b)
+size_t
+Constraint_solver::prepare(Contact_manifold& contact_manifold, int body_a, int body_b)
 {
-    return impulse(t, r_a, r_b, a, b, 0, 0, 0, 0, 0);
+    m_prepared.push_back(Prepared_manifold{&contact_manifold, body_a, body_b, m_contacts.size()});
+
+    const Physics_object& a          = contact_manifold.object_a();
+    const Physics_object& b          = contact_manifold.object_b();
+    const float           inverse_ma = a.inverse_mass();
+    const float           inverse_mb = b.inverse_mass();
+    const float           inverse_ia = a.inverse_moment_of_inertia();
+    const float           inverse_ib = b.inverse_moment_of_inertia();
+
+    const auto contacts = contact_manifold.contacts();
+    for (size_t i = 0; i < contacts.size(); ++i) {
+        const Contact_manifold::Persistent_contact& c = contacts[i];
+        m_contacts.push_back(Prepared_contact());
+        Prepared_contact& p = m_contacts.back();
+
+        const Math::Vector r_a = a.coordinate_space().transform(Math::to_vector(c.local_point_a));
+        const Math::Vector r_b = b.coordinate_space().transform(Math::to_vector(c.local_point_b));
+        const Math::Vector n   = Math::Vector(c.normal);
+        const Math::Vector t1  = Math::Vector(c.tangent1);
+        const Math::Vector t2  = Math::Vector(c.tangent2);
+        p.ra_x_n               = Math::cross_product(r_a, n);
+        p.rb_x_n               = Math::cross_product(r_b, n);
+        p.ra_x_t1              = Math::cross_product(r_a, t1);
+        p.rb_x_t1              = Math::cross_product(r_b, t1);
+        p.ra_x_t2              = Math::cross_product(r_a, t2);
+        p.rb_x_t2              = Math::cross_product(r_b, t2);
+        p.normal_mass   = inverse_effective_mass(inverse_ma, inverse_mb, inverse_ia, inverse_ib,
+                                               p.ra_x_n, p.rb_x_n);
+        p.tangent1_mass = inverse_effective_mass(inverse_ma, inverse_mb, inverse_ia, inverse_ib,
+                                                 p.ra_x_t1, p.rb_x_t1);
+        p.tangent2_mass = inverse_effective_mass(inverse_ma, inverse_mb, inverse_ia, inverse_ib,
+                                                 p.ra_x_t2, p.rb_x_t2);
+        p.bias           = 0;
+        p.velocity_scale = 1;
+        if (c.penetration_depth > m_slop) {
+            p.bias           = baumgarte_term(m_time_step, m_beta, c.penetration_depth);
+            p.velocity_scale = 1 + m_coefficient_of_restitution;
+        }
+    }
+    return m_prepared.size() - 1;
 }
 
-}  // namespace
-
 void
-Constraint_solver::warm_start(Contact_manifold& contact_manifold)
+Constraint_solver::warm_start(size_t index, std::vector<Body>& bodies) const
 {
-    Physics_object& a = contact_manifold.object_a();
-    Physics_object& b = contact_manifold.object_b();
-    for (const auto& c : contact_manifold.contacts()) {
-        Math::Vector r_a = c.contact_point_a - a.coordinate_space().position();
-        Math::Vector r_b = c.contact_point_b - b.coordinate_space().position();
-
-        Math::Vector P = c.normal_impulse * c.normal;
-
-        a.velocity() -= P * a.inverse_mass();
-        a.angular_velocity() -= a.inverse_moment_of_inertia() * Math::cross_product(r_a, P);
-
-        b.velocity() += P * b.inverse_mass();
-        b.angular_velocity() += b.inverse_moment_of_inertia() * Math::cross_product(r_b, P);
+    const Prepared_manifold& prepared = m_prepared[index];
+    Body&                    a        = bodies[prepared.body_a];
+    Body&                    b        = bodies[prepared.body_b];
+    const auto               contacts = prepared.manifold->contacts();
+    for (size_t i = 0; i < contacts.size(); ++i) {
+        const Contact_manifold::Persistent_contact& c = contacts[i];
+        const Prepared_contact&                     p = m_contacts[prepared.first_contact + i];
+
+        apply(c.normal_impulse, c.normal, p.ra_x_n, p.rb_x_n, a, b);
     }
 }
 
 void
-Constraint_solver::solve(Contact_manifold& contact_manifold)
+Constraint_solver::solve(size_t index, std::vector<Body>& bodies) const
 {
-    if (contact_manifold.contacts().empty()) {
+    const Prepared_manifold& prepared = m_prepared[index];
+    const auto               contacts = prepared.manifold->contacts();
+    if (contacts.empty()) {
         return;
     }
+    const Prepared_contact* prepared_contacts = &m_contacts[prepared.first_contact];
 
-    Physics_object& a = contact_manifold.object_a();
-    Object          obj_a(a);
-    Physics_object& b = contact_manifold.object_b();
-    Object          obj_b(b);
+    // Work on copies so that the bodies of stationary objects are never written to. Any number
+    // of manifolds being solved at once can share one of those.
+    Body obj_a = bodies[prepared.body_a];
+    Body obj_b = bodies[prepared.body_b];
 
-    for (auto& c : contact_manifold.contacts()) {
-        Math::Vector r_a = c.contact_point_a - a.coordinate_space().position();
-        Math::Vector r_b = c.contact_point_b - b.coordinate_space().position();
+    // Friction first. Both directions are worked out from the same velocities and then applied
+    // together.
+    for (size_t i = 0; i < contacts.size(); ++i) {
+        Contact_manifold::Persistent_contact& c = contacts[i];
+        const Prepared_contact&               p = prepared_contacts[i];
 
         const float FRICTION     = 0.3f;
         float       max_friction = FRICTION * c.normal_impulse;
 
-        float lambda1 = friction_impulse(c.tangent1, r_a, r_b, obj_a, obj_b);
+        float lambda1 = -relative_velocity(c.tangent1, p.ra_x_t1, p.rb_x_t1, obj_a, obj_b) *
+                        p.tangent1_mass;
         float new_impulse =
             std::max(-max_friction, std::min(max_friction, c.tangent1_impulse + lambda1));
         lambda1            = new_impulse - c.tangent1_impulse;
         c.tangent1_impulse = new_impulse;
 
-        float lambda2 = friction_impulse(c.tangent2, r_a, r_b, obj_a, obj_b);
+        float lambda2 = -relative_velocity(c.tangent2, p.ra_x_t2, p.rb_x_t2, obj_a, obj_b) *
+                        p.tangent2_mass;
         new_impulse = std::max(-max_friction, std::min(max_friction, c.tangent2_impulse + lambda2));
         lambda2     = new_impulse - c.tangent2_impulse;
         c.tangent2_impulse = new_impulse;
 
-        Math::Vector P1 = lambda1 * c.tangent1;
-        Math::Vector P2 = lambda2 * c.tangent2;
-
-        obj_a.v -= P1 * a.inverse_mass() + P2 * a.inverse_mass();
-        obj_a.w -= a.inverse_moment_of_inertia() * (Math::cross_product(r_a, P1)) +
-                   a.inverse_moment_of_inertia() * (Math::cross_product(r_a, P2));
-
-        obj_b.v += P1 * b.inverse_mass() + P2 * b.inverse_mass();
-        obj_b.w += b.inverse_moment_of_inertia() * (Math::cross_product(r_b, P1)) +
-                   b.inverse_moment_of_inertia() * (Math::cross_product(r_b, P2));
+        apply(lambda1, c.tangent1, p.ra_x_t1, p.rb_x_t1, obj_a, obj_b);
+        apply(lambda2, c.tangent2, p.ra_x_t2, p.rb_x_t2, obj_a, obj_b);
     }
 
-    for (auto& c : contact_manifold.contacts()) {
-        Math::Vector r_a = c.contact_point_a - a.coordinate_space().position();
-        Math::Vector r_b = c.contact_point_b - b.coordinate_space().position();
+    for (size_t i = 0; i < contacts.size(); ++i) {
+        Contact_manifold::Persistent_contact& c = contacts[i];
+        const Prepared_contact&               p = prepared_contacts[i];
 
-        float lambda = impulse(c.normal, r_a, r_b, obj_a, obj_b, c.penetration_depth, m_slop,
-                               m_time_step, m_beta, m_coefficient_of_restitution);
+        float velocity = relative_velocity(c.normal, p.ra_x_n, p.rb_x_n, obj_a, obj_b);
+        float lambda   = -(p.bias + velocity * p.velocity_scale) * p.normal_mass;
 
         // normal impulse clamping
         float new_impulse = std::max(0.0f, c.normal_impulse + lambda);
         lambda            = new_impulse - c.normal_impulse;
         c.normal_impulse  = new_impulse;
 
-        Math::Vector P = lambda * c.normal;
-
-        obj_a.v -= P * a.inverse_mass();
-        obj_a.w -= a.inverse_moment_of_inertia() * Math::cross_product(r_a, P);
-
-        obj_b.v += P * b.inverse_mass();
-        obj_b.w += b.inverse_moment_of_inertia() * Math::cross_product(r_b, P);
+        apply(lambda, c.normal, p.ra_x_n, p.rb_x_n, obj_a, obj_b);
     }
 
-    contact_manifold.a_delta_velocity()         = obj_a.v - a.velocity();
-    contact_manifold.a_delta_angular_velocity() = obj_a.w - a.angular_velocity();
-    contact_manifold.b_delta_velocity()         = obj_b.v - b.velocity();
-    contact_manifold.b_delta_angular_velocity() = obj_b.w - b.angular_velocity();
+    if (obj_a.inverse_mass > 0) {
+        bodies[prepared.body_a] = obj_a;
+    }
+    if (obj_b.inverse_mass > 0) {
+        bodies[prepared.body_b] = obj_b;
+    }
 }
 
 }  // namespace Physics
@@ -21,6 +21,51 @@ class Physics_object;
 /// http://allenchou.net/game-physics-series/
 class Constraint_solver {
 public:
+    /// @brief The parts of an object that the solver works on
+    ///
+    /// The solver never touches the Physics_objects. Each step they're copied into one array of
+    /// these, the manifolds know their objects by their index in that array, and the velocities
+    /// are copied back to the objects once all of the solving is done.
+    struct Body {
+        Body() = default;
+        Body(const Physics_object& object);
+
+        Math::Vector velocity;
+        Math::Vector angular_velocity;
+        float        inverse_mass              = 0;
+        float        inverse_moment_of_inertia = 0;
+    };
+
+    /// @brief What the solver works out for a contact before it solves
+    ///
+    /// None of this changes while the solver iterates, so it's worked out once per step by
+    /// prepare. The angular parts are the lever arms crossed with each direction, the effective
+    /// masses are inverted.
+    struct Prepared_contact {
+        Math::Vector ra_x_n;
+        Math::Vector rb_x_n;
+        Math::Vector ra_x_t1;
+        Math::Vector rb_x_t1;
+        Math::Vector ra_x_t2;
+        Math::Vector rb_x_t2;
+        float        normal_mass;
+        float        tangent1_mass;
+        float        tangent2_mass;
+        float        bias;
+        float        velocity_scale;
+    };
+
+    /// @brief A manifold that has been prepared this step
+    ///
+    /// body_a and body_b are where the manifold's objects are in the bodies. The manifold's
+    /// contacts are prepared_contact(first_contact) onwards, in the same order as contacts().
+    struct Prepared_manifold {
+        Contact_manifold* manifold;
+        int               body_a;
+        int               body_b;
+        size_t            first_contact;
+    };
+
     /// @brief Constructor
     /// @param time_step - [in] See Arena::Constraint_solver_settings::step_size
     /// @param beta - [in] See Arena::Constraint_solver_settings::beta
@@ -31,6 +76,30 @@ public:
     Constraint_solver(const Constraint_solver&) = delete;
     Constraint_solver& operator=(const Constraint_solver&) = delete;
 
+    /// @brief Forget the manifolds prepared last step
+    ///
+    /// The prepared data is only good for one step. Call this before preparing the first
+    /// manifold of a step. The memory is kept for the next step.
+    void begin_step();
+
+    /// @brief Work out everything about the contacts that doesn't change while solving
+    ///
+    /// The lever arms, effective masses and bias of each contact stay the same for every
+    /// iteration of a step, so they're worked out once here and kept by the solver until the
+    /// next begin_step. Call this every step for every manifold before warm_start or solve, and
+    /// after the contacts have been updated by the collision strategy. The manifold must stay
+    /// where it is until the step is done.
+    /// @param contact_manifold - [in] the manifold to prepare
+    /// @param body_a - [in] index of the manifold's object_a in the bodies
+    /// @param body_b - [in] index of the manifold's object_b in the bodies
+    /// @returns the index to pass to warm_start and solve
+    size_t prepare(Contact_manifold& contact_manifold, int body_a, int body_b);
+
+    /// @brief The manifolds prepared this step, in the order they were prepared
+    size_t                   prepared_count() const { return m_prepared.size(); }
+    const Prepared_manifold& prepared(size_t index) const { return m_prepared[index]; }
+    const Prepared_contact&  prepared_contact(size_t index) const { return m_contacts[index]; }
+
     /// @brief Re-apply forces from previous time step
     ///
     /// See the discussion by Allen Chou on his web page. The general idea is that
@@ -38,23 +107,31 @@ public:
     /// step. For exmaple a bunch of blocks at rest all have the same gravity every
     /// time step. So this just re-applies the same force. It's assumed that you've already scaled
     /// the impulses by using the Contact_manifold::scale_contact_impulses
-    /// @param contact_manifold - [in] Up to 4 points that define the collision between the 2
-    ///        objects stored in the manifold
-    void warm_start(Contact_manifold& contact_manifold);
+    /// @param index - [in] the prepared manifold, as returned by prepare
+    /// @param bodies - [in,out] the bodies, their velocities are updated
+    void warm_start(size_t index, std::vector<Body>& bodies) const;
 
     /// @brief The heart of constraint solving
     ///
     /// Given two objects that are known to be colliding, and up to 4 points that are
-    /// in the contact manifold. Figures out all of the forces at each point.
-    /// @param contact_manifold - [in,out] Up to 4 points that define the collision.  Its
-    ///        forces will be updated
-    void solve(Contact_manifold& contact_manifold);
+    /// in the contact manifold. Figures out all of the forces at each point. Only the bodies of
+    /// the manifold's moving objects are written to, so manifolds that don't share a moving
+    /// object can be solved at the same time.
+    /// @param index - [in] the prepared manifold, as returned by prepare. The forces in its
+    ///        contacts will be updated
+    /// @param bodies - [in,out] the bodies, their velocities are updated
+    void solve(size_t index, std::vector<Body>& bodies) const;
 
 private:
     const float m_time_step;
     const float m_beta;
     const float m_coefficient_of_restitution;
     const float m_slop;
+
+    // Everything prepared this step. m_contacts holds the prepared contacts of every manifold,
+    // one manifold after the other.
+    std::vector<Prepared_manifold> m_prepared;
+    std::vector<Prepared_contact>  m_contacts;
 };
 
 }  // namespace Physics
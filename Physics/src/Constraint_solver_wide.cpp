@@ -0,0 +1,318 @@
+#include "Constraint_solver_wide.h"
+
+#include <Vector_math.h>
+
+#include <xmmintrin.h>
+
+namespace Dubious {
+namespace Physics {
+
+namespace {
+
+const float FRICTION = 0.3f;
+
+// How many of the newest blocks to look through for a free lane. Looking
+// through all of them would make preparing quadratic in the contacts.
+const size_t BLOCK_SEARCH = 8;
+
+// A Math::Vector for each of the 4 lanes
+struct Wide_vector {
+    __m128 x;
+    __m128 y;
+    __m128 z;
+};
+
+Wide_vector
+load(const float (&row)[3][4])
+{
+    return {_mm_loadu_ps(row[0]), _mm_loadu_ps(row[1]), _mm_loadu_ps(row[2])};
+}
+
+void
+set(float (&row)[3][4], int lane, const Math::Vector& v)
+{
+    row[0][lane] = v.x();
+    row[1][lane] = v.y();
+    row[2][lane] = v.z();
+}
+
+__m128
+dot_product(const Wide_vector& a, const Wide_vector& b)
+{
+    return _mm_add_ps(_mm_add_ps(_mm_mul_ps(a.x, b.x), _mm_mul_ps(a.y, b.y)), _mm_mul_ps(a.z, b.z));
+}
+
+// a + b * s
+Wide_vector
+multiply_add(const Wide_vector& a, const Wide_vector& b, __m128 s)
+{
+    return {_mm_add_ps(a.x, _mm_mul_ps(b.x, s)), _mm_add_ps(a.y, _mm_mul_ps(b.y, s)),
+            _mm_add_ps(a.z, _mm_mul_ps(b.z, s))};
+}
+
+// Each lane's velocity is one row of 4 floats, a transpose turns them into
+// the x, y and z of all 4 lanes
+Wide_vector
+gather(const float* lane0, const float* lane1, const float* lane2, const float* lane3)
+{
+    __m128 x = _mm_loadu_ps(lane0);
+    __m128 y = _mm_loadu_ps(lane1);
+    __m128 z = _mm_loadu_ps(lane2);
+    __m128 w = _mm_loadu_ps(lane3);
+    _MM_TRANSPOSE4_PS(x, y, z, w);
+    return {x, y, z};
+}
+
+void
+scatter(const Wide_vector& v, float* lane0, float* lane1, float* lane2, float* lane3)
+{
+    __m128 x = v.x;
+    __m128 y = v.y;
+    __m128 z = v.z;
+    __m128 w = _mm_setzero_ps();
+    _MM_TRANSPOSE4_PS(x, y, z, w);
+    _mm_storeu_ps(lane0, x);
+    _mm_storeu_ps(lane1, y);
+    _mm_storeu_ps(lane2, z);
+    _mm_storeu_ps(lane3, w);
+}
+
+// How fast the contact points are moving into each other along a direction.
+// The same as relative_velocity in Constraint_solver.cpp
+__m128
+relative_velocity(const Wide_vector& v_a, const Wide_vector& w_a, const Wide_vector& v_b,
+                  const Wide_vector& w_b, const Wide_vector& direction,
+                  const Wide_vector& ra_x_direction, const Wide_vector& rb_x_direction)
+{
+    return _mm_sub_ps(_mm_add_ps(_mm_sub_ps(dot_product(v_b, direction),
+                                            dot_product(v_a, direction)),
+                                 dot_product(rb_x_direction, w_b)),
+                      dot_product(ra_x_direction, w_a));
+}
+
+}  // namespace
+
+void
+Constraint_solver_wide::solve(const Constraint_solver&              solver,
+                              std::vector<Constraint_solver::Body>& bodies, int iterations)
+{
+    prepare(solver, bodies);
+    for (int i = 0; i < iterations; ++i) {
+        for (Block& block : m_blocks) {
+            solve_block(block);
+        }
+    }
+    finish(bodies);
+}
+
+void
+Constraint_solver_wide::prepare(const Constraint_solver&                    solver,
+                                const std::vector<Constraint_solver::Body>& bodies)
+{
+    m_bodies.assign(1, Body());
+    m_sources.assign(1, 0);
+    m_blocks.clear();
+    if (m_body_indices.size() < bodies.size()) {
+        m_body_indices.resize(bodies.size(), 0);
+    }
+    for (size_t m = 0; m < solver.prepared_count(); ++m) {
+        const Constraint_solver::Prepared_manifold& manifold = solver.prepared(m);
+        const Constraint_solver::Body&              a        = bodies[manifold.body_a];
+        const Constraint_solver::Body&              b        = bodies[manifold.body_b];
+        if (a.inverse_mass == 0 && b.inverse_mass == 0) {
+            continue;
+        }
+        const int  index_a  = body_index(manifold.body_a, a);
+        const int  index_b  = body_index(manifold.body_b, b);
+        const auto contacts = manifold.manifold->contacts();
+        for (size_t i = 0; i < contacts.size(); ++i) {
+            add_contact(contacts[i], solver.prepared_contact(manifold.first_contact + i), index_a,
+                        a, index_b, b);
+        }
+    }
+}
+
+int
+Constraint_solver_wide::body_index(int source, const Constraint_solver::Body& body)
+{
+    int& index = m_body_indices[source];
+    if (index == 0) {
+        Body wide                = Body();
+        wide.velocity[0]         = body.velocity.x();
+        wide.velocity[1]         = body.velocity.y();
+        wide.velocity[2]         = body.velocity.z();
+        wide.angular_velocity[0] = body.angular_velocity.x();
+        wide.angular_velocity[1] = body.angular_velocity.y();
+        wide.angular_velocity[2] = body.angular_velocity.z();
+        index                    = static_cast<int>(m_bodies.size());
+        m_bodies.push_back(wide);
+        m_sources.push_back(source);
+    }
+    return index;
+}
+
+void
+Constraint_solver_wide::add_contact(Contact_manifold::Persistent_contact&      c,
+                                    const Constraint_solver::Prepared_contact& p, int a,
+                                    const Constraint_solver::Body& source_a, int b,
+                                    const Constraint_solver::Body& source_b)
+{
+    // Find a block with a free lane that doesn't have either object in it.
+    // Stationary objects never change, so any number of lanes can share one.
+    const bool a_moves = source_a.inverse_mass > 0;
+    const bool b_moves = source_b.inverse_mass > 0;
+    size_t block = m_blocks.size() > BLOCK_SEARCH ? m_blocks.size() - BLOCK_SEARCH : 0;
+    for (; block < m_blocks.size(); ++block) {
+        const Block& candidate = m_blocks[block];
+        bool         free      = candidate.count < LANES;
+        for (int i = 0; i < candidate.count && free; ++i) {
+            free = !(a_moves && (candidate.body_a[i] == a || candidate.body_b[i] == a)) &&
+                   !(b_moves && (candidate.body_a[i] == b || candidate.body_b[i] == b));
+        }
+        if (free) {
+            break;
+        }
+    }
+    if (block == m_blocks.size()) {
+        m_blocks.push_back(Block());
+    }
+    Block&    wide = m_blocks[block];
+    const int lane = wide.count++;
+
+    wide.body_a[lane]   = a;
+    wide.body_b[lane]   = b;
+    wide.contacts[lane] = &c;
+    set(wide.normal, lane, Math::Vector(c.normal));
+    set(wide.tangent1, lane, Math::Vector(c.tangent1));
+    set(wide.tangent2, lane, Math::Vector(c.tangent2));
+    set(wide.ra_x_n, lane, p.ra_x_n);
+    set(wide.rb_x_n, lane, p.rb_x_n);
+    set(wide.ra_x_t1, lane, p.ra_x_t1);
+    set(wide.rb_x_t1, lane, p.rb_x_t1);
+    set(wide.ra_x_t2, lane, p.ra_x_t2);
+    set(wide.rb_x_t2, lane, p.rb_x_t2);
+    wide.inverse_mass_a[lane]    = source_a.inverse_mass;
+    wide.inverse_mass_b[lane]    = source_b.inverse_mass;
+    wide.inverse_inertia_a[lane] = source_a.inverse_moment_of_inertia;
+    wide.inverse_inertia_b[lane] = source_b.inverse_moment_of_inertia;
+    wide.normal_mass[lane]       = p.normal_mass;
+    wide.tangent1_mass[lane]     = p.tangent1_mass;
+    wide.tangent2_mass[lane]     = p.tangent2_mass;
+    wide.bias[lane]              = p.bias;
+    wide.velocity_scale[lane]    = p.velocity_scale;
+    wide.normal_impulse[lane]   = c.normal_impulse;
+    wide.tangent1_impulse[lane] = c.tangent1_impulse;
+    wide.tangent2_impulse[lane] = c.tangent2_impulse;
+}
+
+void
+Constraint_solver_wide::solve_block(Block& block)
+{
+    Body* a[LANES];
+    Body* b[LANES];
+    for (int i = 0; i < LANES; ++i) {
+        a[i] = &m_bodies[block.body_a[i]];
+        b[i] = &m_bodies[block.body_b[i]];
+    }
+    Wide_vector v_a = gather(a[0]->velocity, a[1]->velocity, a[2]->velocity, a[3]->velocity);
+    Wide_vector w_a = gather(a[0]->angular_velocity, a[1]->angular_velocity,
+                             a[2]->angular_velocity, a[3]->angular_velocity);
+    Wide_vector v_b = gather(b[0]->velocity, b[1]->velocity, b[2]->velocity, b[3]->velocity);
+    Wide_vector w_b = gather(b[0]->angular_velocity, b[1]->angular_velocity,
+                             b[2]->angular_velocity, b[3]->angular_velocity);
+
+    const __m128 inverse_mass_a    = _mm_loadu_ps(block.inverse_mass_a);
+    const __m128 inverse_mass_b    = _mm_loadu_ps(block.inverse_mass_b);
+    const __m128 inverse_inertia_a = _mm_loadu_ps(block.inverse_inertia_a);
+    const __m128 inverse_inertia_b = _mm_loadu_ps(block.inverse_inertia_b);
+    const __m128 zero              = _mm_setzero_ps();
+
+    // Push the objects apart by an impulse of lambda along a direction
+    auto apply = [&](__m128 lambda, const Wide_vector& direction, const Wide_vector& ra_x_direction,
+                     const Wide_vector& rb_x_direction) {
+        const __m128 negative = _mm_sub_ps(zero, lambda);
+        v_a = multiply_add(v_a, direction, _mm_mul_ps(negative, inverse_mass_a));
+        w_a = multiply_add(w_a, ra_x_direction, _mm_mul_ps(negative, inverse_inertia_a));
+        v_b = multiply_add(v_b, direction, _mm_mul_ps(lambda, inverse_mass_b));
+        w_b = multiply_add(w_b, rb_x_direction, _mm_mul_ps(lambda, inverse_inertia_b));
+    };
+
+    // Friction first. Both directions are worked out from the same
+    // velocities and then applied together.
+    const Wide_vector t1           = load(block.tangent1);
+    const Wide_vector ra_x_t1      = load(block.ra_x_t1);
+    const Wide_vector rb_x_t1      = load(block.rb_x_t1);
+    const Wide_vector t2           = load(block.tangent2);
+    const Wide_vector ra_x_t2      = load(block.ra_x_t2);
+    const Wide_vector rb_x_t2      = load(block.rb_x_t2);
+    const __m128      max_friction =
+        _mm_mul_ps(_mm_set1_ps(FRICTION), _mm_loadu_ps(block.normal_impulse));
+    const __m128 min_friction = _mm_sub_ps(zero, max_friction);
+
+    __m128 lambda1 = _mm_mul_ps(
+        _mm_sub_ps(zero, relative_velocity(v_a, w_a, v_b, w_b, t1, ra_x_t1, rb_x_t1)),
+        _mm_loadu_ps(block.tangent1_mass));
+    __m128 lambda2 = _mm_mul_ps(
+        _mm_sub_ps(zero, relative_velocity(v_a, w_a, v_b, w_b, t2, ra_x_t2, rb_x_t2)),
+        _mm_loadu_ps(block.tangent2_mass));
+    __m128 old_impulse = _mm_loadu_ps(block.tangent1_impulse);
+    __m128 new_impulse =
+        _mm_max_ps(min_friction, _mm_min_ps(max_friction, _mm_add_ps(old_impulse, lambda1)));
+    lambda1 = _mm_sub_ps(new_impulse, old_impulse);
+    _mm_storeu_ps(block.tangent1_impulse, new_impulse);
+    old_impulse = _mm_loadu_ps(block.tangent2_impulse);
+    new_impulse =
+        _mm_max_ps(min_friction, _mm_min_ps(max_friction, _mm_add_ps(old_impulse, lambda2)));
+    lambda2 = _mm_sub_ps(new_impulse, old_impulse);
+    _mm_storeu_ps(block.tangent2_impulse, new_impulse);
+    apply(lambda1, t1, ra_x_t1, rb_x_t1);
+    apply(lambda2, t2, ra_x_t2, rb_x_t2);
+
+    // Then the normal, clamped so it only ever pushes apart
+    const Wide_vector n      = load(block.normal);
+    const Wide_vector ra_x_n = load(block.ra_x_n);
+    const Wide_vector rb_x_n = load(block.rb_x_n);
+    const __m128      velocity =
+        _mm_mul_ps(relative_velocity(v_a, w_a, v_b, w_b, n, ra_x_n, rb_x_n),
+                   _mm_loadu_ps(block.velocity_scale));
+    __m128 lambda =
+        _mm_mul_ps(_mm_sub_ps(zero, _mm_add_ps(_mm_loadu_ps(block.bias), velocity)),
+                   _mm_loadu_ps(block.normal_mass));
+    old_impulse = _mm_loadu_ps(block.normal_impulse);
+    new_impulse = _mm_max_ps(zero, _mm_add_ps(old_impulse, lambda));
+    lambda      = _mm_sub_ps(new_impulse, old_impulse);
+    _mm_storeu_ps(block.normal_impulse, new_impulse);
+    apply(lambda, n, ra_x_n, rb_x_n);
+
+    scatter(v_a, a[0]->velocity, a[1]->velocity, a[2]->velocity, a[3]->velocity);
+    scatter(w_a, a[0]->angular_velocity, a[1]->angular_velocity, a[2]->angular_velocity,
+            a[3]->angular_velocity);
+    scatter(v_b, b[0]->velocity, b[1]->velocity, b[2]->velocity, b[3]->velocity);
+    scatter(w_b, b[0]->angular_velocity, b[1]->angular_velocity, b[2]->angular_velocity,
+            b[3]->angular_velocity);
+}
+
+void
+Constraint_solver_wide::finish(std::vector<Constraint_solver::Body>& bodies)
+{
+    for (const Block& block : m_blocks) {
+        for (int i = 0; i < block.count; ++i) {
+            block.contacts[i]->normal_impulse   = block.normal_impulse[i];
+            block.contacts[i]->tangent1_impulse = block.tangent1_impulse[i];
+            block.contacts[i]->tangent2_impulse = block.tangent2_impulse[i];
+        }
+    }
+    for (size_t i = 1; i < m_bodies.size(); ++i) {
+        Constraint_solver::Body& source = bodies[m_sources[i]];
+        const Body&              body   = m_bodies[i];
+        if (source.inverse_mass > 0) {
+            source.velocity = Math::Vector(body.velocity[0], body.velocity[1], body.velocity[2]);
+            source.angular_velocity = Math::Vector(
+                body.angular_velocity[0], body.angular_velocity[1], body.angular_velocity[2]);
+        }
+        m_body_indices[m_sources[i]] = 0;
+    }
+}
+
+}  // namespace Physics
+}  // namespace Dubious
@@ -0,0 +1,112 @@
+#ifndef INCLUDED_PHYSICS_CONSTRAINTSOLVERWIDE
+#define INCLUDED_PHYSICS_CONSTRAINTSOLVERWIDE
+
+#include "Constraint_solver.h"
+#include "Contact_manifold.h"
+
+#include <vector>
+
+namespace Dubious {
+namespace Physics {
+
+/// @brief Constraint solver that works on 4 contacts at a time
+///
+/// This is the same Sequential Impulse technique as the Constraint_solver,
+/// rearranged so it can use SSE. At the start of the solve every contact in
+/// every manifold is put into a block of 4 contacts, along with the lever arms,
+/// effective masses and bias that Constraint_solver::prepare worked out. The
+/// blocks are stored as structures of arrays so each value for the 4 contacts
+/// can be loaded at once. No two contacts in a block share an object that can
+/// move.
+///
+/// The bodies' velocities are copied into an array padded out for SSE for the
+/// solve and copied back at the end. Each block gathers the velocities of its 8 objects,
+/// solves its 4 contacts side by side, and scatters the new velocities back
+/// before the next block starts. So the blocks are still solved one after the
+/// other and it's just as stable as solving one contact at a time.
+class Constraint_solver_wide {
+public:
+    Constraint_solver_wide() = default;
+
+    Constraint_solver_wide(const Constraint_solver_wide&) = delete;
+    Constraint_solver_wide& operator=(const Constraint_solver_wide&) = delete;
+
+    /// @brief Solve every manifold prepared this step
+    ///
+    /// The objects' velocities are updated, and the impulses in the manifolds
+    /// are kept for warm starting the next step. Only the manifolds prepared
+    /// by the Constraint_solver this step are solved, and they should already
+    /// be warm started.
+    /// @param solver - [in] the solver that prepared the manifolds
+    /// @param bodies - [in,out] the bodies the manifolds were prepared with, their velocities
+    ///        are updated
+    /// @param iterations - [in] how many times to go over every contact
+    void solve(const Constraint_solver& solver, std::vector<Constraint_solver::Body>& bodies,
+               int iterations);
+
+private:
+    static const int LANES = 4;
+
+    // Velocities are padded out to 4 floats so they can be loaded straight
+    // into SSE registers
+    struct Body {
+        float velocity[4];
+        float angular_velocity[4];
+    };
+
+    // Up to 4 contacts, one per lane. The angular parts are the lever arms
+    // crossed with the direction, the effective masses are already inverted.
+    struct Block {
+        int                                   count;
+        int                                   body_a[LANES];
+        int                                   body_b[LANES];
+        Contact_manifold::Persistent_contact* contacts[LANES];
+
+        float normal[3][LANES];
+        float tangent1[3][LANES];
+        float tangent2[3][LANES];
+        float ra_x_n[3][LANES];
+        float rb_x_n[3][LANES];
+        float ra_x_t1[3][LANES];
+        float rb_x_t1[3][LANES];
+        float ra_x_t2[3][LANES];
+        float rb_x_t2[3][LANES];
+
+        float inverse_mass_a[LANES];
+        float inverse_mass_b[LANES];
+        float inverse_inertia_a[LANES];
+        float inverse_inertia_b[LANES];
+        float normal_mass[LANES];
+        float tangent1_mass[LANES];
+        float tangent2_mass[LANES];
+        float bias[LANES];
+        float velocity_scale[LANES];
+
+        float normal_impulse[LANES];
+        float tangent1_impulse[LANES];
+        float tangent2_impulse[LANES];
+    };
+
+    void prepare(const Constraint_solver&                    solver,
+                 const std::vector<Constraint_solver::Body>& bodies);
+    int  body_index(int source, const Constraint_solver::Body& body);
+    void add_contact(Contact_manifold::Persistent_contact&      c,
+                     const Constraint_solver::Prepared_contact& p, int a,
+                     const Constraint_solver::Body& source_a, int b,
+                     const Constraint_solver::Body& source_b);
+    void solve_block(Block& block);
+    void finish(std::vector<Constraint_solver::Body>& bodies);
+
+    // Body 0 is never written back, the empty lanes in a block point at it.
+    // m_sources is where each body came from in the solver's bodies, and
+    // m_body_indices goes the other way.
+    std::vector<Body>  m_bodies;
+    std::vector<int>   m_sources;
+    std::vector<int>   m_body_indices;
+    std::vector<Block> m_blocks;
+};
+
+}  // namespace Physics
+}  // namespace Dubious
+
+#endif
@@ -5,15 +5,20 @@
 
 #include <algorithm>
 #include <iostream>
+#include <limits>
 #include <tuple>
+#include <type_traits>
 
 namespace Dubious {
 namespace Physics {
 
+static_assert(std::is_trivially_copyable<Contact_manifold>::value,
+              "Contact_manifold should be safe to memcpy");
+
 Contact_manifold::Contact_manifold(Physics_object& a, Physics_object& b, float persistent_threshold,
                                    float movement_threshold)
-    : m_object_a(a)
-    , m_object_b(b)
+    : m_object_a(&a)
+    , m_object_b(&b)
     , m_persistent_threshold(persistent_threshold)
     , m_movement_threshold(movement_threshold)
 {
@@ -22,35 +27,30 @@ Contact_manifold::Contact_manifold(Physics_object& a, Physics_object& b, float p
 void
 Contact_manifold::prune_old_contacts()
 {
-    m_contacts.erase(
-        std::remove_if(
-            m_contacts.begin(), m_contacts.end(),
-            [this](Contact& c) {
-                Math::Point new_contact_a =
-                    m_object_a.coordinate_space().transform(c.local_point_a);
-                Math::Point new_contact_b =
-                    m_object_b.coordinate_space().transform(c.local_point_b);
-
-                // check to see if it's still penetrating
-                float dot_penetrator =
-                    Math::dot_product(Math::Vector(c.normal), Math::to_vector(new_contact_b) -
-                                                                  Math::to_vector(new_contact_a));
-                if (dot_penetrator > 0.0f) {
-                    return true;
-                }
-                c.penetration_depth = -dot_penetrator;
-
-                // if the point has moved too far from where it was originally recorded
-                // then we want to remove if from the manifold
-                if ((new_contact_a - c.contact_point_a).length_squared() > m_movement_threshold) {
-                    return true;
-                }
-                if ((new_contact_b - c.contact_point_b).length_squared() > m_movement_threshold) {
-                    return true;
-                }
-                return false;
-            }),
-        m_contacts.end());
+    int kept = 0;
+    for (int i = 0; i < m_contact_count; ++i) {
+        Persistent_contact& c             = m_contacts[i];
+        Math::Point         new_contact_a = contact_point_a(c);
+        Math::Point         new_contact_b = contact_point_b(c);
+
+        // check to see if it's still penetrating
+        Math::Vector separation     = new_contact_b - new_contact_a;
+        float        dot_penetrator = Math::dot_product(Math::Vector(c.normal), separation);
+        if (dot_penetrator > 0.0f) {
+            continue;
+        }
+        c.penetration_depth = -dot_penetrator;
+
+        // if the two halves of the contact have slid too far apart along
+        // the surface then it's not the same contact anymore and we want to
+        // remove it from the manifold
+        Math::Vector drift = separation - Math::Vector(c.normal) * dot_penetrator;
+        if (drift.length_squared() > m_movement_threshold) {
+            continue;
+        }
+        m_contacts[kept++] = c;
+    }
+    m_contact_count = kept;
 }
 
 // How to find a manifold
@@ -131,117 +131,151 @@ Contact_manifold::distance_squared_to_triangle(const Math::Point& a, const Math:
 }
 
 void
-Contact_manifold::cleanup_contacts(std::vector<Contact>& contacts)
+Contact_manifold::cleanup_contacts(Persistent_contact* contacts, int& count) const
 {
-    if (contacts.size() <= 4) {
+    if (count <= MAX_CONTACTS) {
         return;
     }
-    std::vector<Contact_manifold::Contact> new_contacts(4);
+    // Everything is measured from the contact points on A, and this
+    // runs for most pairs on most steps, so work them out once
+    Math::Point points[2 * MAX_CONTACTS];
+    for (int i = 0; i < count; ++i) {
+        points[i] = contact_point_a(contacts[i]);
+    }
+    auto take = [&](int index, int slot) {
+        std::swap(contacts[slot], contacts[index]);
+        std::swap(points[slot], points[index]);
+    };
 
     //
     // start with deepest contacts
-    float  furthest = std::numeric_limits<float>::lowest();
-    size_t furthest_index;
-    for (size_t i = 0; i < contacts.size(); ++i) {
+    float furthest       = std::numeric_limits<float>::lowest();
+    int   furthest_index = 0;
+    for (int i = 0; i < count; ++i) {
         if (contacts[i].penetration_depth > furthest) {
             furthest       = contacts[i].penetration_depth;
             furthest_index = i;
         }
     }
-    std::swap(contacts.back(), contacts[furthest_index]);
-    new_contacts[0] = contacts.back();
-    contacts.pop_back();
+    take(furthest_index, 0);
 
     // find the one furthest away
     furthest = std::numeric_limits<float>::lowest();
-    for (size_t i = 0; i < contacts.size(); ++i) {
-        float distance =
-            (new_contacts[0].contact_point_a - contacts[i].contact_point_a).length_squared();
+    for (int i = 1; i < count; ++i) {
+        float distance = (points[0] - points[i]).length_squared();
         if (distance > furthest) {
             furthest       = distance;
             furthest_index = i;
         }
     }
-    std::swap(contacts.back(), contacts[furthest_index]);
-    new_contacts[1] = contacts.back();
-    contacts.pop_back();
+    take(furthest_index, 1);
 
     // find the furthest from the line segment
     furthest = std::numeric_limits<float>::lowest();
-    for (size_t i = 0; i < contacts.size(); ++i) {
-        float distance = distance_squared_to_line_segment(new_contacts[0].contact_point_a,
-                                                          new_contacts[1].contact_point_a,
-                                                          contacts[i].contact_point_a);
+    for (int i = 2; i < count; ++i) {
+        float distance = distance_squared_to_line_segment(points[0], points[1], points[i]);
         if (distance > furthest) {
             furthest       = distance;
             furthest_index = i;
         }
     }
-    std::swap(contacts.back(), contacts[furthest_index]);
-    new_contacts[2] = contacts.back();
-    contacts.pop_back();
+    take(furthest_index, 2);
 
-    // find the furthest from the triangle
+    // find the furthest from the triangle, if they're all inside
+    // it then 3 contacts will have to do
     furthest = std::numeric_limits<float>::lowest();
-    for (size_t i = 0; i < contacts.size(); ++i) {
+    for (int i = 3; i < count; ++i) {
         bool  valid;
         float distance;
-        std::tie(valid, distance) = distance_squared_to_triangle(
-            new_contacts[0].contact_point_a, new_contacts[1].contact_point_a,
-            new_contacts[2].contact_point_a, contacts[i].contact_point_a);
+        std::tie(valid, distance) =
+            distance_squared_to_triangle(points[0], points[1], points[2], points[i]);
         if (valid && distance > furthest) {
             furthest       = distance;
             furthest_index = i;
         }
     }
-    if (furthest != std::numeric_limits<float>::lowest()) {
-        new_contacts[3] = contacts[furthest_index];
+    if (furthest == std::numeric_limits<float>::lowest()) {
+        count = 3;
+        return;
     }
-
-    contacts = new_contacts;
+    take(furthest_index, 3);
+    count = MAX_CONTACTS;
 }
 
 void
 Contact_manifold::insert(const std::vector<Contact>& contacts)
 {
-    for (const auto& c : contacts) {
-        bool add = true;
-        for (auto& existing : m_contacts) {
-            if ((c.contact_point_a - existing.contact_point_a).length_squared() <
+    insert(contacts.data(), contacts.size());
+}
+
+void
+Contact_manifold::insert(const Contact* contacts, size_t count)
+{
+    // New contacts go on the end of the old ones in a buffer with room for
+    // twice as many as the manifold holds. When it fills up it gets cut back
+    // down, and once more at the end.
+    Persistent_contact candidates[2 * MAX_CONTACTS];
+    int                candidate_count = m_contact_count;
+    std::copy(m_contacts.begin(), m_contacts.begin() + m_contact_count, candidates);
+    for (size_t i = 0; i < count; ++i) {
+        const Contact&      c = contacts[i];
+        Persistent_contact* existing;
+        for (existing = candidates; existing != candidates + candidate_count; ++existing) {
+            if ((c.contact_point_a - contact_point_a(*existing)).length_squared() <
                     m_persistent_threshold &&
-                (c.contact_point_b - existing.contact_point_b).length_squared() <
+                (c.contact_point_b - contact_point_b(*existing)).length_squared() <
                     m_persistent_threshold) {
-                add = false;
-
-                auto old                  = existing;
-                existing                  = c;
-                existing.normal_impulse   = old.normal_impulse;
-                existing.tangent1_impulse = old.tangent1_impulse;
-                existing.tangent2_impulse = old.tangent2_impulse;
                 break;
             }
         }
-        if (add) {
-            m_contacts.push_back(c);
+        if (existing == candidates + candidate_count) {
+            if (candidate_count == 2 * MAX_CONTACTS) {
+                cleanup_contacts(candidates, candidate_count);
+                existing = candidates + candidate_count;
+            }
+            ++candidate_count;
+            existing->normal_impulse   = c.normal_impulse;
+            existing->tangent1_impulse = c.tangent1_impulse;
+            existing->tangent2_impulse = c.tangent2_impulse;
         }
+        existing->local_point_a     = c.local_point_a;
+        existing->local_point_b     = c.local_point_b;
+        existing->normal            = c.normal;
+        existing->tangent1          = c.tangent1;
+        existing->tangent2          = c.tangent2;
+        existing->penetration_depth = c.penetration_depth;
     }
-    cleanup_contacts(m_contacts);
+    cleanup_contacts(candidates, candidate_count);
+    std::copy(candidates, candidates + candidate_count, m_contacts.begin());
+    m_contact_count = candidate_count;
 }
 
 void
 Contact_manifold::scale_contact_impulses(float scale)
 {
-    for (Contact& c : m_contacts) {
+    for (Persistent_contact& c : contacts()) {
         c.normal_impulse *= scale;
         c.tangent1_impulse *= scale;
         c.tangent2_impulse *= scale;
     }
 }
 
+Math::Point
+Contact_manifold::contact_point_a(const Persistent_contact& c) const
+{
+    return m_object_a->coordinate_space().transform(c.local_point_a);
+}
+
+Math::Point
+Contact_manifold::contact_point_b(const Persistent_contact& c) const
+{
+    return m_object_b->coordinate_space().transform(c.local_point_b);
+}
+
 std::ostream&
 operator<<(std::ostream& o, const Contact_manifold& c)
 {
-    for (const auto& contact : c.m_contacts) {
+    for (const auto& contact : c.contacts()) {
         o << "{\n\t" << contact.local_point_a << "\n\t" << contact.local_point_b << "\n}\n";
     }
     return o;
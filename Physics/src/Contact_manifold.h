@@ -5,6 +5,7 @@
 #include <Unit_vector.h>
 #include <Coordinate_space.h>
 
+#include <array>
 #include <memory>
 #include <vector>
 
@@ -26,11 +27,17 @@ class Physics_object;
 /// not new contacts should be added, when old contacts should
 /// be removed, etc. Check out "Warm Starting"
 /// http://allenchou.net/2014/01/game-physics-stability-warm-starting/
+///
+/// The contacts are held in a fixed array inside the manifold, and the
+/// manifold doesn't own any memory, so it can be copied around with memcpy.
 class Contact_manifold {
 public:
     Contact_manifold(Physics_object& a, Physics_object& b, float persistent_threshold,
                      float movement_threshold);
 
+    /// @brief Most contacts a manifold will hold
+    static const int MAX_CONTACTS = 4;
+
     /// @brief Contact information
     ///
     /// The result of a collision will be a vector of these.
@@ -49,6 +56,44 @@ public:
         float             tangent2_impulse  = 0;
     };
 
+    /// @brief A contact as it's kept in the manifold
+    ///
+    /// Only the local points are kept, the world points go out of date as
+    /// soon as the objects move. Use contact_point_a and contact_point_b to
+    /// find where they are now.
+    struct Persistent_contact {
+        Math::Local_point local_point_a;
+        Math::Local_point local_point_b;
+        Math::Unit_vector normal;
+        Math::Unit_vector tangent1;
+        Math::Unit_vector tangent2;
+        float             penetration_depth = 0;
+        float             normal_impulse    = 0;
+        float             tangent1_impulse  = 0;
+        float             tangent2_impulse  = 0;
+    };
+
+    /// @brief View of the contacts in a manifold
+    template <typename T>
+    class Contact_range {
+    public:
+        Contact_range(T* first, int count)
+            : m_first(first)
+            , m_count(count)
+        {
+        }
+
+        T*     begin() const { return m_first; }
+        T*     end() const { return m_first + m_count; }
+        size_t size() const { return m_count; }
+        bool   empty() const { return m_count == 0; }
+        T&     operator[](size_t index) const { return m_first[index]; }
+
+    private:
+        T*  m_first;
+        int m_count;
+    };
+
     /// @brief Prunes old contact points
     ///
     /// The manifold contains contact points from the previous time step.
@@ -62,6 +107,12 @@ public:
     /// and if so, maybe use the older ones? Or newer ones?
     void insert(const std::vector<Contact>& contacts);
 
+    /// @brief Inserts contacts straight out of narrow phase scratch memory
+    ///
+    /// @param contacts - [in] the first contact
+    /// @param count - [in] how many there are
+    void insert(const Contact* contacts, size_t count);
+
     /// @brief Scale the contact impulses
     ///
     /// Basically iterate through the Contacts and scale the normal_impulse by this supplied factor.
@@ -71,22 +122,28 @@ public:
     void scale_contact_impulses(float scale);
 
     /// @brief contacts accessors
-    std::vector<Contact>&       contacts() { return m_contacts; }
-    const std::vector<Contact>& contacts() const { return m_contacts; }
-
-    Physics_object& object_a() { return m_object_a; }
-    Physics_object& object_b() { return m_object_b; }
-
-    Math::Vector& a_delta_velocity() { return m_a_delta_velocity; }
-    Math::Vector& a_delta_angular_velocity() { return m_a_delta_angular_velocity; }
-    Math::Vector& b_delta_velocity() { return m_b_delta_velocity; }
-    Math::Vector& b_delta_angular_velocity() { return m_b_delta_angular_velocity; }
+    Contact_range<Persistent_contact> contacts()
+    {
+        return Contact_range<Persistent_contact>(m_contacts.data(), m_contact_count);
+    }
+    Contact_range<const Persistent_contact> contacts() const
+    {
+        return Contact_range<const Persistent_contact>(m_contacts.data(), m_contact_count);
+    }
+
+    /// @brief Where a contact is in world space right now
+    /// @param c - [in] a contact in this manifold
+    Math::Point contact_point_a(const Persistent_contact& c) const;
+    Math::Point contact_point_b(const Persistent_contact& c) const;
+
+    Physics_object& object_a() { return *m_object_a; }
+    Physics_object& object_b() { return *m_object_b; }
 
 private:
     friend class Physics_test::Contact_manifold_test;
     friend std::ostream& operator<<(std::ostream& o, const Contact_manifold&);
 
-    void  cleanup_contacts(std::vector<Contact>& contacts);
+    void  cleanup_contacts(Persistent_contact* contacts, int& count) const;
     float distance_squared_to_line_segment(const Math::Point& a, const Math::Point& b,
                                            const Math::Point& p) const;
     std::tuple<bool, float> distance_squared_to_triangle(const Math::Point& a, const Math::Point& b,
@@ -97,16 +154,14 @@ private:
                                                                const Math::Point& c,
                                                                const Math::Point& p) const;
 
-    Physics_object&      m_object_a;
-    Physics_object&      m_object_b;
-    std::vector<Contact> m_contacts;
-    const float          m_movement_threshold   = 0.05f;
-    const float          m_persistent_threshold = 0.05f;
-
-    Math::Vector m_a_delta_velocity;
-    Math::Vector m_a_delta_angular_velocity;
-    Math::Vector m_b_delta_velocity;
-    Math::Vector m_b_delta_angular_velocity;
+    // Pointers rather than references so that manifolds can be moved around
+    // inside the Pair_cache
+    Physics_object*                              m_object_a;
+    Physics_object*                              m_object_b;
+    std::array<Persistent_contact, MAX_CONTACTS> m_contacts;
+    int                                          m_contact_count        = 0;
+    float                                        m_movement_threshold   = 0.05f;
+    float                                        m_persistent_threshold = 0.05f;
 };
 
 std::ostream& operator<<(std::ostream& o, const Contact_manifold& c);
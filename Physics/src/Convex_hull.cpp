@@ -0,0 +1,250 @@
+#include "Convex_hull.h"
+
+#include <Vector_math.h>
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace Dubious {
+namespace Physics {
+
+namespace {
+
+struct Face {
+    std::array<int, 3> v;
+    Math::Local_vector normal;
+    float              offset = 0;
+    std::vector<int>   outside;  // points in front of this face and no earlier one
+    bool               alive = true;
+};
+
+Face
+make_face(const std::vector<Math::Local_vector>& points, int a, int b, int c)
+{
+    Face face;
+    const Math::Local_vector n = Math::cross_product(points[b] - points[a], points[c] - points[a]);
+    face.v                     = {{a, b, c}};
+    face.normal                = n / n.length();
+    face.offset                = Math::dot_product(face.normal, points[a]);
+    return face;
+}
+
+float
+component(const Math::Local_vector& v, int axis)
+{
+    return axis == 0 ? v.x() : (axis == 1 ? v.y() : v.z());
+}
+
+float
+distance(const Face& face, const Math::Local_vector& p)
+{
+    return Math::dot_product(face.normal, p) - face.offset;
+}
+
+std::vector<Math::Local_vector>
+distinct_points(const std::vector<Math::Local_vector>& points)
+{
+    std::vector<Math::Local_vector> result;
+    for (const auto& p : points) {
+        if (std::find(result.begin(), result.end(), p) == result.end()) {
+            result.push_back(p);
+        }
+    }
+    return result;
+}
+
+}  // namespace
+
+Convex_hull::Convex_hull(const std::vector<Math::Local_vector>& points, size_t max_vertices)
+{
+    if (points.size() < 4) {
+        m_vertices = distinct_points(points);
+        return;
+    }
+    if (max_vertices != 0) {
+        max_vertices = std::max<size_t>(max_vertices, 4);
+    }
+
+    // Find the extreme points along each axis. They're also used to work out
+    // how close to a face a point needs to be before we call it "on" the face.
+    int   min_index[3] = {0, 0, 0};
+    int   max_index[3] = {0, 0, 0};
+    float scale        = 0;
+    for (int i = 0; i < static_cast<int>(points.size()); ++i) {
+        for (int axis = 0; axis < 3; ++axis) {
+            const float p = component(points[i], axis);
+            if (p < component(points[min_index[axis]], axis)) {
+                min_index[axis] = i;
+            }
+            if (p > component(points[max_index[axis]], axis)) {
+                max_index[axis] = i;
+            }
+        }
+    }
+    for (int axis = 0; axis < 3; ++axis) {
+        scale += std::max(std::abs(component(points[min_index[axis]], axis)),
+                          std::abs(component(points[max_index[axis]], axis)));
+    }
+    const float epsilon = 1e-5f * scale;
+
+    // The initial tetrahedron. The two extremes furthest apart, then the
+    // point furthest from the line between them, then the point furthest
+    // from that plane.
+    int   a    = 0;
+    int   b    = 0;
+    float best = -1;
+    for (int axis = 0; axis < 3; ++axis) {
+        const float d = (points[max_index[axis]] - points[min_index[axis]]).length_squared();
+        if (d > best) {
+            best = d;
+            a    = min_index[axis];
+            b    = max_index[axis];
+        }
+    }
+    if (best <= epsilon * epsilon) {
+        m_vertices = distinct_points(points);
+        return;
+    }
+    int c = 0;
+    best  = -1;
+    for (int i = 0; i < static_cast<int>(points.size()); ++i) {
+        const float d =
+            Math::cross_product(points[i] - points[a], points[b] - points[a]).length_squared();
+        if (d > best) {
+            best = d;
+            c    = i;
+        }
+    }
+    if (best <= epsilon * epsilon * (points[b] - points[a]).length_squared()) {
+        m_vertices = distinct_points(points);
+        return;
+    }
+    const Face base = make_face(points, a, b, c);
+    int        d    = 0;
+    best            = -1;
+    for (int i = 0; i < static_cast<int>(points.size()); ++i) {
+        const float dist = std::abs(distance(base, points[i]));
+        if (dist > best) {
+            best = dist;
+            d    = i;
+        }
+    }
+    if (best <= epsilon) {
+        m_vertices = distinct_points(points);
+        return;
+    }
+
+    std::vector<Face>        faces;
+    const Math::Local_vector centroid   = (points[a] + points[b] + points[c] + points[d]) / 4.0f;
+    const std::array<int, 3> corners[4] = {{{a, b, c}}, {{a, b, d}}, {{a, c, d}}, {{b, c, d}}};
+    for (const auto& corner : corners) {
+        Face face = make_face(points, corner[0], corner[1], corner[2]);
+        if (distance(face, centroid) > 0) {
+            face = make_face(points, corner[0], corner[2], corner[1]);
+        }
+        faces.push_back(std::move(face));
+    }
+
+    // Each point goes with the first face it's in front of. Points that
+    // aren't in front of any face are inside and are forgotten.
+    auto assign = [&](int point, size_t first_face) {
+        for (size_t f = first_face; f < faces.size(); ++f) {
+            if (faces[f].alive && distance(faces[f], points[point]) > epsilon) {
+                faces[f].outside.push_back(point);
+                return;
+            }
+        }
+    };
+    for (int i = 0; i < static_cast<int>(points.size()); ++i) {
+        if (i != a && i != b && i != c && i != d) {
+            assign(i, 0);
+        }
+    }
+
+    size_t                           vertex_count = 4;
+    std::vector<size_t>              visible;
+    std::vector<std::pair<int, int>> edges;
+    std::vector<int>                 orphans;
+    while (max_vertices == 0 || vertex_count < max_vertices) {
+        // The furthest point outside of any face is definitely on the hull
+        int   eye      = -1;
+        float eye_dist = 0;
+        for (const auto& face : faces) {
+            if (!face.alive) {
+                continue;
+            }
+            for (int point : face.outside) {
+                const float dist = distance(face, points[point]);
+                if (dist > eye_dist) {
+                    eye_dist = dist;
+                    eye      = point;
+                }
+            }
+        }
+        if (eye == -1) {
+            break;
+        }
+
+        // Every face the eye can see gets replaced. The edges around the
+        // outside of that patch (the horizon) are the edges whose other face
+        // can't see the eye.
+        visible.clear();
+        edges.clear();
+        orphans.clear();
+        for (size_t f = 0; f < faces.size(); ++f) {
+            if (faces[f].alive && distance(faces[f], points[eye]) > epsilon) {
+                visible.push_back(f);
+                for (int i = 0; i < 3; ++i) {
+                    edges.push_back(std::make_pair(faces[f].v[i], faces[f].v[(i + 1) % 3]));
+                }
+            }
+        }
+        const size_t first_new = faces.size();
+        for (const auto& edge : edges) {
+            const auto reverse = std::make_pair(edge.second, edge.first);
+            if (std::find(edges.begin(), edges.end(), reverse) == edges.end()) {
+                faces.push_back(make_face(points, edge.first, edge.second, eye));
+            }
+        }
+        for (size_t f : visible) {
+            faces[f].alive = false;
+            for (int point : faces[f].outside) {
+                if (point != eye) {
+                    orphans.push_back(point);
+                }
+            }
+            faces[f].outside.clear();
+        }
+        for (int point : orphans) {
+            assign(point, first_new);
+        }
+        ++vertex_count;
+    }
+
+    // Keep the vertices in their original order, so that whatever looks at
+    // them (like the support function, which takes the first of any ties)
+    // sees them the same way it would have without the hull.
+    std::vector<int> remap(points.size(), -1);
+    for (const auto& face : faces) {
+        if (face.alive) {
+            for (int v : face.v) {
+                remap[v] = 0;
+            }
+        }
+    }
+    for (size_t i = 0; i < points.size(); ++i) {
+        if (remap[i] == 0) {
+            remap[i] = static_cast<int>(m_vertices.size());
+            m_vertices.push_back(points[i]);
+        }
+    }
+    for (const auto& face : faces) {
+        if (face.alive) {
+            m_faces.push_back({{remap[face.v[0]], remap[face.v[1]], remap[face.v[2]]}});
+        }
+    }
+}
+
+}  // namespace Physics
+}  // namespace Dubious
@@ -0,0 +1,52 @@
+#ifndef INCLUDED_PHYSICS_CONVEXHULL
+#define INCLUDED_PHYSICS_CONVEXHULL
+
+#include <Vector.h>
+
+#include <vector>
+#include <array>
+
+namespace Dubious {
+namespace Physics {
+
+/// @brief The convex hull of a set of points
+///
+/// Built with quickhull. Start with a tetrahedron made from extreme points,
+/// then keep finding the point furthest outside of some face and growing the
+/// hull out to it, throwing away the faces it can see. Points that are inside
+/// the hull, or so close to a face that they don't change its shape, never
+/// become vertices. Those points can never be the answer to a support query,
+/// so there's no point in making GJK look at them.
+///
+/// If the points are flat (or a line, or a single point) there's no hull to
+/// build. In that case every distinct point is kept and there are no faces.
+class Convex_hull {
+public:
+    /// @brief Constructor
+    ///
+    /// @param points - [in] the points to wrap
+    /// @param max_vertices - [in] if not 0, stop growing the hull once it has
+    ///         this many vertices. Since each step adds the furthest point out
+    ///         the result is a decent approximation that sits slightly inside
+    ///         the real hull. Values below 4 are treated as 4.
+    Convex_hull(const std::vector<Math::Local_vector>& points, size_t max_vertices = 0);
+
+    Convex_hull(const Convex_hull&) = delete;
+    Convex_hull& operator=(const Convex_hull&) = delete;
+
+    /// @brief The hull vertices, in the same order they had in the input
+    const std::vector<Math::Local_vector>& vertices() const { return m_vertices; }
+
+    /// @brief Triangles as indices into vertices(), wound counter clockwise
+    ///         when seen from outside
+    const std::vector<std::array<int, 3>>& faces() const { return m_faces; }
+
+private:
+    std::vector<Math::Local_vector> m_vertices;
+    std::vector<std::array<int, 3>> m_faces;
+};
+
+}  // namespace Physics
+}  // namespace Dubious
+
+#endif
@@ -0,0 +1,328 @@
+#include "Dynamic_aabb_tree.h"
+
+#include <algorithm>
+
+namespace Dubious {
+namespace Physics {
+
+bool
+Dynamic_aabb_tree::Aabb::contains(const Aabb& other) const
+{
+    for (int axis = 0; axis < 3; ++axis) {
+        if (other.min[axis] < min[axis] || other.max[axis] > max[axis]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool
+Dynamic_aabb_tree::Aabb::overlaps(const Aabb& other) const
+{
+    for (int axis = 0; axis < 3; ++axis) {
+        if (max[axis] < other.min[axis] || other.max[axis] < min[axis]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+float
+Dynamic_aabb_tree::Aabb::surface_area() const
+{
+    const float x = max[0] - min[0];
+    const float y = max[1] - min[1];
+    const float z = max[2] - min[2];
+    return 2.0f * (x * y + y * z + z * x);
+}
+
+Dynamic_aabb_tree::Aabb
+Dynamic_aabb_tree::Aabb::merge(const Aabb& a, const Aabb& b)
+{
+    Aabb result;
+    for (int axis = 0; axis < 3; ++axis) {
+        result.min[axis] = std::min(a.min[axis], b.min[axis]);
+        result.max[axis] = std::max(a.max[axis], b.max[axis]);
+    }
+    return result;
+}
+
+int
+Dynamic_aabb_tree::insert(const Aabb& fat_box, size_t user_data)
+{
+    const int leaf          = allocate_node();
+    m_nodes[leaf].box       = fat_box;
+    m_nodes[leaf].user_data = user_data;
+    m_nodes[leaf].height    = 0;
+    insert_leaf(leaf);
+    return leaf;
+}
+
+void
+Dynamic_aabb_tree::remove(int proxy)
+{
+    remove_leaf(proxy);
+    free_node(proxy);
+}
+
+bool
+Dynamic_aabb_tree::move(int proxy, const Aabb& tight_box, const Aabb& fat_box)
+{
+    if (m_nodes[proxy].box.contains(tight_box)) {
+        return false;
+    }
+    remove_leaf(proxy);
+    m_nodes[proxy].box = fat_box;
+    insert_leaf(proxy);
+    return true;
+}
+
+void
+Dynamic_aabb_tree::overlapping_pairs(std::vector<std::tuple<size_t, size_t>>& pairs) const
+{
+    if (m_root == NULL_NODE) {
+        return;
+    }
+    // Descend the tree against itself. A node paired with itself means "find
+    // everything overlapping inside this subtree", which is both of its kids
+    // against themselves plus the two kids against each other.
+    m_stack.clear();
+    m_stack.push_back(std::make_tuple(m_root, m_root));
+    while (!m_stack.empty()) {
+        const int a = std::get<0>(m_stack.back());
+        const int b = std::get<1>(m_stack.back());
+        m_stack.pop_back();
+        const Node& node_a = m_nodes[a];
+        const Node& node_b = m_nodes[b];
+        if (a == b) {
+            if (node_a.is_leaf()) {
+                continue;
+            }
+            m_stack.push_back(std::make_tuple(node_a.child1, node_a.child1));
+            m_stack.push_back(std::make_tuple(node_a.child2, node_a.child2));
+            m_stack.push_back(std::make_tuple(node_a.child1, node_a.child2));
+            continue;
+        }
+        if (!node_a.box.overlaps(node_b.box)) {
+            continue;
+        }
+        if (node_a.is_leaf() && node_b.is_leaf()) {
+            pairs.push_back(std::make_tuple(std::min(node_a.user_data, node_b.user_data),
+                                            std::max(node_a.user_data, node_b.user_data)));
+        }
+        else if (node_b.is_leaf() ||
+                 (!node_a.is_leaf() && node_a.box.surface_area() > node_b.box.surface_area())) {
+            m_stack.push_back(std::make_tuple(node_a.child1, b));
+            m_stack.push_back(std::make_tuple(node_a.child2, b));
+        }
+        else {
+            m_stack.push_back(std::make_tuple(a, node_b.child1));
+            m_stack.push_back(std::make_tuple(a, node_b.child2));
+        }
+    }
+}
+
+int
+Dynamic_aabb_tree::allocate_node()
+{
+    if (m_free_list == NULL_NODE) {
+        m_nodes.push_back(Node());
+        m_nodes.back().height = -1;
+        m_free_list           = static_cast<int>(m_nodes.size()) - 1;
+        m_nodes.back().parent = NULL_NODE;
+    }
+    // the free list is threaded through the parent index
+    const int node       = m_free_list;
+    m_free_list          = m_nodes[node].parent;
+    m_nodes[node].parent = NULL_NODE;
+    m_nodes[node].child1 = NULL_NODE;
+    m_nodes[node].child2 = NULL_NODE;
+    m_nodes[node].height = 0;
+    return node;
+}
+
+void
+Dynamic_aabb_tree::free_node(int node)
+{
+    m_nodes[node].parent = m_free_list;
+    m_nodes[node].height = -1;
+    m_free_list          = node;
+}
+
+void
+Dynamic_aabb_tree::insert_leaf(int leaf)
+{
+    if (m_root == NULL_NODE) {
+        m_root               = leaf;
+        m_nodes[leaf].parent = NULL_NODE;
+        return;
+    }
+
+    // Walk down the tree looking for the cheapest sibling. The cost of making
+    // a new parent here is the area of the combined box, and every ancestor
+    // above it also has to grow to fit the leaf.
+    const Aabb leaf_box = m_nodes[leaf].box;
+    int        index    = m_root;
+    while (!m_nodes[index].is_leaf()) {
+        const int   child1        = m_nodes[index].child1;
+        const int   child2        = m_nodes[index].child2;
+        const float area          = m_nodes[index].box.surface_area();
+        const float combined_area = Aabb::merge(m_nodes[index].box, leaf_box).surface_area();
+
+        // cost of creating a new parent for this node and the new leaf
+        const float cost = 2.0f * combined_area;
+        // minimum cost of pushing the leaf further down the tree
+        const float inheritance_cost = 2.0f * (combined_area - area);
+
+        auto descend_cost = [&](int child) {
+            const float new_area = Aabb::merge(leaf_box, m_nodes[child].box).surface_area();
+            if (m_nodes[child].is_leaf()) {
+                return new_area + inheritance_cost;
+            }
+            return new_area - m_nodes[child].box.surface_area() + inheritance_cost;
+        };
+        const float cost1 = descend_cost(child1);
+        const float cost2 = descend_cost(child2);
+
+        if (cost < cost1 && cost < cost2) {
+            break;
+        }
+        index = cost1 < cost2 ? child1 : child2;
+    }
+    const int sibling = index;
+
+    const int old_parent          = m_nodes[sibling].parent;
+    const int new_parent          = allocate_node();
+    m_nodes[new_parent].parent    = old_parent;
+    m_nodes[new_parent].user_data = 0;
+    m_nodes[new_parent].box       = Aabb::merge(leaf_box, m_nodes[sibling].box);
+    m_nodes[new_parent].height    = m_nodes[sibling].height + 1;
+    m_nodes[new_parent].child1    = sibling;
+    m_nodes[new_parent].child2    = leaf;
+    m_nodes[sibling].parent       = new_parent;
+    m_nodes[leaf].parent          = new_parent;
+    if (old_parent == NULL_NODE) {
+        m_root = new_parent;
+    }
+    else if (m_nodes[old_parent].child1 == sibling) {
+        m_nodes[old_parent].child1 = new_parent;
+    }
+    else {
+        m_nodes[old_parent].child2 = new_parent;
+    }
+
+    // walk back up fixing heights and boxes
+    refit_ancestors(m_nodes[leaf].parent);
+}
+
+void
+Dynamic_aabb_tree::remove_leaf(int leaf)
+{
+    if (leaf == m_root) {
+        m_root = NULL_NODE;
+        return;
+    }
+
+    const int parent       = m_nodes[leaf].parent;
+    const int grand_parent = m_nodes[parent].parent;
+    const int sibling =
+        m_nodes[parent].child1 == leaf ? m_nodes[parent].child2 : m_nodes[parent].child1;
+
+    if (grand_parent == NULL_NODE) {
+        m_root                  = sibling;
+        m_nodes[sibling].parent = NULL_NODE;
+        free_node(parent);
+        return;
+    }
+
+    // the sibling takes the parent's place
+    if (m_nodes[grand_parent].child1 == parent) {
+        m_nodes[grand_parent].child1 = sibling;
+    }
+    else {
+        m_nodes[grand_parent].child2 = sibling;
+    }
+    m_nodes[sibling].parent = grand_parent;
+    free_node(parent);
+
+    refit_ancestors(grand_parent);
+}
+
+void
+Dynamic_aabb_tree::refit_ancestors(int index)
+{
+    while (index != NULL_NODE) {
+        index              = balance(index);
+        Node&       node   = m_nodes[index];
+        const Node& child1 = m_nodes[node.child1];
+        const Node& child2 = m_nodes[node.child2];
+        node.height        = 1 + std::max(child1.height, child2.height);
+        node.box           = Aabb::merge(child1.box, child2.box);
+        index              = node.parent;
+    }
+}
+
+int
+Dynamic_aabb_tree::balance(int a)
+{
+    // If one side of A is more than one level taller than the other, rotate
+    // the taller child up to take A's place. Returns the new root of this
+    // subtree.
+    if (m_nodes[a].is_leaf() || m_nodes[a].height < 2) {
+        return a;
+    }
+
+    const int b    = m_nodes[a].child1;
+    const int c    = m_nodes[a].child2;
+    const int skew = m_nodes[c].height - m_nodes[b].height;
+
+    auto rotate_up = [&](int up, int other) {
+        // "up" is a child of A that gets promoted, "other" is A's other child
+        const int f = m_nodes[up].child1;
+        const int g = m_nodes[up].child2;
+
+        m_nodes[up].child1 = a;
+        m_nodes[up].parent = m_nodes[a].parent;
+        m_nodes[a].parent  = up;
+
+        const int up_parent = m_nodes[up].parent;
+        if (up_parent == NULL_NODE) {
+            m_root = up;
+        }
+        else if (m_nodes[up_parent].child1 == a) {
+            m_nodes[up_parent].child1 = up;
+        }
+        else {
+            m_nodes[up_parent].child2 = up;
+        }
+
+        // the taller grand child stays with the promoted node, the shorter goes to A
+        const int keep  = m_nodes[f].height > m_nodes[g].height ? f : g;
+        const int given = keep == f ? g : f;
+
+        m_nodes[up].child2    = keep;
+        m_nodes[given].parent = a;
+        if (m_nodes[a].child1 == up) {
+            m_nodes[a].child1 = given;
+        }
+        else {
+            m_nodes[a].child2 = given;
+        }
+        m_nodes[a].box     = Aabb::merge(m_nodes[other].box, m_nodes[given].box);
+        m_nodes[up].box    = Aabb::merge(m_nodes[a].box, m_nodes[keep].box);
+        m_nodes[a].height  = 1 + std::max(m_nodes[other].height, m_nodes[given].height);
+        m_nodes[up].height = 1 + std::max(m_nodes[a].height, m_nodes[keep].height);
+        return up;
+    };
+
+    if (skew > 1) {
+        return rotate_up(c, b);
+    }
+    if (skew < -1) {
+        return rotate_up(b, c);
+    }
+    return a;
+}
+
+}  // namespace Physics
+}  // namespace Dubious
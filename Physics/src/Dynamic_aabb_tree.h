@@ -0,0 +1,113 @@
+#ifndef INCLUDED_PHYSICS_DYNAMICAABBTREE
+#define INCLUDED_PHYSICS_DYNAMICAABBTREE
+
+#include <vector>
+#include <tuple>
+
+namespace Dubious {
+namespace Physics {
+
+/// @brief A dynamic bounding volume tree of axis aligned boxes
+///
+/// Leaves hold a "fat" box, which is larger than the thing it's wrapping. As
+/// long as the thing stays inside its fat box the tree doesn't need to change
+/// at all, so most steps touch nothing. When something does escape it's removed
+/// and reinserted with a new fat box. Inserts pick the sibling that grows the
+/// tree's surface area the least, and the tree is rebalanced with rotations on
+/// the way back up, the same way as an AVL tree.
+/// This is pretty much the b2DynamicTree from Box2D.
+class Dynamic_aabb_tree {
+public:
+    /// @brief Axis aligned bounding box
+    struct Aabb {
+        float min[3];
+        float max[3];
+
+        /// @brief Does this box completely contain the other
+        bool contains(const Aabb& other) const;
+
+        /// @brief Do the two boxes touch
+        bool overlaps(const Aabb& other) const;
+
+        /// @brief Surface area, used as the cost when building the tree
+        float surface_area() const;
+
+        /// @brief Smallest box containing both a and b
+        static Aabb merge(const Aabb& a, const Aabb& b);
+    };
+
+    static const int NULL_NODE = -1;
+
+    /// @brief Constructor
+    Dynamic_aabb_tree() = default;
+
+    Dynamic_aabb_tree(const Dynamic_aabb_tree&) = delete;
+    Dynamic_aabb_tree& operator=(const Dynamic_aabb_tree&) = delete;
+
+    /// @brief Add a new leaf
+    ///
+    /// @param fat_box - [in] the enlarged box to store in the leaf
+    /// @param user_data - [in] whatever the caller wants back in overlapping_pairs
+    /// @returns the proxy used to refer to this leaf in the future
+    int insert(const Aabb& fat_box, size_t user_data);
+
+    /// @brief Remove a leaf
+    ///
+    /// @param proxy - [in] as returned from insert
+    void remove(int proxy);
+
+    /// @brief Move a leaf
+    ///
+    /// If the tight box is still inside the leaf's fat box then nothing happens.
+    /// Otherwise the leaf is removed and reinserted with the new fat box.
+    /// @param proxy - [in] as returned from insert
+    /// @param tight_box - [in] the box that exactly wraps the object
+    /// @param fat_box - [in] the new enlarged box, only used if the leaf is reinserted
+    /// @returns true if the leaf was reinserted
+    bool move(int proxy, const Aabb& tight_box, const Aabb& fat_box);
+
+    /// @brief Leaf box accessor
+    const Aabb& fat_box(int proxy) const { return m_nodes[proxy].box; }
+
+    /// @brief Find all leaves whose boxes overlap
+    ///
+    /// Walks the tree against itself, so whole subtrees that don't overlap are
+    /// skipped at once. Pairs are returned as user data with the lower value first.
+    /// Not thread safe, it uses scratch space in the tree.
+    /// @param pairs - [out] the overlapping pairs, appended
+    void overlapping_pairs(std::vector<std::tuple<size_t, size_t>>& pairs) const;
+
+    /// @brief Height of the tree, mostly for testing
+    int height() const { return m_root == NULL_NODE ? 0 : m_nodes[m_root].height; }
+
+private:
+    struct Node {
+        Aabb   box;
+        size_t user_data;
+        int    parent;
+        int    child1;
+        int    child2;
+        int    height;  // leaf = 0, free node = -1
+
+        bool is_leaf() const { return child1 == NULL_NODE; }
+    };
+
+    std::vector<Node> m_nodes;
+    int               m_root      = NULL_NODE;
+    int               m_free_list = NULL_NODE;
+
+    // Scratch space for overlapping_pairs, kept so it doesn't allocate every step
+    mutable std::vector<std::tuple<int, int>> m_stack;
+
+    int  allocate_node();
+    void free_node(int node);
+    void insert_leaf(int leaf);
+    void remove_leaf(int leaf);
+    void refit_ancestors(int node);
+    int  balance(int node);
+};
+
+}  // namespace Physics
+}  // namespace Dubious
+
+#endif
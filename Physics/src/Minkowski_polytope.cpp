@@ -2,6 +2,8 @@
 
 #include <tuple>
 #include <cassert>
+#include <stdexcept>
+#include <utility>
 
 namespace Dubious {
 namespace Physics {
@@ -12,69 +14,205 @@ Minkowski_polytope::Minkowski_polytope(const Minkowski_simplex& simplex)
         throw std::runtime_error(
             "Attempting to create polytope from simplex that is not tetrahedron");
     }
-    auto        v_array = simplex.v();
-    const auto& a       = v_array[3];
-    const auto& b       = v_array[2];
-    const auto& c       = v_array[1];
-    const auto& d       = v_array[0];
-    m_triangles.reserve(20);
-    m_triangles.emplace_back(a, b, c);
-    m_triangles.emplace_back(a, c, d);
-    m_triangles.emplace_back(a, d, b);
-    m_triangles.emplace_back(b, d, c);
+    auto v_array = simplex.v();
+    for (int i = 0; i < 4; ++i) {
+        m_vertices[i] = v_array[3 - i];
+    }
+    m_vertex_count = 4;
+    // Vertices are a, b, c, d. The half edges are wired up by hand, the
+    // same way push_back does it for each new fan of faces.
+    const int abc  = add_face(0, 1, 2);
+    const int acd  = add_face(0, 2, 3);
+    const int adb  = add_face(0, 3, 1);
+    const int bdc  = add_face(1, 3, 2);
+    auto      link = [this](int face_a, int edge_a, int face_b, int edge_b) {
+        m_faces[face_a].twin[edge_a] = face_b * 3 + edge_b;
+        m_faces[face_b].twin[edge_b] = face_a * 3 + edge_a;
+    };
+    link(abc, 0, adb, 2);  // ab
+    link(abc, 1, bdc, 2);  // bc
+    link(abc, 2, acd, 0);  // ca
+    link(acd, 1, bdc, 1);  // cd
+    link(acd, 2, adb, 0);  // da
+    link(adb, 1, bdc, 0);  // db
 }
 
 std::tuple<Minkowski_polytope::Triangle, float>
 Minkowski_polytope::find_closest_triangle()
 {
-    auto                                distance = std::numeric_limits<float>::max();
-    const Minkowski_polytope::Triangle* ret      = nullptr;
-    for (const auto& t : m_triangles) {
-        auto dot = Math::dot_product(t.a.v(), Math::Vector(t.normal));
-        if (dot < distance) {
-            ret      = &t;
-            distance = dot;
-        }
-    }
-    assert(ret && "It shouldn't be possible to select 0 triangles");
-    return std::make_tuple(*ret, distance);
+    assert(m_heap_size > 0 && "It shouldn't be possible to select 0 triangles");
+    const Face& face = m_faces[m_heap[0]];
+    Triangle    ret;
+    ret.a      = m_vertices[face.v[0]];
+    ret.b      = m_vertices[face.v[1]];
+    ret.c      = m_vertices[face.v[2]];
+    ret.normal = face.normal;
+    return std::make_tuple(ret, face.distance);
 }
 
 void
 Minkowski_polytope::push_back(Minkowski_vector&& v)
 {
-    m_edges.clear();
-    m_edges.reserve(60);
-    for (auto iter = m_triangles.cbegin(); iter != m_triangles.cend();) {
-        // I've seen cases of touching objects where this dot product comes out
-        // to something times 10 to -7. So we can't compare against 0
-        if (Math::dot_product(Math::Vector(iter->normal), v.v() - iter->a.v()) > 0.00001) {
-            // This triangle can be "seen" from the new point, it needs to
-            // be removed.
-            push_edge(iter->a, iter->b);
-            push_edge(iter->b, iter->c);
-            push_edge(iter->c, iter->a);
-            iter = m_triangles.erase(iter);
+    if (m_vertex_count == MAX_VERTICES) {
+        throw std::runtime_error("Minkowski_polytope is full");
+    }
+    // EPA always pushes the support point in the direction of the closest
+    // face, so that face is almost always the one to start from.
+    const Math::Vector& p    = v.v();
+    int                 seed = -1;
+    for (int i = 0; i < m_heap_size && seed == -1; ++i) {
+        if (can_see(m_faces[m_heap[i]], p)) {
+            seed = m_heap[i];
         }
-        else {
-            ++iter;
+    }
+    if (seed == -1) {
+        return;
+    }
+
+    // Walk out from the seed across the edges, freeing every face that
+    // can see the new point. Where the walk hits a face that can't, that
+    // edge is on the horizon. Keep the half edge on the face that stays.
+    ++m_push_count;
+    int stack_size        = 0;
+    int horizon_size      = 0;
+    m_faces[seed].removed = m_push_count;
+    m_stack[stack_size++] = seed;
+    while (stack_size > 0) {
+        const int face = m_stack[--stack_size];
+        for (int i = 0; i < 3; ++i) {
+            const int twin = m_faces[face].twin[i];
+            Face&     next = m_faces[twin / 3];
+            if (next.removed == m_push_count) {
+                continue;
+            }
+            if (can_see(next, p)) {
+                next.removed          = m_push_count;
+                m_stack[stack_size++] = twin / 3;
+            }
+            else {
+                m_horizon[horizon_size++] = twin;
+            }
         }
+        heap_remove(face);
+        m_free[m_free_count++] = face;
+    }
+
+    // Fill the hole with a fan of faces from the new point. Each one
+    // knows the face across the horizon, and m_fan (by the vertex its
+    // horizon edge starts on) finds its neighbours in the fan.
+    const int w   = m_vertex_count++;
+    m_vertices[w] = std::move(v);
+    for (int i = 0; i < horizon_size; ++i) {
+        const int twin  = m_horizon[i];
+        const int start = m_faces[twin / 3].v[(twin % 3 + 1) % 3];
+        const int end   = m_faces[twin / 3].v[twin % 3];
+        const int face  = add_face(w, start, end);
+        m_faces[face].twin[1]            = twin;
+        m_faces[twin / 3].twin[twin % 3] = face * 3 + 1;
+        m_fan[start]                     = face;
+        m_horizon[i]                     = face;
+    }
+    for (int i = 0; i < horizon_size; ++i) {
+        const int face        = m_horizon[i];
+        const int next        = m_fan[m_faces[face].v[2]];
+        m_faces[face].twin[2] = next * 3;
+        m_faces[next].twin[0] = face * 3 + 2;
+    }
+}
+
+int
+Minkowski_polytope::add_face(int a, int b, int c)
+{
+    int face;
+    if (m_free_count > 0) {
+        face = m_free[--m_free_count];
+    }
+    else {
+        assert(m_face_count < MAX_FACES && "Out of polytope faces");
+        face = m_face_count++;
+    }
+    Face& f  = m_faces[face];
+    f.v[0]   = a;
+    f.v[1]   = b;
+    f.v[2]   = c;
+    f.normal = Math::cross_product(m_vertices[b].v() - m_vertices[a].v(),
+                                   m_vertices[c].v() - m_vertices[a].v());
+    f.distance = Math::dot_product(m_vertices[a].v(), Math::Vector(f.normal));
+    f.removed  = 0;
+    heap_push(face);
+    return face;
+}
+
+bool
+Minkowski_polytope::can_see(const Face& face, const Math::Vector& p) const
+{
+    // I've seen cases of touching objects where this dot product comes out
+    // to something times 10 to -7. So we can't compare against 0
+    return Math::dot_product(Math::Vector(face.normal), p - m_vertices[face.v[0]].v()) > 0.00001;
+}
+
+void
+Minkowski_polytope::heap_push(int face)
+{
+    heap_place(m_heap_size++, face);
+    sift_up(m_heap_size - 1);
+}
+
+void
+Minkowski_polytope::heap_remove(int face)
+{
+    const int index = m_faces[face].heap_index;
+    const int last  = m_heap[--m_heap_size];
+    m_faces[face].heap_index = -1;
+    if (last != face) {
+        heap_place(index, last);
+        sift_down(index);
+        sift_up(index);
     }
-    for (const auto& e : m_edges) {
-        m_triangles.emplace_back(v, e.a, e.b);
+}
+
+void
+Minkowski_polytope::heap_place(int index, int face)
+{
+    m_heap[index]            = face;
+    m_faces[face].heap_index = index;
+}
+
+void
+Minkowski_polytope::sift_up(int index)
+{
+    const int face = m_heap[index];
+    while (index > 0) {
+        const int parent = (index - 1) / 2;
+        if (m_faces[m_heap[parent]].distance <= m_faces[face].distance) {
+            break;
+        }
+        heap_place(index, m_heap[parent]);
+        index = parent;
     }
+    heap_place(index, face);
 }
 
 void
-Minkowski_polytope::push_edge(const Minkowski_vector& a, const Minkowski_vector& b)
+Minkowski_polytope::sift_down(int index)
 {
-    for (auto iter = m_edges.cbegin(), end = m_edges.cend(); iter != end; ++iter) {
-        if (iter->a.v() == b.v() && iter->b.v() == a.v()) {
-            m_edges.erase(iter);
-            return;
+    const int face = m_heap[index];
+    while (true) {
+        int child = index * 2 + 1;
+        if (child >= m_heap_size) {
+            break;
+        }
+        if (child + 1 < m_heap_size &&
+            m_faces[m_heap[child + 1]].distance < m_faces[m_heap[child]].distance) {
+            ++child;
+        }
+        if (m_faces[face].distance <= m_faces[m_heap[child]].distance) {
+            break;
         }
+        heap_place(index, m_heap[child]);
+        index = child;
     }
-    m_edges.emplace_back(a, b);
+    heap_place(index, face);
 }
 
 }  // namespace Physics
@@ -5,7 +5,7 @@
 
 #include <Vector_math.h>
 
-#include <list>
+#include <tuple>
 
 namespace Dubious {
 namespace Physics {
@@ -19,8 +19,22 @@ namespace Physics {
 /// NOTE: This class is absolutely a hot spot when profiling. As
 /// such it uses a number of optimizations that I wouldn't usually
 /// suggest.
+///
+/// Everything lives in fixed size arrays, so nothing is allocated. The
+/// faces are a half edge mesh: each edge knows the edge running the other
+/// way on the neighbouring face, so finding the faces a new point can see
+/// is a walk out from the one it's nearest to rather than a test of every
+/// face. Edges are matched by vertex index, never by comparing positions.
+/// The faces also sit in a heap ordered by distance from the origin, so
+/// the closest one is always on top.
 class Minkowski_polytope {
 public:
+    /// @brief The most vertices the polytope can hold
+    ///
+    /// The four from the simplex plus one for each push_back. EPA gives up
+    /// long before this, pushing more will throw an exception.
+    static const int MAX_VERTICES = 32;
+
     /// @brief Usable Constructor
     ///
     /// constructs the polytope from the simplex. If the simplex is not
@@ -79,20 +93,44 @@ public:
     void push_back(Minkowski_vector&& v);
 
 private:
-    struct Edge {
-        Edge(const Minkowski_vector& p1, const Minkowski_vector& p2) : a(p1), b(p2) {}
-        Minkowski_vector a;
-        Minkowski_vector b;
+    // A closed triangle mesh has 2V - 4 faces. Faces are freed before the
+    // ones that replace them are made, so this is never exceeded.
+    static const int MAX_FACES = 2 * MAX_VERTICES;
+
+    // Edge i of a face runs from v[i] to v[(i + 1) % 3]. Half edges are
+    // numbered face * 3 + i, and twin[i] is the half edge on the other side.
+    struct Face {
+        int               v[3];
+        int               twin[3];
+        Math::Unit_vector normal;
+        float             distance;
+        int               heap_index;  // -1 once the face is freed
+        int               removed;     // the push_back that removed it
     };
 
-    // This function takes 2 points (and not an Edge) as an optimization.
-    // This way we can defer Edge creation until we actually know we need
-    // to push one onto the m_edges vector.
-    void push_edge(const Minkowski_vector& a, const Minkowski_vector& b);
-
-    // These are vectors and not lists. I profiled this and vector was faster
-    std::vector<Triangle> m_triangles;
-    std::vector<Edge>     m_edges;
+    int  add_face(int a, int b, int c);
+    bool can_see(const Face& face, const Math::Vector& p) const;
+
+    void heap_push(int face);
+    void heap_remove(int face);
+    void heap_place(int index, int face);
+    void sift_up(int index);
+    void sift_down(int index);
+
+    Minkowski_vector m_vertices[MAX_VERTICES];
+    int              m_vertex_count = 0;
+    Face             m_faces[MAX_FACES];
+    int              m_face_count = 0;
+    int              m_free[MAX_FACES];
+    int              m_free_count = 0;
+    int              m_heap[MAX_FACES];
+    int              m_heap_size = 0;
+    int              m_push_count = 0;
+
+    // Scratch space for push_back
+    int m_stack[MAX_FACES];
+    int m_horizon[MAX_VERTICES];
+    int m_fan[MAX_VERTICES];
 };
 
 }  // namespace Physics
@@ -26,9 +26,15 @@ public:
     /// @param v - [in] point on the Simplex/Polytope
     /// @param support_a - [in] support from object A
     /// @param support_b - [in] support from object B
+    /// @param index_a - [in] index of the model vertex support_a came from
+    /// @param index_b - [in] index of the model vertex support_b came from
     Minkowski_vector(const Math::Vector& v, const Math::Vector& support_a,
-                     const Math::Vector& support_b)
-        : m_v(v), m_support_a(support_a), m_support_b(support_b)
+                     const Math::Vector& support_b, int index_a = 0, int index_b = 0)
+        : m_v(v)
+        , m_support_a(support_a)
+        , m_support_b(support_b)
+        , m_index_a(index_a)
+        , m_index_b(index_b)
     {
     }
 
@@ -44,10 +50,19 @@ public:
     /// @brief Accessor for support B
     const Math::Vector& support_b() const { return m_support_b; }
 
+    /// @brief Accessors for the model vertex indices
+    ///
+    /// These let a simplex be rebuilt from the same vertices after the
+    /// objects have moved.
+    int index_a() const { return m_index_a; }
+    int index_b() const { return m_index_b; }
+
 private:
     Math::Vector m_v;
     Math::Vector m_support_a;
     Math::Vector m_support_b;
+    int          m_index_a = 0;
+    int          m_index_b = 0;
 };
 
 }  // namespace Physics
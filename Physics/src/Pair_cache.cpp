@@ -0,0 +1,265 @@
+#include "Pair_cache.h"
+#include "Physics_object.h"
+
+#include <algorithm>
+
+namespace Dubious {
+namespace Physics {
+
+Pair_cache::Pair_cache(float manifold_persistent_threshold, float manifold_movement_threshold)
+    : m_manifold_persistent_threshold(manifold_persistent_threshold)
+    , m_manifold_movement_threshold(manifold_movement_threshold)
+    , m_table(64, Slot{EMPTY, nullptr})
+{
+}
+
+void
+Pair_cache::begin_step()
+{
+    ++m_stamp;
+}
+
+Contact_manifold&
+Pair_cache::touch(Physics_object& a, Physics_object& b)
+{
+    const uint64_t key   = pack(a.id(), b.id());
+    Entry*         entry = lookup(key);
+    if (entry == nullptr) {
+        const Entry new_entry(key, a, b, m_manifold_persistent_threshold,
+                              m_manifold_movement_threshold);
+        if (m_free.empty()) {
+            m_entries.push_back(new_entry);
+            entry = &m_entries.back();
+        }
+        else {
+            entry  = m_free.back();
+            *entry = new_entry;
+            m_free.pop_back();
+        }
+        // Growing is the only time the table is filled again from scratch, it
+        // doubles each time so it doesn't happen often
+        if ((m_slots_used + 1) * 2 > m_table.size()) {
+            std::vector<Slot> bigger(m_table.size() * 2, Slot{EMPTY, nullptr});
+            for (const Slot& slot : m_table) {
+                if (slot.key != EMPTY) {
+                    insert_slot(bigger, slot.key, slot.entry);
+                }
+            }
+            m_table.swap(bigger);
+        }
+        insert_slot(m_table, key, entry);
+        ++m_slots_used;
+        m_new_keys.push_back(Sorted_key{key, entry});
+    }
+    else {
+        unlink(*entry);
+    }
+    entry->stamp = m_stamp;
+    push_front(*entry);
+    return entry->manifold;
+}
+
+void
+Pair_cache::end_step()
+{
+    // Everything touched this step was moved to the front, so the stale
+    // entries are all sitting at the back.
+    while (m_tail != nullptr && m_tail->stamp != m_stamp) {
+        Entry& entry = *m_tail;
+        unlink(entry);
+        erase_slot(entry.key);
+        m_stale_keys.push_back(entry.key);
+        m_free.push_back(&entry);
+    }
+    if (!m_new_keys.empty() || !m_stale_keys.empty()) {
+        merge_keys();
+    }
+}
+
+// The new and stale keys are sorted, then one pass over m_sorted drops the
+// stale ones and slots the new ones in. The events come out in key order too.
+void
+Pair_cache::merge_keys()
+{
+    const auto by_key = [](const Sorted_key& a, const Sorted_key& b) { return a.key < b.key; };
+    std::sort(m_new_keys.begin(), m_new_keys.end(), by_key);
+    std::sort(m_stale_keys.begin(), m_stale_keys.end());
+    for (const auto& new_key : m_new_keys) {
+        m_began.push_back(unpack(new_key.key));
+    }
+    for (uint64_t stale_key : m_stale_keys) {
+        m_ended.push_back(unpack(stale_key));
+    }
+
+    m_merged.clear();
+    auto new_key   = m_new_keys.begin();
+    auto stale_key = m_stale_keys.begin();
+    for (const auto& sorted : m_sorted) {
+        while (new_key != m_new_keys.end() && new_key->key < sorted.key) {
+            m_merged.push_back(*new_key++);
+        }
+        if (stale_key != m_stale_keys.end() && *stale_key == sorted.key) {
+            ++stale_key;
+            continue;
+        }
+        m_merged.push_back(sorted);
+    }
+    m_merged.insert(m_merged.end(), new_key, m_new_keys.end());
+    m_sorted.swap(m_merged);
+
+    m_new_keys.clear();
+    m_stale_keys.clear();
+}
+
+void
+Pair_cache::clear_events()
+{
+    m_began.clear();
+    m_ended.clear();
+}
+
+Pair_cache::iterator
+Pair_cache::find(const Physics_object_ids& ids)
+{
+    return find_sorted(pack(std::get<0>(ids), std::get<1>(ids)));
+}
+
+Pair_cache::const_iterator
+Pair_cache::find(const Physics_object_ids& ids) const
+{
+    return find_sorted(pack(std::get<0>(ids), std::get<1>(ids)));
+}
+
+Collision_solver::Pair_state*
+Pair_cache::state(const Physics_object_ids& ids)
+{
+    Entry* entry = lookup(pack(std::get<0>(ids), std::get<1>(ids)));
+    return entry == nullptr ? nullptr : &entry->state;
+}
+
+const Collision_solver::Pair_state*
+Pair_cache::state(const Physics_object_ids& ids) const
+{
+    const Entry* entry = lookup(pack(std::get<0>(ids), std::get<1>(ids)));
+    return entry == nullptr ? nullptr : &entry->state;
+}
+
+uint64_t
+Pair_cache::pack(int a, int b)
+{
+    return (static_cast<uint64_t>(static_cast<uint32_t>(a)) << 32) | static_cast<uint32_t>(b);
+}
+
+Pair_cache::Physics_object_ids
+Pair_cache::unpack(uint64_t key)
+{
+    return std::make_tuple(static_cast<int>(key >> 32), static_cast<int>(key & 0xffffffff));
+}
+
+size_t
+Pair_cache::hash(uint64_t key)
+{
+    // MurmurHash3 finalizer, the ids are small and sequential so they need a
+    // good mixing before they're any use as a hash
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdull;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ull;
+    key ^= key >> 33;
+    return static_cast<size_t>(key);
+}
+
+Pair_cache::Entry*
+Pair_cache::lookup(uint64_t key) const
+{
+    const size_t mask = m_table.size() - 1;
+    for (size_t i = hash(key) & mask;; i = (i + 1) & mask) {
+        const Slot& slot = m_table[i];
+        if (slot.key == key) {
+            return slot.entry;
+        }
+        if (slot.key == EMPTY) {
+            return nullptr;
+        }
+    }
+}
+
+void
+Pair_cache::insert_slot(std::vector<Slot>& table, uint64_t key, Entry* entry)
+{
+    const size_t mask = table.size() - 1;
+    size_t       i    = hash(key) & mask;
+    while (table[i].key != EMPTY) {
+        i = (i + 1) & mask;
+    }
+    table[i].key   = key;
+    table[i].entry = entry;
+}
+
+// Backward shift deletion. Rather than leave a tombstone, anything further
+// along the probe run that could have gone in the emptied slot is moved back
+// into it, and so on until the run ends. So lookups never have to skip over
+// dead slots and the table never needs cleaning up.
+void
+Pair_cache::erase_slot(uint64_t key)
+{
+    const size_t mask = m_table.size() - 1;
+    size_t       i    = hash(key) & mask;
+    while (m_table[i].key != key) {
+        i = (i + 1) & mask;
+    }
+    for (size_t j = (i + 1) & mask; m_table[j].key != EMPTY; j = (j + 1) & mask) {
+        // The slot at j can move back to i if its home isn't between the two
+        const size_t home = hash(m_table[j].key) & mask;
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            m_table[i] = m_table[j];
+            i          = j;
+        }
+    }
+    m_table[i] = Slot{EMPTY, nullptr};
+    --m_slots_used;
+}
+
+std::vector<Pair_cache::Sorted_key>::const_iterator
+Pair_cache::find_sorted(uint64_t key) const
+{
+    const auto iter = std::lower_bound(
+        m_sorted.begin(), m_sorted.end(), key,
+        [](const Sorted_key& sorted, uint64_t key) { return sorted.key < key; });
+    return iter != m_sorted.end() && iter->key == key ? iter : m_sorted.end();
+}
+
+void
+Pair_cache::unlink(Entry& entry)
+{
+    if (entry.previous != nullptr) {
+        entry.previous->next = entry.next;
+    }
+    else {
+        m_head = entry.next;
+    }
+    if (entry.next != nullptr) {
+        entry.next->previous = entry.previous;
+    }
+    else {
+        m_tail = entry.previous;
+    }
+    entry.previous = nullptr;
+    entry.next     = nullptr;
+}
+
+void
+Pair_cache::push_front(Entry& entry)
+{
+    entry.next = m_head;
+    if (m_head != nullptr) {
+        m_head->previous = &entry;
+    }
+    else {
+        m_tail = &entry;
+    }
+    m_head = &entry;
+}
+
+}  // namespace Physics
+}  // namespace Dubious
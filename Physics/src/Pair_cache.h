@@ -0,0 +1,202 @@
+#ifndef INCLUDED_PHYSICS_PAIRCACHE
+#define INCLUDED_PHYSICS_PAIRCACHE
+
+#include "Contact_manifold.h"
+#include "Collision_solver.h"
+
+#include <cstdint>
+#include <deque>
+#include <tuple>
+#include <vector>
+
+namespace Dubious {
+namespace Physics {
+
+class Physics_object;
+
+/// @brief Persistent cache of colliding pairs
+///
+/// Holds a Contact_manifold for every pair of objects that are currently
+/// colliding. The collision strategies call begin_step, then touch every pair
+/// they find colliding, then end_step. Any pair that wasn't touched in that time
+/// is dropped.
+///
+/// The manifolds never move once they're made. They live in a slab, and the
+/// slots of dropped pairs go on a free list for the next new pairs. Finding a
+/// manifold goes through an open addressing hash table keyed on the two ids
+/// packed into 64 bits, and dropping a pair only clears its own slot. Every
+/// touch moves the pair to the front of a list, so at end_step the stale pairs
+/// are the ones left at the back and only those are visited. Iteration goes
+/// through a separate index of keys kept sorted by object id, so it's always in
+/// the same order. Only the pairs that began or ended are merged into it.
+///
+/// Only one thread at a time may use the cache during a step, the collision
+/// strategies gather their results per thread and then touch the pairs from
+/// one thread (see Collision_strategy::merge_buffers).
+///
+/// Along the way the cache records when pairs begin and end colliding, which is
+/// handy for game code that wants to know when things start or stop touching.
+class Pair_cache {
+public:
+    typedef std::tuple<int, int> Physics_object_ids;
+
+private:
+    struct Entry {
+        Entry(uint64_t k, Physics_object& a, Physics_object& b, float persistent_threshold,
+              float movement_threshold)
+            : key(k), manifold(a, b, persistent_threshold, movement_threshold)
+        {
+        }
+
+        uint64_t                     key;
+        unsigned int                 stamp    = 0;
+        Entry*                       previous = nullptr;
+        Entry*                       next     = nullptr;
+        Contact_manifold             manifold;
+        Collision_solver::Pair_state state;
+    };
+
+    struct Slot {
+        uint64_t key;
+        Entry*   entry;
+    };
+
+    struct Sorted_key {
+        uint64_t key;
+        Entry*   entry;
+    };
+
+public:
+    /// @brief Iterates over the manifolds in the cache, ordered by object id
+    template <typename Value>
+    class Iterator {
+    public:
+        Iterator(std::vector<Sorted_key>::const_iterator iter) : m_iter(iter) {}
+        Value&    operator*() const { return m_iter->entry->manifold; }
+        Value*    operator->() const { return &m_iter->entry->manifold; }
+        Iterator& operator++()
+        {
+            ++m_iter;
+            return *this;
+        }
+        bool operator!=(const Iterator& other) const { return m_iter != other.m_iter; }
+        bool operator==(const Iterator& other) const { return m_iter == other.m_iter; }
+
+        /// @brief ids of the pair of objects in this manifold
+        Physics_object_ids ids() const { return unpack(m_iter->key); }
+
+    private:
+        std::vector<Sorted_key>::const_iterator m_iter;
+    };
+    typedef Iterator<Contact_manifold>       iterator;
+    typedef Iterator<const Contact_manifold> const_iterator;
+
+    /// @brief Constructor
+    ///
+    /// @param manifold_persistent_threshold - [in] see Arena::Settings
+    /// @param manifold_movement_threshold - [in] see Arena::Settings
+    Pair_cache(float manifold_persistent_threshold, float manifold_movement_threshold);
+
+    Pair_cache(const Pair_cache&) = delete;
+    Pair_cache& operator=(const Pair_cache&) = delete;
+
+    /// @brief Start looking for collisions
+    ///
+    /// Every pair in the cache is now considered stale until it's touched
+    void begin_step();
+
+    /// @brief A pair of objects is colliding
+    ///
+    /// Finds the manifold for this pair, or creates a new one if they weren't
+    /// colliding before, and marks it as still colliding. Each pair should only
+    /// be touched once per step. The returned reference is good for as long as
+    /// the pair stays in the cache.
+    /// @param a - [in] first object, the one with the lower index in the Arena
+    /// @param b - [in] second object
+    /// @returns the manifold for this pair
+    Contact_manifold& touch(Physics_object& a, Physics_object& b);
+
+    /// @brief Done looking for collisions
+    ///
+    /// Every pair that wasn't touched since begin_step is removed.
+    void end_step();
+
+    /// @brief Pairs that started colliding since the last clear_events
+    const std::vector<Physics_object_ids>& began() const { return m_began; }
+
+    /// @brief Pairs that stopped colliding since the last clear_events
+    const std::vector<Physics_object_ids>& ended() const { return m_ended; }
+
+    /// @brief Forget the began and ended events
+    void clear_events();
+
+    /// @brief Find the manifold for a pair of objects
+    ///
+    /// Only valid outside of begin_step/end_step.
+    /// @param ids - [in] the object ids, lowest index first
+    /// @returns the manifold, or end() if they aren't colliding
+    iterator       find(const Physics_object_ids& ids);
+    const_iterator find(const Physics_object_ids& ids) const;
+
+    /// @brief Find the collision solver's state for a pair of objects
+    ///
+    /// Unlike find this also works during a step. Outside of a step any number
+    /// of threads can call this at once, as long as nothing is touching pairs.
+    /// @param ids - [in] the object ids, lowest index first
+    /// @returns the state, or nullptr if the pair isn't in the cache
+    Collision_solver::Pair_state*       state(const Physics_object_ids& ids);
+    const Collision_solver::Pair_state* state(const Physics_object_ids& ids) const;
+
+    iterator       begin() { return m_sorted.cbegin(); }
+    iterator       end() { return m_sorted.cend(); }
+    const_iterator begin() const { return m_sorted.cbegin(); }
+    const_iterator end() const { return m_sorted.cend(); }
+    size_t         size() const { return m_sorted.size(); }
+
+private:
+    // Object ids are never negative, so this can't be a real pair
+    static const uint64_t EMPTY = ~0ull;
+
+    const float  m_manifold_persistent_threshold;
+    const float  m_manifold_movement_threshold;
+    unsigned int m_stamp = 0;
+
+    // A deque so that adding entries never moves the ones already there
+    std::deque<Entry>   m_entries;
+    std::vector<Entry*> m_free;
+    std::vector<Slot>   m_table;
+    size_t              m_slots_used = 0;
+
+    // Most recently touched first
+    Entry* m_head = nullptr;
+    Entry* m_tail = nullptr;
+
+    // m_sorted is every pair in key order. The pairs that began or ended this
+    // step are collected on the side and merged in at end_step, using
+    // m_merged as scratch space.
+    std::vector<Sorted_key> m_sorted;
+    std::vector<Sorted_key> m_merged;
+    std::vector<Sorted_key> m_new_keys;
+    std::vector<uint64_t>   m_stale_keys;
+
+    std::vector<Physics_object_ids> m_began;
+    std::vector<Physics_object_ids> m_ended;
+
+    static uint64_t           pack(int a, int b);
+    static Physics_object_ids unpack(uint64_t key);
+    static size_t             hash(uint64_t key);
+
+    Entry* lookup(uint64_t key) const;
+    void   insert_slot(std::vector<Slot>& table, uint64_t key, Entry* entry);
+    void   erase_slot(uint64_t key);
+    void   unlink(Entry& entry);
+    void   push_front(Entry& entry);
+    void   merge_keys();
+
+    std::vector<Sorted_key>::const_iterator find_sorted(uint64_t key) const;
+};
+
+}  // namespace Physics
+}  // namespace Dubious
+
+#endif
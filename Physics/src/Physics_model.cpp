@@ -1,35 +1,344 @@
 #include "Physics_model.h"
+#include "Convex_hull.h"
 
 #include <Ac3d_file_reader.h>
 #include <Vector_math.h>
 
 #include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DUBIOUS_PHYSICS_SSE
+#include <emmintrin.h>
+#endif
 
 namespace Dubious {
 namespace Physics {
 
-Physics_model::Physics_model(const Utility::Ac3d_file& file)
+namespace {
+// Below this many vertices it's quicker to just check them all than to walk
+// the hull
+const size_t HILL_CLIMB_VERTICES = 32;
+
+// Sphere around the middle of the points' bounding box, grown by margin
+Physics_model::Bounds
+bounding_sphere(const std::vector<Math::Local_vector>& points, float margin)
+{
+    Physics_model::Bounds bounds;
+    if (points.empty()) {
+        return bounds;
+    }
+    Math::Local_vector low  = points.front();
+    Math::Local_vector high = points.front();
+    for (const auto& p : points) {
+        low  = Math::Local_vector(std::min(low.x(), p.x()), std::min(low.y(), p.y()),
+                                 std::min(low.z(), p.z()));
+        high = Math::Local_vector(std::max(high.x(), p.x()), std::max(high.y(), p.y()),
+                                  std::max(high.z(), p.z()));
+    }
+    bounds.center = (low + high) / 2.0f;
+    bounds.radius = 0;
+    for (const auto& p : points) {
+        bounds.radius = std::max(bounds.radius, (p - bounds.center).length_squared());
+    }
+    bounds.radius = std::sqrt(bounds.radius) + margin;
+    return bounds;
+}
+
+// Merge the hull's triangles into polygons, one for each plane. The hull is
+// convex, so all of the triangles in a plane are next to each other and the
+// edges that only one of them has go once around the outside.
+void
+merge_faces(const Convex_hull& hull, float scale, std::vector<Physics_model::Face>& faces,
+            std::vector<int>& face_vertices)
+{
+    const std::vector<Math::Local_vector>& points = hull.vertices();
+    std::vector<Physics_model::Face>       planes;
+    for (const auto& triangle : hull.faces()) {
+        const Math::Local_vector n = Math::cross_product(points[triangle[1]] - points[triangle[0]],
+                                                         points[triangle[2]] - points[triangle[0]]);
+        Physics_model::Face      plane;
+        plane.normal = n / n.length();
+        plane.offset = Math::dot_product(plane.normal, points[triangle[0]]);
+        planes.push_back(plane);
+    }
+
+    std::vector<bool>                merged(planes.size(), false);
+    std::vector<std::pair<int, int>> edges;
+    for (size_t i = 0; i < planes.size(); ++i) {
+        if (merged[i]) {
+            continue;
+        }
+        edges.clear();
+        for (size_t j = i; j < planes.size(); ++j) {
+            if (merged[j] ||
+                Math::dot_product(planes[i].normal, planes[j].normal) < 0.9999f ||
+                std::abs(planes[i].offset - planes[j].offset) > 0.0001f * scale) {
+                continue;
+            }
+            merged[j]                         = true;
+            const std::array<int, 3>& corners = hull.faces()[j];
+            for (int k = 0; k < 3; ++k) {
+                edges.push_back(std::make_pair(corners[k], corners[(k + 1) % 3]));
+            }
+        }
+        // Shared edges are inside the polygon
+        std::vector<std::pair<int, int>> outside;
+        for (const auto& edge : edges) {
+            const auto reverse = std::make_pair(edge.second, edge.first);
+            if (std::find(edges.begin(), edges.end(), reverse) == edges.end()) {
+                outside.push_back(edge);
+            }
+        }
+        Physics_model::Face face = planes[i];
+        face.first               = static_cast<int>(face_vertices.size());
+        int vertex               = outside.front().first;
+        for (size_t k = 0; k < outside.size(); ++k) {
+            face_vertices.push_back(vertex);
+            auto next = std::find_if(outside.begin(), outside.end(),
+                                     [vertex](const std::pair<int, int>& edge) {
+                                         return edge.first == vertex;
+                                     });
+            if (next == outside.end() || next->second == outside.front().first) {
+                break;
+            }
+            vertex = next->second;
+        }
+        face.count = static_cast<int>(face_vertices.size()) - face.first;
+        faces.push_back(face);
+    }
+}
+
+// The SoA copies of the vertices are padded to a multiple of this, which is
+// enough for AVX. SSE just takes two goes at each block.
+const size_t SIMD_WIDTH = 8;
+
+#if defined(DUBIOUS_PHYSICS_SSE)
+// SSE2 doesn't have blendv, where mask is set take a, otherwise b
+inline __m128
+select(__m128 mask, __m128 a, __m128 b)
+{
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+#endif
+
+// Index of the first vertex with the biggest dot product. The dot products
+// are worked out in the same order as Math::dot_product so this gives exactly
+// the same answer as checking each vertex in turn, whichever path is compiled.
+int
+max_dot_index(const float* xs, const float* ys, const float* zs, size_t count,
+              const Math::Local_vector& direction)
+{
+    float best       = std::numeric_limits<float>::lowest();
+    int   best_index = 0;
+#if defined(__AVX__)
+    const __m256 dx           = _mm256_set1_ps(direction.x());
+    const __m256 dy           = _mm256_set1_ps(direction.y());
+    const __m256 dz           = _mm256_set1_ps(direction.z());
+    const __m256 step         = _mm256_set1_ps(8.0f);
+    __m256       index        = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256       lane_best    = _mm256_set1_ps(best);
+    __m256       lane_indices = _mm256_setzero_ps();
+    for (size_t i = 0; i < count; i += 8) {
+        const __m256 dot =
+            _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(xs + i), dx),
+                                        _mm256_mul_ps(_mm256_loadu_ps(ys + i), dy)),
+                          _mm256_mul_ps(_mm256_loadu_ps(zs + i), dz));
+        const __m256 greater = _mm256_cmp_ps(dot, lane_best, _CMP_GT_OQ);
+        lane_best            = _mm256_blendv_ps(lane_best, dot, greater);
+        lane_indices         = _mm256_blendv_ps(lane_indices, index, greater);
+        index                = _mm256_add_ps(index, step);
+    }
+    const int lanes = 8;
+    float     dots[8];
+    float     indices[8];
+    _mm256_storeu_ps(dots, lane_best);
+    _mm256_storeu_ps(indices, lane_indices);
+#elif defined(DUBIOUS_PHYSICS_SSE)
+    const __m128 dx           = _mm_set1_ps(direction.x());
+    const __m128 dy           = _mm_set1_ps(direction.y());
+    const __m128 dz           = _mm_set1_ps(direction.z());
+    const __m128 step         = _mm_set1_ps(4.0f);
+    __m128       index        = _mm_setr_ps(0, 1, 2, 3);
+    __m128       lane_best    = _mm_set1_ps(best);
+    __m128       lane_indices = _mm_setzero_ps();
+    for (size_t i = 0; i < count; i += 4) {
+        const __m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(xs + i), dx),
+                                                 _mm_mul_ps(_mm_loadu_ps(ys + i), dy)),
+                                      _mm_mul_ps(_mm_loadu_ps(zs + i), dz));
+        const __m128 greater = _mm_cmpgt_ps(dot, lane_best);
+        lane_best            = select(greater, dot, lane_best);
+        lane_indices         = select(greater, index, lane_indices);
+        index                = _mm_add_ps(index, step);
+    }
+    const int lanes = 4;
+    float     dots[4];
+    float     indices[4];
+    _mm_storeu_ps(dots, lane_best);
+    _mm_storeu_ps(indices, lane_indices);
+#else
+    const int lanes = 1;
+    float     dots[1];
+    float     indices[1];
+    dots[0]    = best;
+    indices[0] = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const float dot = xs[i] * direction.x() + ys[i] * direction.y() + zs[i] * direction.z();
+        if (dot > dots[0]) {
+            dots[0]    = dot;
+            indices[0] = static_cast<float>(i);
+        }
+    }
+#endif
+    // Each lane found the first best of its own vertices, so on a tie the
+    // lowest index is the one that came first
+    for (int lane = 0; lane < lanes; ++lane) {
+        const int lane_index = static_cast<int>(indices[lane]);
+        if (dots[lane] > best || (dots[lane] == best && lane_index < best_index)) {
+            best       = dots[lane];
+            best_index = lane_index;
+        }
+    }
+    return best_index;
+}
+}  // namespace
+
+Physics_model::Physics_model(const Utility::Ac3d_file& file, size_t max_hull_vertices)
+{
+    construct(Math::Local_vector(), *file.model(), max_hull_vertices);
+}
+
+Physics_model::Physics_model(const Math::Local_vector& half_extents)
+    : m_shape(Shape::BOX)
+    , m_half_extents(half_extents)
+    , m_radius(half_extents.length())
 {
-    construct(Math::Local_vector(), *file.model());
+    const float w = half_extents.x();
+    const float h = half_extents.y();
+    const float d = half_extents.z();
+    build_hull({Math::Local_vector(-w, -h, -d), Math::Local_vector(w, -h, -d),
+                Math::Local_vector(w, -h, d), Math::Local_vector(-w, -h, d),
+                Math::Local_vector(-w, h, d), Math::Local_vector(w, h, d),
+                Math::Local_vector(w, h, -d), Math::Local_vector(-w, h, -d)},
+               0);
+}
+
+Physics_model::Physics_model(float radius, float half_length)
+    : m_shape(half_length > 0 ? Shape::CAPSULE : Shape::SPHERE)
+    , m_margin(radius)
+    , m_radius(radius + half_length)
+{
+    if (m_shape == Shape::SPHERE) {
+        build_hull({Math::Local_vector()}, 0);
+    }
+    else {
+        build_hull({Math::Local_vector(0, -half_length, 0), Math::Local_vector(0, half_length, 0)},
+                   0);
+    }
 }
 
 void
-Physics_model::construct(const Math::Local_vector& offset, const Utility::Ac3d_model& model)
+Physics_model::construct(const Math::Local_vector& offset, const Utility::Ac3d_model& model,
+                         size_t max_hull_vertices)
 {
-    Math::Local_vector new_offset = offset + (Math::to_vector(model.offset()));
+    Math::Local_vector              new_offset = offset + (Math::to_vector(model.offset()));
+    std::vector<Math::Local_vector> points;
     for (const auto& p : model.points()) {
         Math::Local_vector v = Math::to_vector(p);
         m_radius             = std::max(m_radius, v.length_squared());
-        m_vectors.push_back(new_offset + v);
+        points.push_back(new_offset + v);
     }
     m_radius = std::sqrt(m_radius);
+    build_hull(points, max_hull_vertices);
 
     for (const auto& kid : model.kids()) {
         m_kids.push_back(std::unique_ptr<Physics_model>(new Physics_model));
-        m_kids.back()->construct(new_offset, *kid);
+        m_kids.back()->construct(new_offset, *kid, max_hull_vertices);
         m_radius =
             std::max(m_radius, Math::to_vector(kid->offset()).length() + m_kids.back()->radius());
     }
+    if (!m_kids.empty()) {
+        std::vector<Math::Local_vector> all_points;
+        tree_points(all_points);
+        m_tree_bounds = bounding_sphere(all_points, 0);
+    }
+}
+
+void
+Physics_model::tree_points(std::vector<Math::Local_vector>& points) const
+{
+    points.insert(points.end(), m_vectors.begin(), m_vectors.end());
+    for (const auto& kid : m_kids) {
+        kid->tree_points(points);
+    }
+}
+
+void
+Physics_model::build_hull(const std::vector<Math::Local_vector>& points, size_t max_hull_vertices)
+{
+    // Anything inside the hull can never be a support point, so don't make
+    // the collision solver look at it
+    Convex_hull hull(points, max_hull_vertices);
+    m_vectors     = hull.vertices();
+    m_bounds      = bounding_sphere(m_vectors, m_margin);
+    m_tree_bounds = m_bounds;
+
+    // The padding is copies of the first vertex. They can tie with it but
+    // never beat it, and ties go to the lower index.
+    const size_t padded = (m_vectors.size() + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH;
+    m_xs.reserve(padded);
+    m_ys.reserve(padded);
+    m_zs.reserve(padded);
+    for (size_t i = 0; i < padded; ++i) {
+        const Math::Local_vector& v = m_vectors[i < m_vectors.size() ? i : 0];
+        m_xs.push_back(v.x());
+        m_ys.push_back(v.y());
+        m_zs.push_back(v.z());
+    }
+    merge_faces(hull, m_bounds.radius, m_faces, m_face_vertices);
+    if (m_vectors.size() > HILL_CLIMB_VERTICES && !hull.faces().empty()) {
+        // Every edge is in two faces, once in each direction, so each face
+        // only needs to add one side of each of its edges
+        m_adjacency.resize(m_vectors.size());
+        for (const auto& face : hull.faces()) {
+            for (int i = 0; i < 3; ++i) {
+                m_adjacency[face[i]].push_back(face[(i + 1) % 3]);
+            }
+        }
+    }
+}
+
+const Math::Local_vector&
+Physics_model::support(const Math::Local_vector& direction, int& hint) const
+{
+    if (hint < 0 || hint >= static_cast<int>(m_vectors.size())) {
+        hint = 0;
+    }
+    if (m_adjacency.empty()) {
+        hint = max_dot_index(m_xs.data(), m_ys.data(), m_zs.data(), m_xs.size(), direction);
+        return m_vectors[hint];
+    }
+
+    float max_dot = Math::dot_product(m_vectors[hint], direction);
+    for (;;) {
+        int best = hint;
+        for (int neighbor : m_adjacency[hint]) {
+            float dot = Math::dot_product(m_vectors[neighbor], direction);
+            if (dot > max_dot) {
+                max_dot = dot;
+                best    = neighbor;
+            }
+        }
+        if (best == hint) {
+            return m_vectors[hint];
+        }
+        hint = best;
+    }
 }
 
 }  // namespace Physics
@@ -27,22 +27,121 @@ public:
 
     /// @brief Construct from AC3D Model
     ///
-    /// Constructs a model from an AC3D File.
+    /// Constructs a model from an AC3D File. Only the convex hull of each
+    /// model's points is kept, see Convex_hull.
     /// @param File - [in] The file object
-    Physics_model(const Utility::Ac3d_file& File);
+    /// @param max_hull_vertices - [in] if not 0, simplify each hull down to
+    ///         at most this many vertices. This makes collisions cheaper for
+    ///         detailed models at the cost of the shape being slightly smaller
+    Physics_model(const Utility::Ac3d_file& File, size_t max_hull_vertices = 0);
+
+    /// @brief Construct a box
+    ///
+    /// Has the same corners as Ac3d_file_reader::test_cube, but the model
+    /// knows that it's a box, so the Collision_solver can use a box specific
+    /// test when two of them meet.
+    /// @param half_extents - [in] half of the width, height and depth
+    explicit Physics_model(const Math::Local_vector& half_extents);
+
+    /// @brief Construct a sphere or a capsule
+    ///
+    /// A capsule is everything within radius of a line segment that runs
+    /// along the y axis. A sphere is the same with no segment. vectors() is
+    /// just the segment (or the center), margin() is the radius.
+    /// @param radius - [in] the radius
+    /// @param half_length - [in] half the length of the segment, 0 for a sphere
+    explicit Physics_model(float radius, float half_length = 0);
 
     Physics_model& operator=(const Physics_model&) = delete;
 
+    /// @brief What kind of shape a model is
+    ///
+    /// HULL is the general case, a hull of points (and maybe kids) that
+    /// only GJK can collide. The others have faster ways of being collided.
+    /// A BOX still fills in vectors() so GJK can be used as a fallback.
+    /// SPHERE and CAPSULE are rounded, their vectors() are the core that
+    /// the surface is margin() away from.
+    enum class Shape { HULL, BOX, SPHERE, CAPSULE };
+
+    /// How many kinds of Shape there are
+    static const int SHAPES = 4;
+
+    Shape                     shape() const { return m_shape; }
+    const Math::Local_vector& half_extents() const { return m_half_extents; }
+    float                     margin() const { return m_margin; }
+
+    /// @brief A bounding sphere, in the same space as vectors()
+    struct Bounds {
+        Math::Local_vector center;
+        float              radius = -1;  // less than 0 if there's nothing inside
+    };
+
+    /// @brief Bounds around this model's own vectors(), not its kids
+    const Bounds& bounds() const { return m_bounds; }
+
+    /// @brief Bounds around this model and all of its kids
+    ///
+    /// Together with bounds() this makes the kids into a tree of spheres,
+    /// so the collision solver can skip any part of a model that's too far
+    /// away from the other model to touch it.
+    const Bounds& tree_bounds() const { return m_tree_bounds; }
+
+    /// @brief A face of the hull of vectors()
+    ///
+    /// Hull triangles that lie in the same plane are merged, so a box has
+    /// 6 faces of 4 vertices each. The collision solver clips faces against
+    /// each other to find a whole manifold at once.
+    struct Face {
+        Math::Local_vector normal;  // unit length, pointing out of the hull
+        float              offset;  // dot_product(normal, p) for any p on the face
+        int                first;   // the face's vertices start here in face_vertices()
+        int                count;
+    };
+
+    /// @brief The faces, empty if the model is flat or rounded
+    const std::vector<Face>& faces() const { return m_faces; }
+
+    /// @brief Indices into vectors(), counter clockwise seen from outside
+    const std::vector<int>& face_vertices() const { return m_face_vertices; }
+
     float                                              radius() const { return m_radius; }
     const std::vector<Math::Local_vector>&             vectors() const { return m_vectors; }
     const std::vector<std::unique_ptr<Physics_model>>& kids() const { return m_kids; }
 
+    /// @brief Find the vertex furthest in a direction
+    ///
+    /// Small models just check every vertex, several at a time with SSE or AVX
+    /// if they're available. Bigger ones walk the hull from the hint, always
+    /// moving to the neighbor that's furthest in the direction, until no
+    /// neighbor is any better. Since the hull is convex that's the answer. If
+    /// the hint is the answer from a similar direction this only takes a step
+    /// or two.
+    /// @param direction - [in] the direction to search
+    /// @param hint - [in,out] the vertex index to start from, set to the index
+    ///         of the vertex found
+    /// @returns the furthest vertex
+    const Math::Local_vector& support(const Math::Local_vector& direction, int& hint) const;
+
 private:
     Physics_model() = default;
-    void construct(const Math::Local_vector& offset, const Utility::Ac3d_model& AC3DModel);
+    void construct(const Math::Local_vector& offset, const Utility::Ac3d_model& AC3DModel,
+                   size_t max_hull_vertices);
+    void build_hull(const std::vector<Math::Local_vector>& points, size_t max_hull_vertices);
+    void tree_points(std::vector<Math::Local_vector>& points) const;
 
+    Shape                                       m_shape = Shape::HULL;
+    Math::Local_vector                          m_half_extents;  // only for BOX
+    float                                       m_margin = 0;    // only for SPHERE and CAPSULE
     float                                       m_radius = 0;
+    Bounds                                      m_bounds;
+    Bounds                                      m_tree_bounds;
     std::vector<Math::Local_vector>             m_vectors;
+    std::vector<float>                          m_xs;  // m_vectors again as SoA, padded for SIMD
+    std::vector<float>                          m_ys;
+    std::vector<float>                          m_zs;
+    std::vector<std::vector<int>>               m_adjacency;  // hull neighbors of each vertex
+    std::vector<Face>                           m_faces;
+    std::vector<int>                            m_face_vertices;
     std::vector<std::unique_ptr<Physics_model>> m_kids;
 };
 
@@ -25,6 +25,27 @@ Physics_object::Physics_object(const std::shared_ptr<Physics_model>& model, floa
     }
 }
 
+void
+Physics_object::sleep()
+{
+    m_asleep           = true;
+    m_velocity         = Math::Vector();
+    m_angular_velocity = Math::Vector();
+}
+
+void
+Physics_object::wake()
+{
+    m_asleep        = false;
+    m_resting_steps = 0;
+}
+
+bool
+asleep(const Physics_object& a, const Physics_object& b)
+{
+    return (a.asleep() || b.asleep()) && a.at_rest() && b.at_rest();
+}
+
 namespace {
 void
 copy_model_to_vectors(const Physics_model& model, Math::Coordinate_space coords,
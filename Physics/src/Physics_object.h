@@ -65,6 +65,22 @@ public:
     const Math::Vector& torque() const { return m_torque; }
     Math::Vector&       torque() { return m_torque; }
 
+    /// @brief Sleeping
+    ///
+    /// When sleeping is turned on in the Arena settings, objects that have come to rest are put
+    /// to sleep. A sleeping object isn't moved, and isn't collided or solved against other objects
+    /// that can't move, until something awake touches it. If you move or push a sleeping object
+    /// yourself then wake it up first.
+    bool asleep() const { return m_asleep; }
+    void sleep();
+    void wake();
+
+    /// @brief True if the object won't move this step, it's either asleep or stationary
+    bool at_rest() const { return m_asleep || m_inverse_mass == 0; }
+
+    /// @brief How many steps in a row the object has been slow enough to sleep
+    int& resting_steps() { return m_resting_steps; }
+
 private:
     std::shared_ptr<Physics_model> m_model;
     Math::Coordinate_space         m_coordinate_space;
@@ -79,8 +95,17 @@ private:
     float        m_inverse_moment_of_inertia;
     Math::Vector m_angular_velocity;
     Math::Vector m_torque;
+
+    bool m_asleep        = false;
+    int  m_resting_steps = 0;
 };
 
+/// @brief True if a pair of objects has gone to sleep
+///
+/// At least one of them is asleep and neither one will move this step, so
+/// whatever contact they had when they went to sleep still holds.
+bool asleep(const Physics_object& a, const Physics_object& b);
+
 }  // namespace Physics
 }  // namespace Dubious
 
@@ -0,0 +1,69 @@
+#include "Worker_pool.h"
+
+namespace Dubious {
+namespace Physics {
+
+Worker_pool::Worker_pool(unsigned int workers)
+{
+    for (unsigned int i = 1; i < workers; ++i) {
+        m_threads.push_back(std::thread(&Worker_pool::thread_func, this, i));
+    }
+}
+
+Worker_pool::~Worker_pool()
+{
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_start.notify_all();
+    for (auto& thread : m_threads) {
+        thread.join();
+    }
+}
+
+void
+Worker_pool::run(Function function, void* job)
+{
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_function = function;
+        m_job      = job;
+        m_running  = static_cast<unsigned int>(m_threads.size());
+        ++m_generation;
+    }
+    m_start.notify_all();
+    function(job, 0);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this]() { return m_running == 0; });
+}
+
+void
+Worker_pool::thread_func(unsigned int worker)
+{
+    unsigned int generation = 0;
+    for (;;) {
+        Function function;
+        void*    job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_start.wait(lock, [&]() { return m_stop || m_generation != generation; });
+            if (m_stop) {
+                return;
+            }
+            generation = m_generation;
+            function   = m_function;
+            job        = m_job;
+        }
+        function(job, worker);
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            --m_running;
+        }
+        m_done.notify_one();
+    }
+}
+
+}  // namespace Physics
+}  // namespace Dubious
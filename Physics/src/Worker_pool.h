@@ -0,0 +1,76 @@
+#ifndef INCLUDED_PHYSICS_WORKERPOOL
+#define INCLUDED_PHYSICS_WORKERPOOL
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Dubious {
+namespace Physics {
+
+/// @brief A fixed set of threads that all work on the same job
+///
+/// The threads are started once, by the constructor, and wait between jobs.
+/// So running a job doesn't start any threads or allocate any memory, which
+/// std::async does every time. The thread that calls run is worker 0 and does
+/// its share of the job too, so a pool of 1 worker has no threads at all.
+///
+/// Splitting the job up is left to the job. It gets the worker number and can
+/// use that to pick its share, or have the workers take pieces of work off an
+/// atomic counter.
+class Worker_pool {
+public:
+    /// @brief Constructor
+    /// @param workers - [in] how many workers, including the one that calls run
+    explicit Worker_pool(unsigned int workers);
+
+    /// @brief Destructor, waits for the threads to finish
+    ~Worker_pool();
+
+    Worker_pool(const Worker_pool&) = delete;
+    Worker_pool& operator=(const Worker_pool&) = delete;
+
+    /// @brief How many workers there are, including the one that calls run
+    unsigned int size() const { return static_cast<unsigned int>(m_threads.size()) + 1; }
+
+    /// @brief Call job(worker) once on each worker and wait for them all to return
+    ///
+    /// Only one thread at a time should call run.
+    /// @param job - [in] anything that can be called with an unsigned int
+    template <typename Job>
+    void run(Job& job)
+    {
+        run(&call<Job>, &job);
+    }
+
+private:
+    typedef void (*Function)(void* job, unsigned int worker);
+
+    template <typename Job>
+    static void call(void* job, unsigned int worker)
+    {
+        (*static_cast<Job*>(job))(worker);
+    }
+
+    void run(Function function, void* job);
+    void thread_func(unsigned int worker);
+
+    std::vector<std::thread> m_threads;
+    std::mutex               m_mutex;
+    std::condition_variable  m_start;
+    std::condition_variable  m_done;
+
+    // All protected by m_mutex. Each job bumps m_generation, which is how the
+    // threads know there's something new to do.
+    Function     m_function   = nullptr;
+    void*        m_job        = nullptr;
+    unsigned int m_generation = 0;
+    unsigned int m_running    = 0;
+    bool         m_stop       = false;
+};
+
+}  // namespace Physics
+}  // namespace Dubious
+
+#endif
@@ -0,0 +1,65 @@
+#include "Allocation_counter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+std::atomic<size_t> g_allocations(0);
+
+void*
+counted_alloc(size_t size)
+{
+    ++g_allocations;
+    if (void* memory = std::malloc(size == 0 ? 1 : size)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+}
+
+void*
+operator new(size_t size)
+{
+    return counted_alloc(size);
+}
+
+void*
+operator new[](size_t size)
+{
+    return counted_alloc(size);
+}
+
+void
+operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void
+operator delete[](void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void
+operator delete(void* memory, size_t) noexcept
+{
+    std::free(memory);
+}
+
+void
+operator delete[](void* memory, size_t) noexcept
+{
+    std::free(memory);
+}
+
+namespace Physics_test {
+
+size_t
+allocation_count()
+{
+    return g_allocations;
+}
+
+}
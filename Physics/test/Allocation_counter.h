@@ -0,0 +1,17 @@
+#ifndef INCLUDED_PHYSICS_TEST_ALLOCATIONCOUNTER
+#define INCLUDED_PHYSICS_TEST_ALLOCATIONCOUNTER
+
+#include <cstddef>
+
+namespace Physics_test {
+
+/// @brief Number of times global operator new has been called
+///
+/// The test project replaces the global operator new and delete, and
+/// counts every allocation made by any thread. Take the count before
+/// and after a piece of code to see how many times it allocated.
+size_t allocation_count();
+
+}
+
+#endif
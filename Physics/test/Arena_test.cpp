@@ -6,6 +6,9 @@
 #include <Coordinate_space.h>
 #include <Ac3d_file_reader.h>
 
+#include <cmath>
+#include <vector>
+
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 using namespace Dubious::Physics;
 using namespace Dubious::Math;
@@ -76,5 +79,100 @@ public:
 
         arena.run_physics(constraint.step_size + 0.000001f);
     }
+
+    TEST_METHOD(arena_solver_threads)
+    {
+        // The batches don't depend on how many threads there are, so neither
+        // do the results. And the stacks should still be standing.
+        std::vector<Point> two   = stacks(2);
+        std::vector<Point> three = stacks(3);
+        Assert::IsTrue(two.size() == three.size());
+        for (size_t i = 0; i < two.size(); ++i) {
+            Assert::IsTrue(two[i] == three[i]);
+            Assert::IsTrue(std::abs(two[i].y() - (i % 3 + 0.5f)) < 0.1f);
+        }
+    }
+
+    TEST_METHOD(arena_sleeping)
+    {
+        auto model_file = Ac3d_file_reader::test_cube(0.5f, 0.5f, 0.5f);
+        auto model      = std::make_shared<Physics_model>(*model_file);
+        auto floor      = std::make_shared<Physics_object>(model, Physics_object::STATIONARY);
+        auto a          = std::make_shared<Physics_object>(model, 1.0f);
+        auto b          = std::make_shared<Physics_object>(model, 1.0f);
+
+        floor->coordinate_space().translate(Vector(0, -0.5f, 0));
+        a->coordinate_space().translate(Vector(0, 0.5f, 0));
+        b->coordinate_space().translate(Vector(0, 3.0f, 0));
+        a->force() = Vector(0, -10.0f, 0);
+        b->force() = Vector(0, -10.0f, 0);
+
+        Arena::Collision_solver_settings  collision;
+        Arena::Constraint_solver_settings constraint;
+        constraint.allow_sleeping = true;
+        Arena arena((Arena::Settings(collision, constraint)));
+        arena.push_back(floor);
+        arena.push_back(a);
+
+        // Resting on the floor it soon goes to sleep, and stays put
+        for (int i = 0; i < constraint.sleep_steps + 10; ++i) {
+            arena.run_physics(constraint.step_size);
+        }
+        Assert::IsTrue(a->asleep());
+        const Point resting = a->coordinate_space().position();
+        arena.run_physics(constraint.step_size * 10);
+        Assert::IsTrue(a->coordinate_space().position() == resting);
+
+        // Until something lands on it
+        arena.push_back(b);
+        bool woke = false;
+        for (int i = 0; i < 60 && !woke; ++i) {
+            arena.run_physics(constraint.step_size);
+            woke = !a->asleep();
+        }
+        Assert::IsTrue(woke);
+        for (int i = 0; i < 120; ++i) {
+            arena.run_physics(constraint.step_size);
+        }
+        Assert::IsTrue(a->asleep() && b->asleep());
+        Assert::IsTrue(std::abs(b->coordinate_space().position().y() - 1.5f) < 0.1f);
+    }
+
+private:
+    // A 3 by 3 grid of stacks of cubes 3 high, run for a second. Returns
+    // where the cubes end up.
+    std::vector<Point> stacks(unsigned int solver_threads)
+    {
+        auto floor_file  = Ac3d_file_reader::test_cube(5.0f, 0.5f, 5.0f);
+        auto floor_model = std::make_shared<Physics_model>(*floor_file);
+        auto cube_file   = Ac3d_file_reader::test_cube(0.5f, 0.5f, 0.5f);
+        auto cube_model  = std::make_shared<Physics_model>(*cube_file);
+
+        Arena::Collision_solver_settings  collision;
+        Arena::Constraint_solver_settings constraint;
+        constraint.solver_threads = solver_threads;
+        Arena arena((Arena::Settings(collision, constraint)));
+
+        auto floor = std::make_shared<Physics_object>(floor_model, Physics_object::STATIONARY);
+        floor->coordinate_space().translate(Vector(0, -0.5f, 0));
+        arena.push_back(floor);
+        std::vector<std::shared_ptr<Physics_object>> cubes;
+        for (int i = 0; i < 27; ++i) {
+            cubes.push_back(std::make_shared<Physics_object>(cube_model, 1.0f));
+            cubes.back()->coordinate_space().translate(
+                Vector((i / 9) * 1.5f - 1.5f, i % 3 + 0.5f, (i / 3 % 3) * 1.5f - 1.5f));
+            cubes.back()->force() = Vector(0, -10.0f, 0);
+            arena.push_back(cubes.back());
+        }
+        for (int i = 0; i < 60; ++i) {
+            arena.run_physics(constraint.step_size);
+        }
+
+        std::vector<Point> positions;
+        for (const auto& cube : cubes) {
+            positions.push_back(cube->coordinate_space().position());
+        }
+        return positions;
+    }
 };
 }  // namespace Physics_test
@@ -99,5 +99,344 @@ public:
         b.coordinate_space() = Coordinate_space(Point(3, 0, 0), Unit_quaternion(1, Vector()));
         Assert::IsTrue(solver.intersection(a, b, contacts) == true);
     }
+
+    TEST_METHOD(collision_solver_warm_start)
+    {
+        Collision_solver                 solver(true);
+        Collision_solver::Pair_state     state;
+        std::unique_ptr<const Ac3d_file> model_file = Ac3d_file_reader::test_cube(1.0f, 1.0f, 1.0f);
+
+        std::shared_ptr<Physics_model> model = std::make_shared<Physics_model>(*model_file);
+        Physics_object                 a(model, 1);
+        Physics_object                 b(model, 1);
+        b.coordinate_space().translate(Vector(1.9f, 0.2f, 0.1f));
+
+        std::vector<Contact_manifold::Contact> contacts;
+        Assert::IsTrue(solver.intersection(a, b, contacts, state) == true);
+        Assert::IsTrue(state.simplex[0].size == 4);
+
+        // Move a little, the saved simplex should still do the job and give
+        // the same answer as starting from scratch
+        b.coordinate_space().translate(Vector(0.01f, 0, -0.01f));
+        std::vector<Contact_manifold::Contact> warm;
+        std::vector<Contact_manifold::Contact> cold;
+        Assert::IsTrue(solver.intersection(a, b, warm, state) == true);
+        Assert::IsTrue(solver.intersection(a, b, cold) == true);
+        Assert::IsTrue(warm.size() == cold.size());
+        for (size_t i = 0; i < warm.size(); ++i) {
+            Assert::IsTrue(warm[i].normal == cold[i].normal);
+            Assert::IsTrue(fabs(warm[i].penetration_depth - cold[i].penetration_depth) < 0.001f);
+        }
+
+        // Once they separate there's nothing worth remembering
+        b.coordinate_space().translate(Vector(1, 0, 0));
+        contacts.clear();
+        Assert::IsTrue(solver.intersection(a, b, contacts, state) == false);
+        for (const auto& simplex : state.simplex) {
+            Assert::IsTrue(simplex.size == 0);
+        }
+    }
+
+    TEST_METHOD(collision_solver_box)
+    {
+        Collision_solver solver(false);
+        auto             floor = std::make_shared<Physics_model>(Local_vector(5, 0.5f, 5));
+        auto             cube  = std::make_shared<Physics_model>(Local_vector(1, 1, 1));
+        Assert::IsTrue(cube->shape() == Physics_model::Shape::BOX);
+        Physics_object a(floor, 1);
+        Physics_object b(cube, 1);
+
+        // Apart, then touching, neither is a collision
+        std::vector<Contact_manifold::Contact> contacts;
+        b.coordinate_space().translate(Vector(1, 2, 0));
+        Assert::IsTrue(solver.intersection(a, b, contacts) == false);
+        b.coordinate_space().translate(Vector(0, -0.5f, 0));
+        Assert::IsTrue(solver.intersection(a, b, contacts) == false);
+
+        // Sitting on the floor, all four corners touch at once
+        b.coordinate_space().translate(Vector(0, -0.1f, 0));
+        b.coordinate_space().rotate(Unit_quaternion(Vector(0, 1, 0), to_radians(30)));
+        Assert::IsTrue(solver.intersection(a, b, contacts) == true);
+        Assert::IsTrue(contacts.size() == 4);
+        for (const auto& c : contacts) {
+            Assert::IsTrue(c.normal == Unit_vector(0, 1, 0));
+            Assert::IsTrue(fabs(c.penetration_depth - 0.1f) < 0.0001f);
+            Assert::IsTrue(fabs(c.contact_point_a.y() - 0.5f) < 0.0001f);
+            Assert::IsTrue(fabs(c.contact_point_b.y() - 0.4f) < 0.0001f);
+            Assert::IsTrue(a.coordinate_space().transform(c.local_point_a) == c.contact_point_a);
+            Assert::IsTrue(b.coordinate_space().transform(c.local_point_b) == c.contact_point_b);
+        }
+
+        // Hanging off the edge, the corners past it get clipped to the edge
+        b.coordinate_space().position() = Point(5, 1.4f, 0);
+        contacts.clear();
+        Assert::IsTrue(solver.intersection(a, b, contacts) == true);
+        Assert::IsTrue(contacts.size() == 4);
+        for (const auto& c : contacts) {
+            Assert::IsTrue(c.contact_point_a.x() <= 5.0001f);
+        }
+
+        // Same thing with the floor as b, the normal has to flip
+        contacts.clear();
+        Assert::IsTrue(solver.intersection(b, a, contacts) == true);
+        Assert::IsTrue(contacts.size() == 4);
+        for (const auto& c : contacts) {
+            Assert::IsTrue(c.normal == Unit_vector(0, -1, 0));
+            Assert::IsTrue(fabs(c.contact_point_a.y() - 0.4f) < 0.0001f);
+            Assert::IsTrue(fabs(c.contact_point_b.y() - 0.5f) < 0.0001f);
+        }
+
+        // Two edges crossing. This should be the same contact that GJK finds
+        // for the same cubes as hulls.
+        std::unique_ptr<const Ac3d_file> model_file = Ac3d_file_reader::test_cube(1.0f, 1.0f, 1.0f);
+        std::shared_ptr<Physics_model>   hull       = std::make_shared<Physics_model>(*model_file);
+        Physics_object                   c(cube, 1);
+        Physics_object                   d(hull, 1);
+        Physics_object                   e(hull, 1);
+        b.coordinate_space() =
+            Coordinate_space(Point(0, 0, 0), Unit_quaternion(Vector(0, 0, 1), to_radians(45)));
+        c.coordinate_space() = Coordinate_space(Point(0.1f, 2.7f, 0.2f),
+                                                Unit_quaternion(Vector(1, 0, 0), to_radians(45)));
+        d.coordinate_space() = b.coordinate_space();
+        e.coordinate_space() = c.coordinate_space();
+        contacts.clear();
+        Assert::IsTrue(solver.intersection(b, c, contacts) == true);
+        Assert::IsTrue(contacts.size() == 1);
+        std::vector<Contact_manifold::Contact> gjk;
+        Assert::IsTrue(solver.intersection(d, e, gjk) == true);
+        Assert::IsTrue(contacts[0].normal == gjk[0].normal);
+        Assert::IsTrue(fabs(contacts[0].penetration_depth - gjk[0].penetration_depth) < 0.001f);
+        Assert::IsTrue((contacts[0].contact_point_a - gjk[0].contact_point_a).length() < 0.001f);
+        Assert::IsTrue((contacts[0].contact_point_b - gjk[0].contact_point_b).length() < 0.001f);
+    }
+
+    TEST_METHOD(collision_solver_clipped_manifold)
+    {
+        // Hulls with faces, the greedy solver clips the touching faces
+        // rather than running GJK from every direction
+        Collision_solver                 greedy(true);
+        Collision_solver                 single(false);
+        std::unique_ptr<const Ac3d_file> model_file = Ac3d_file_reader::test_cube(1.0f, 1.0f, 1.0f);
+        std::shared_ptr<Physics_model>   model      = std::make_shared<Physics_model>(*model_file);
+        Physics_object                   a(model, 1);
+        Physics_object                   b(model, 1);
+        b.coordinate_space() = Coordinate_space(Point(0.3f, 1.9f, 0.2f),
+                                                Unit_quaternion(Vector(0, 1, 0), to_radians(30)));
+
+        std::vector<Contact_manifold::Contact> contacts;
+        Assert::IsTrue(single.intersection(a, b, contacts) == true);
+        Assert::IsTrue(contacts.size() == 1);
+        contacts.clear();
+        Assert::IsTrue(greedy.intersection(a, b, contacts) == true);
+        Assert::IsTrue(contacts.size() == 4);
+        for (const auto& c : contacts) {
+            Assert::IsTrue(c.normal == Unit_vector(0, 1, 0));
+            Assert::IsTrue(fabs(c.penetration_depth - 0.1f) < 0.0001f);
+            Assert::IsTrue(fabs(c.contact_point_a.y() - 1.0f) < 0.0001f);
+            Assert::IsTrue(fabs(c.contact_point_b.y() - 0.9f) < 0.0001f);
+            Assert::IsTrue(a.coordinate_space().transform(c.local_point_a) == c.contact_point_a);
+            Assert::IsTrue(b.coordinate_space().transform(c.local_point_b) == c.contact_point_b);
+        }
+
+        // Two edges crossing, there's only the one point to find
+        a.coordinate_space() =
+            Coordinate_space(Point(0, 0, 0), Unit_quaternion(Vector(0, 0, 1), to_radians(45)));
+        b.coordinate_space() = Coordinate_space(Point(0.1f, 2.7f, 0.2f),
+                                                Unit_quaternion(Vector(1, 0, 0), to_radians(45)));
+        contacts.clear();
+        Assert::IsTrue(greedy.intersection(a, b, contacts) == true);
+        Assert::IsTrue(contacts.size() == 1);
+    }
+
+    TEST_METHOD(collision_solver_sphere_capsule)
+    {
+        Collision_solver solver(false);
+        auto             big     = std::make_shared<Physics_model>(1.0f);
+        auto             small   = std::make_shared<Physics_model>(0.5f);
+        auto             capsule = std::make_shared<Physics_model>(0.5f, 1.0f);
+        Assert::IsTrue(big->shape() == Physics_model::Shape::SPHERE);
+        Assert::IsTrue(capsule->shape() == Physics_model::Shape::CAPSULE);
+        Assert::IsTrue(capsule->radius() == 1.5f);
+
+        // Sphere against sphere
+        Physics_object                         a(big, 1);
+        Physics_object                         b(small, 1);
+        std::vector<Contact_manifold::Contact> contacts;
+        b.coordinate_space().position() = Point(1.6f, 0, 0);
+        Assert::IsTrue(solver.intersection(a, b, contacts) == false);
+        b.coordinate_space().position() = Point(1.4f, 0, 0);
+        Assert::IsTrue(solver.intersection(a, b, contacts) == true);
+        Assert::IsTrue(contacts.size() == 1);
+        Assert::IsTrue(contacts[0].normal == Unit_vector(1, 0, 0));
+        Assert::IsTrue(fabs(contacts[0].penetration_depth - 0.1f) < 0.0001f);
+        Assert::IsTrue(contacts[0].contact_point_a == Point(1, 0, 0));
+        Assert::IsTrue(contacts[0].contact_point_b == Point(0.9f, 0, 0));
+
+        // Sphere against the side of a capsule
+        Physics_object c(capsule, 1);
+        c.coordinate_space().position() = Point(1.3f, 0.5f, 0);
+        contacts.clear();
+        Assert::IsTrue(solver.intersection(a, c, contacts) == true);
+        Assert::IsTrue(contacts.size() == 1);
+        Assert::IsTrue(contacts[0].normal == Unit_vector(1, 0, 0));
+        Assert::IsTrue(fabs(contacts[0].penetration_depth - 0.2f) < 0.0001f);
+
+        // Capsules crossing, then lying side by side
+        Physics_object d(capsule, 1);
+        c.coordinate_space() =
+            Coordinate_space(Point(0, 0, 0.8f), Unit_quaternion(Vector(0, 0, 1), to_radians(90)));
+        contacts.clear();
+        Assert::IsTrue(solver.intersection(d, c, contacts) == true);
+        Assert::IsTrue(contacts.size() == 1);
+        Assert::IsTrue(contacts[0].normal == Unit_vector(0, 0, 1));
+        Assert::IsTrue(fabs(contacts[0].penetration_depth - 0.2f) < 0.0001f);
+        c.coordinate_space() = Coordinate_space(Point(0.8f, 0.5f, 0), Unit_quaternion());
+        contacts.clear();
+        Assert::IsTrue(solver.intersection(d, c, contacts) == true);
+        Assert::IsTrue(contacts.size() == 2);
+        for (const auto& contact : contacts) {
+            Assert::IsTrue(contact.normal == Unit_vector(1, 0, 0));
+            Assert::IsTrue(fabs(contact.penetration_depth - 0.2f) < 0.0001f);
+        }
+    }
+
+    TEST_METHOD(collision_solver_rounded_hull)
+    {
+        Collision_solver solver(false);
+        auto             floor   = std::make_shared<Physics_model>(Local_vector(5, 0.5f, 5));
+        auto             sphere  = std::make_shared<Physics_model>(0.5f);
+        auto             capsule = std::make_shared<Physics_model>(0.5f, 1.0f);
+        Physics_object   a(floor, 1);
+        Physics_object   b(sphere, 1);
+
+        // Sphere resting on a box, from both sides
+        std::vector<Contact_manifold::Contact> contacts;
+        b.coordinate_space().position() = Point(1, 1.1f, 0);
+        Assert::IsTrue(solver.intersection(a, b, contacts) == false);
+        b.coordinate_space().position() = Point(1, 0.9f, 0);
+        Assert::IsTrue(solver.intersection(a, b, contacts) == true);
+        Assert::IsTrue(contacts.size() == 1);
+        Assert::IsTrue(contacts[0].normal == Unit_vector(0, 1, 0));
+        Assert::IsTrue(fabs(contacts[0].penetration_depth - 0.1f) < 0.0001f);
+        Assert::IsTrue(contacts[0].contact_point_a == Point(1, 0.5f, 0));
+        Assert::IsTrue(contacts[0].contact_point_b == Point(1, 0.4f, 0));
+        contacts.clear();
+        Assert::IsTrue(solver.intersection(b, a, contacts) == true);
+        Assert::IsTrue(contacts.size() == 1);
+        Assert::IsTrue(contacts[0].normal == Unit_vector(0, -1, 0));
+        Assert::IsTrue(contacts[0].contact_point_a == Point(1, 0.4f, 0));
+        Assert::IsTrue(contacts[0].contact_point_b == Point(1, 0.5f, 0));
+        Assert::IsTrue(b.coordinate_space().transform(contacts[0].local_point_a) ==
+                       contacts[0].contact_point_a);
+
+        // Over the corner the normal points out from the corner
+        b.coordinate_space().position() = Point(5.3f, 0.8f, 0);
+        contacts.clear();
+        Assert::IsTrue(solver.intersection(a, b, contacts) == true);
+        Assert::IsTrue(contacts[0].normal == Unit_vector(1, 1, 0));
+
+        // The center has gone right through the surface
+        b.coordinate_space().position() = Point(1, 0.3f, 0);
+        contacts.clear();
+        Assert::IsTrue(solver.intersection(a, b, contacts) == true);
+        Assert::IsTrue(contacts.size() == 1);
+        Assert::IsTrue(contacts[0].normal == Unit_vector(0, 1, 0));
+        Assert::IsTrue(fabs(contacts[0].penetration_depth - 0.7f) < 0.001f);
+
+        // A capsule lying on the box touches at both ends
+        Physics_object c(capsule, 1);
+        c.coordinate_space() =
+            Coordinate_space(Point(0, 0.9f, 0), Unit_quaternion(Vector(0, 0, 1), to_radians(90)));
+        contacts.clear();
+        Assert::IsTrue(solver.intersection(a, c, contacts) == true);
+        Assert::IsTrue(contacts.size() >= 2);
+        float min_x = 0;
+        float max_x = 0;
+        for (const auto& contact : contacts) {
+            Assert::IsTrue(contact.normal == Unit_vector(0, 1, 0));
+            Assert::IsTrue(fabs(contact.penetration_depth - 0.1f) < 0.0001f);
+            min_x = std::min(min_x, contact.contact_point_a.x());
+            max_x = std::max(max_x, contact.contact_point_a.x());
+        }
+        Assert::IsTrue(fabs(min_x + 1) < 0.0001f && fabs(max_x - 1) < 0.0001f);
+    }
+
+    TEST_METHOD(collision_solver_dispatch)
+    {
+        auto           floor  = std::make_shared<Physics_model>(Local_vector(5, 0.5f, 5));
+        auto           cube   = std::make_shared<Physics_model>(Local_vector(1, 1, 1));
+        auto           sphere = std::make_shared<Physics_model>(0.5f);
+        Physics_object a(floor, 1);
+        Physics_object b(cube, 1);
+        Physics_object c(sphere, 1);
+        b.coordinate_space().position() = Point(0, 1.4f, 0);
+        c.coordinate_space().position() = Point(0, 0, 0);
+
+        // Going back to GJK for boxes only finds one contact
+        Collision_solver                       solver(false);
+        std::vector<Contact_manifold::Contact> contacts;
+        Assert::IsTrue(solver.intersection(a, b, contacts) == true);
+        Assert::IsTrue(contacts.size() == 4);
+        solver.set_collider(Physics_model::Shape::BOX, Physics_model::Shape::BOX,
+                            Collision_solver::gjk_collider);
+        contacts.clear();
+        Assert::IsTrue(solver.intersection(a, b, contacts) == true);
+        Assert::IsTrue(contacts.size() == 1);
+
+        // A Collider set for one order is flipped for the other
+        solver.set_collider(Physics_model::Shape::SPHERE, Physics_model::Shape::BOX,
+                            fixed_collider);
+        contacts.clear();
+        Assert::IsTrue(solver.intersection(c, a, contacts) == true);
+        Assert::IsTrue(contacts.size() == 1);
+        Assert::IsTrue(contacts[0].normal == Unit_vector(0, 0, 1));
+        Assert::IsTrue(contacts[0].contact_point_a == Point(1, 0, 0));
+        contacts.clear();
+        Assert::IsTrue(solver.intersection(a, c, contacts) == true);
+        Assert::IsTrue(contacts.size() == 1);
+        Assert::IsTrue(contacts[0].normal == Unit_vector(0, 0, -1));
+        Assert::IsTrue(contacts[0].contact_point_b == Point(1, 0, 0));
+        Assert::IsTrue(contacts[0].contact_point_a == Point(2, 0, 0));
+    }
+
+    TEST_METHOD(collision_solver_kids)
+    {
+        // Three small cubes around an empty middle
+        Collision_solver solver(false);
+        auto             group_file = Ac3d_file_reader::test_cube_group(0.25f);
+        auto             cube_file  = Ac3d_file_reader::test_cube(0.25f, 0.25f, 0.25f);
+        Physics_object   a(std::make_shared<Physics_model>(*group_file), 1);
+        Physics_object   b(std::make_shared<Physics_model>(*cube_file), 1);
+
+        std::vector<Contact_manifold::Contact> contacts;
+        Assert::IsTrue(solver.intersection(a, b, contacts) == false);
+        b.coordinate_space().position() = Point(1.4f, 0, 0);
+        Assert::IsTrue(solver.intersection(a, b, contacts) == true);
+        Assert::IsTrue(contacts.size() == 1);
+        Assert::IsTrue(contacts[0].normal == Unit_vector(1, 0, 0));
+        Assert::IsTrue(fabs(contacts[0].penetration_depth - 0.1f) < 0.0001f);
+
+        // Turn the group so the kid at z comes round to where the one at x was
+        a.coordinate_space().rotate(Unit_quaternion(Vector(0, 1, 0), to_radians(90)));
+        contacts.clear();
+        Assert::IsTrue(solver.intersection(a, b, contacts) == true);
+        Assert::IsTrue(contacts.size() == 1);
+        Assert::IsTrue(contacts[0].normal == Unit_vector(1, 0, 0));
+    }
+
+private:
+    // Always finds the same contact, with the normal along z
+    static bool fixed_collider(const Physics_model&, const Coordinate_space&, const Physics_model&,
+                               const Coordinate_space&, bool,
+                               std::vector<Contact_manifold::Contact>& contacts,
+                               Collision_solver::Pair_state&)
+    {
+        Contact_manifold::Contact contact;
+        contact.normal          = Unit_vector(0, 0, 1);
+        contact.contact_point_a = Point(1, 0, 0);
+        contact.contact_point_b = Point(2, 0, 0);
+        contacts.push_back(contact);
+        return true;
+    }
 };
 }  // namespace Physics_test
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "CppUnitTest.h"
+#include "Allocation_counter.h"
 
 #include <Physics_model.h>
 #include <Physics_object.h>
@@ -6,7 +7,10 @@
 #include <Collision_strategy_simple.h>
 #include <Collision_strategy_multi_threaded.h>
 #include <Collision_strategy_open_cl.h>
-#include <Contact_manifold.h>
+#include <Collision_strategy_sweep_and_prune.h>
+#include <Collision_strategy_aabb_tree.h>
+#include <Collision_strategy_spatial_hash.h>
+#include <Pair_cache.h>
 
 #include <algorithm>
 
@@ -22,9 +26,9 @@ class Collision_strategy_test
 public:
     TEST_METHOD(collision_strategy_simple)
     {
-        std::vector<std::shared_ptr<Physics_object>>                       objects;
-        std::map<Collision_strategy::Physics_object_ids, Contact_manifold> manifolds;
-        Collision_strategy_simple strategy(0.05f, 0.5f, false);
+        std::vector<std::shared_ptr<Physics_object>> objects;
+        Pair_cache                                   manifolds(0.05f, 0.5f);
+        Collision_strategy_simple strategy(false);
         setup_objects(objects);
         strategy.find_contacts(objects, manifolds);
         Assert::IsTrue(verify_result(objects, manifolds));
@@ -32,24 +36,186 @@ public:
 
     TEST_METHOD(collision_strategy_multi_threaded)
     {
-        std::vector<std::shared_ptr<Physics_object>>                       objects;
-        std::map<Collision_strategy::Physics_object_ids, Contact_manifold> manifolds;
-        Collision_strategy_multi_threaded strategy(0.05f, 0.5f, false, 4);
+        std::vector<std::shared_ptr<Physics_object>> objects;
+        Pair_cache                                   manifolds(0.05f, 0.5f);
+        Collision_strategy_multi_threaded strategy(false, 4);
         setup_objects(objects);
         strategy.find_contacts(objects, manifolds);
         Assert::IsTrue(verify_result(objects, manifolds));
     }
 
+    TEST_METHOD(collision_strategy_multi_threaded_deterministic)
+    {
+        // However the work is split between threads the manifolds should
+        // come out exactly the same as the single threaded version.
+        std::vector<std::shared_ptr<Physics_object>> objects;
+        setup_objects(objects);
+        Pair_cache                expected(0.05f, 0.5f);
+        Collision_strategy_simple simple(true);
+        simple.find_contacts(objects, expected);
+
+        for (unsigned int workgroup_size : {1, 2, 3, 4, 16}) {
+            Pair_cache                        manifolds(0.05f, 0.5f);
+            Collision_strategy_multi_threaded strategy(true, workgroup_size);
+            strategy.find_contacts(objects, manifolds);
+            Assert::IsTrue(manifolds.began() == expected.began());
+            auto expected_iter = expected.begin();
+            for (const auto& manifold : manifolds) {
+                const auto& contacts          = manifold.contacts();
+                const auto& expected_contacts = expected_iter->contacts();
+                Assert::IsTrue(contacts.size() == expected_contacts.size());
+                for (size_t i = 0; i < contacts.size(); ++i) {
+                    Assert::IsTrue(contacts[i].local_point_a == expected_contacts[i].local_point_a);
+                    Assert::IsTrue(contacts[i].local_point_b == expected_contacts[i].local_point_b);
+                }
+                ++expected_iter;
+            }
+        }
+    }
+
     TEST_METHOD(collision_strategy_open_cl)
     {
-        std::vector<std::shared_ptr<Physics_object>>                       objects;
-        std::map<Collision_strategy::Physics_object_ids, Contact_manifold> manifolds;
-        Collision_strategy_open_cl strategy(0.05f, 0.5f, false, 4, 8);
+        std::vector<std::shared_ptr<Physics_object>> objects;
+        Pair_cache                                   manifolds(0.05f, 0.5f);
+        Collision_strategy_open_cl strategy(false, 4, 8);
         setup_objects(objects);
         strategy.find_contacts(objects, manifolds);
         Assert::IsTrue(verify_result(objects, manifolds));
     }
 
+    TEST_METHOD(collision_strategy_sweep_and_prune)
+    {
+        std::vector<std::shared_ptr<Physics_object>> objects;
+        Pair_cache                                   manifolds(0.05f, 0.5f);
+        Collision_strategy_sweep_and_prune strategy(false);
+        setup_objects(objects);
+        strategy.find_contacts(objects, manifolds);
+        Assert::IsTrue(verify_result(objects, manifolds));
+
+        // The sort is kept between calls, so move things around and make sure
+        // pairs are dropped and picked up again
+        objects[2]->coordinate_space().position() = Point(61.5f, 10, 10);
+        strategy.find_contacts(objects, manifolds);
+        Assert::IsTrue(manifolds.size() == 10);
+        Assert::IsFalse(verify_pair(1, 2, objects, manifolds));
+        Assert::IsTrue(verify_pair(2, 3, objects, manifolds));
+
+        objects[2]->coordinate_space().position() = Point(20.1f, 10, 10);
+        strategy.find_contacts(objects, manifolds);
+        Assert::IsTrue(verify_result(objects, manifolds));
+    }
+
+    TEST_METHOD(collision_strategy_aabb_tree)
+    {
+        std::vector<std::shared_ptr<Physics_object>> objects;
+        Pair_cache                                   manifolds(0.05f, 0.5f);
+        Collision_strategy_aabb_tree strategy(false, 0.1f, 2.0f, 0.0166666f);
+        setup_objects(objects);
+        strategy.find_contacts(objects, manifolds);
+        Assert::IsTrue(verify_result(objects, manifolds));
+
+        // Leaves are only reinserted when they leave their fat box, so move
+        // one a long way and make sure the tree keeps up
+        objects[2]->coordinate_space().position() = Point(61.5f, 10, 10);
+        strategy.find_contacts(objects, manifolds);
+        Assert::IsTrue(manifolds.size() == 10);
+        Assert::IsFalse(verify_pair(1, 2, objects, manifolds));
+        Assert::IsTrue(verify_pair(2, 3, objects, manifolds));
+
+        objects[2]->coordinate_space().position() = Point(20.1f, 10, 10);
+        strategy.find_contacts(objects, manifolds);
+        Assert::IsTrue(verify_result(objects, manifolds));
+    }
+
+    TEST_METHOD(collision_strategy_spatial_hash)
+    {
+        std::vector<std::shared_ptr<Physics_object>> objects;
+        Pair_cache                                   manifolds(0.05f, 0.5f);
+        Collision_strategy_spatial_hash strategy(false, 2.5f);
+        setup_objects(objects);
+        strategy.find_contacts(objects, manifolds);
+        Assert::IsTrue(verify_result(objects, manifolds));
+
+        // Cells a bit smaller than the objects put each one in several cells,
+        // every pair should still be found
+        Collision_strategy_spatial_hash small_cells(false, 1.2f);
+        Pair_cache                      small_cell_manifolds(0.05f, 0.5f);
+        small_cells.find_contacts(objects, small_cell_manifolds);
+        Assert::IsTrue(verify_result(objects, small_cell_manifolds));
+
+        // Much smaller and every object is too big for the grid
+        Collision_strategy_spatial_hash tiny_cells(false, 0.3f);
+        Pair_cache                      tiny_cell_manifolds(0.05f, 0.5f);
+        tiny_cells.find_contacts(objects, tiny_cell_manifolds);
+        Assert::IsTrue(verify_result(objects, tiny_cell_manifolds));
+    }
+
+    TEST_METHOD(collision_strategy_spatial_hash_large_floor)
+    {
+        // A big floor is too large for the grid, it should still find every
+        // box sitting on it, and the boxes in a row touching each other.
+        std::unique_ptr<const Ac3d_file> floor_file = Ac3d_file_reader::test_cube(20, 0.5f, 20);
+        std::unique_ptr<const Ac3d_file> box_file = Ac3d_file_reader::test_cube(0.5f, 0.5f, 0.5f);
+        auto floor_model = std::make_shared<Physics_model>(*floor_file);
+        auto box_model   = std::make_shared<Physics_model>(*box_file);
+
+        std::vector<std::shared_ptr<Physics_object>> objects;
+        for (int i = 0; i < 10; ++i) {
+            objects.push_back(std::make_shared<Physics_object>(box_model, 1.0f));
+            objects.back()->coordinate_space().position() =
+                Point(i * 0.95f - 5, 0.95f, 0);
+        }
+        objects.push_back(
+            std::make_shared<Physics_object>(floor_model, Physics_object::STATIONARY));
+        for (size_t i = 0; i < objects.size(); ++i) {
+            objects[i]->id() = i;
+        }
+
+        Pair_cache                expected(0.05f, 0.5f);
+        Collision_strategy_simple simple(false);
+        simple.find_contacts(objects, expected);
+        Assert::IsTrue(expected.size() == 19);
+        Assert::IsTrue(expected.find(std::make_tuple(0, 10)) != expected.end());
+        Assert::IsTrue(expected.find(std::make_tuple(9, 10)) != expected.end());
+
+        Pair_cache                      manifolds(0.05f, 0.5f);
+        Collision_strategy_spatial_hash strategy(false, 2.5f);
+        strategy.find_contacts(objects, manifolds);
+        Assert::IsTrue(manifolds.size() == expected.size());
+        Assert::IsTrue(manifolds.began() == expected.began());
+    }
+
+    TEST_METHOD(collision_strategy_allocations)
+    {
+        // The first step grows the scratch memory and the pair cache to
+        // fit. After that finding the same contacts again shouldn't
+        // allocate anything, on any thread.
+        std::vector<std::shared_ptr<Physics_object>> objects;
+        setup_objects(objects);
+        Pair_cache                        simple_manifolds(0.05f, 0.5f);
+        Collision_strategy_simple         simple(false);
+        Pair_cache                        threaded_manifolds(0.05f, 0.5f);
+        Collision_strategy_multi_threaded threaded(false, 4);
+        Pair_cache                        tree_manifolds(0.05f, 0.5f);
+        Collision_strategy_aabb_tree      tree(false, 0.1f, 2.0f, 0.0166666f);
+        const size_t                      warm_up = allocation_count();
+        simple.find_contacts(objects, simple_manifolds);
+        threaded.find_contacts(objects, threaded_manifolds);
+        tree.find_contacts(objects, tree_manifolds);
+
+        const size_t allocations = allocation_count();
+        Assert::IsTrue(allocations > warm_up);
+        for (int i = 0; i < 5; ++i) {
+            simple.find_contacts(objects, simple_manifolds);
+            threaded.find_contacts(objects, threaded_manifolds);
+            tree.find_contacts(objects, tree_manifolds);
+        }
+        Assert::IsTrue(allocation_count() == allocations);
+        Assert::IsTrue(verify_result(objects, simple_manifolds));
+        Assert::IsTrue(verify_result(objects, threaded_manifolds));
+        Assert::IsTrue(verify_result(objects, tree_manifolds));
+    }
+
 private:
     void setup_objects(std::vector<std::shared_ptr<Physics_object>>& objects)
     {
@@ -98,9 +264,8 @@ private:
         objects[15]->coordinate_space().position() = Point(90, 10, 10);
     }
 
-    bool verify_result(
-        const std::vector<std::shared_ptr<Physics_object>>&                       objects,
-        const std::map<Collision_strategy::Physics_object_ids, Contact_manifold>& manifolds)
+    bool verify_result(const std::vector<std::shared_ptr<Physics_object>>& objects,
+                       const Pair_cache&                                   manifolds)
     {
         return manifolds.size() == 10 &&
                // The first index of every sub-sub-vector collides
@@ -112,19 +277,14 @@ private:
                verify_pair(9, 10, objects, manifolds) && verify_pair(13, 14, objects, manifolds);
     }
 
-    bool verify_pair(
-        size_t a, size_t b, const std::vector<std::shared_ptr<Physics_object>>& objects,
-        const std::map<Collision_strategy::Physics_object_ids, Contact_manifold>& manifolds)
+    bool verify_pair(size_t a, size_t b,
+                     const std::vector<std::shared_ptr<Physics_object>>& objects,
+                     const Pair_cache&                                   manifolds)
     {
-        for (const auto& result : manifolds) {
-            if ((std::get<0>(result.first) == objects[a]->id() &&
-                 std::get<1>(result.first) == objects[b]->id()) ||
-                (std::get<1>(result.first) == objects[a]->id() &&
-                 std::get<0>(result.first) == objects[b]->id())) {
-                return true;
-            }
-        }
-        return false;
+        return manifolds.find(std::make_tuple(objects[a]->id(), objects[b]->id())) !=
+                   manifolds.end() ||
+               manifolds.find(std::make_tuple(objects[b]->id(), objects[a]->id())) !=
+                   manifolds.end();
     }
 };
 }  // namespace Physics_test
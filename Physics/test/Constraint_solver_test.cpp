@@ -4,10 +4,14 @@
 #include <Physics_object.h>
 #include <Collision_solver.h>
 #include <Constraint_solver.h>
+#include <Constraint_solver_wide.h>
+#include <Pair_cache.h>
 #include <Triple.h>
 #include <Coordinate_space.h>
 #include <Ac3d_file_reader.h>
 
+#include <cmath>
+
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 using namespace Dubious::Physics;
 using namespace Dubious::Math;
@@ -51,17 +55,14 @@ public:
 
         Contact_manifold manifold(*cube1, *cube2, 0.05f, 0.05f);
         manifold.insert(contacts);
-        Constraint_solver constraint_solver(0.016f, 0.03f, 0.5f, 0.05f);
-        constraint_solver.solve(manifold);
-
-        manifold.object_a().velocity() += manifold.a_delta_velocity();
-        manifold.object_a().angular_velocity() += manifold.a_delta_angular_velocity();
-        manifold.object_b().velocity() += manifold.b_delta_velocity();
-        manifold.object_b().angular_velocity() += manifold.b_delta_angular_velocity();
-
-        Assert::IsTrue(cube1->velocity() == -cube2->velocity());
-        Assert::IsTrue(cube1->angular_velocity() == Vector());
-        Assert::IsTrue(cube2->angular_velocity() == Vector());
+        std::vector<Constraint_solver::Body> bodies = {Constraint_solver::Body(*cube1),
+                                                       Constraint_solver::Body(*cube2)};
+        Constraint_solver                    constraint_solver(0.016f, 0.03f, 0.5f, 0.05f);
+        constraint_solver.solve(constraint_solver.prepare(manifold, 0, 1), bodies);
+
+        Assert::IsTrue(bodies[0].velocity == -bodies[1].velocity);
+        Assert::IsTrue(bodies[0].angular_velocity == Vector());
+        Assert::IsTrue(bodies[1].angular_velocity == Vector());
     }
 
     TEST_METHOD(constraint_solver_two_cubes_two_points)
@@ -106,17 +107,14 @@ public:
 
         Contact_manifold manifold(*cube1, *cube2, 0.05f, 0.05f);
         manifold.insert(contacts);
-        Constraint_solver constraint_solver(0.016f, 0.03f, 0.5f, 0.05f);
-        constraint_solver.solve(manifold);
-
-        manifold.object_a().velocity() += manifold.a_delta_velocity();
-        manifold.object_a().angular_velocity() += manifold.a_delta_angular_velocity();
-        manifold.object_b().velocity() += manifold.b_delta_velocity();
-        manifold.object_b().angular_velocity() += manifold.b_delta_angular_velocity();
-
-        Assert::IsTrue(cube1->velocity() == -cube2->velocity());
-        Assert::IsTrue(cube1->angular_velocity() == Vector());
-        Assert::IsTrue(cube2->angular_velocity() == Vector());
+        std::vector<Constraint_solver::Body> bodies = {Constraint_solver::Body(*cube1),
+                                                       Constraint_solver::Body(*cube2)};
+        Constraint_solver                    constraint_solver(0.016f, 0.03f, 0.5f, 0.05f);
+        constraint_solver.solve(constraint_solver.prepare(manifold, 0, 1), bodies);
+
+        Assert::IsTrue(bodies[0].velocity == -bodies[1].velocity);
+        Assert::IsTrue(bodies[0].angular_velocity == Vector());
+        Assert::IsTrue(bodies[1].angular_velocity == Vector());
     }
 
     TEST_METHOD(constraint_solver_two_cubes_one_offset_point)
@@ -151,16 +149,13 @@ public:
 
         Contact_manifold manifold(*cube1, *cube2, 0.05f, 0.05f);
         manifold.insert(contacts);
-        Constraint_solver constraint_solver(0.016f, 0.03f, 0.5f, 0.05f);
-        constraint_solver.solve(manifold);
-
-        manifold.object_a().velocity() += manifold.a_delta_velocity();
-        manifold.object_a().angular_velocity() += manifold.a_delta_angular_velocity();
-        manifold.object_b().velocity() += manifold.b_delta_velocity();
-        manifold.object_b().angular_velocity() += manifold.b_delta_angular_velocity();
+        std::vector<Constraint_solver::Body> bodies = {Constraint_solver::Body(*cube1),
+                                                       Constraint_solver::Body(*cube2)};
+        Constraint_solver                    constraint_solver(0.016f, 0.03f, 0.5f, 0.05f);
+        constraint_solver.solve(constraint_solver.prepare(manifold, 0, 1), bodies);
 
-        Assert::IsTrue(cube1->velocity() == -cube2->velocity());
-        Assert::IsTrue(cube1->angular_velocity() == -cube2->angular_velocity());
+        Assert::IsTrue(bodies[0].velocity == -bodies[1].velocity);
+        Assert::IsTrue(bodies[0].angular_velocity == -bodies[1].angular_velocity);
     }
 
     TEST_METHOD(constraint_solver_three_cubes_one_point)
@@ -220,19 +215,26 @@ public:
         Contact_manifold manifold_2(*cube1, *cube3, 0.05f, 0.05f);
         manifold_2.insert(contacts_2);
 
-        Constraint_solver constraint_solver(0.016f, 0.03f, 0.5f, 0.05f);
-        constraint_solver.solve(manifold_1);
-        constraint_solver.solve(manifold_2);
-
-        manifold_1.object_a().velocity() += manifold_1.a_delta_velocity();
-        manifold_1.object_a().angular_velocity() += manifold_1.a_delta_angular_velocity();
-        manifold_1.object_b().velocity() += manifold_1.b_delta_velocity();
-        manifold_1.object_b().angular_velocity() += manifold_1.b_delta_angular_velocity();
-
-        manifold_2.object_a().velocity() += manifold_2.a_delta_velocity();
-        manifold_2.object_a().angular_velocity() += manifold_2.a_delta_angular_velocity();
-        manifold_2.object_b().velocity() += manifold_2.b_delta_velocity();
-        manifold_2.object_b().angular_velocity() += manifold_2.b_delta_angular_velocity();
+        // Both manifolds are solved from the same starting velocities, then
+        // what each of them did to the cubes is added together
+        std::shared_ptr<Physics_object>      cubes[3] = {cube1, cube2, cube3};
+        std::vector<Constraint_solver::Body> start;
+        for (const auto& cube : cubes) {
+            start.push_back(Constraint_solver::Body(*cube));
+        }
+        std::vector<Constraint_solver::Body> bodies_1 = start;
+        std::vector<Constraint_solver::Body> bodies_2 = start;
+        Constraint_solver                    constraint_solver(0.016f, 0.03f, 0.5f, 0.05f);
+        constraint_solver.solve(constraint_solver.prepare(manifold_1, 0, 1), bodies_1);
+        constraint_solver.solve(constraint_solver.prepare(manifold_2, 0, 2), bodies_2);
+
+        for (int i = 0; i < 3; ++i) {
+            cubes[i]->velocity() += (bodies_1[i].velocity - start[i].velocity) +
+                                    (bodies_2[i].velocity - start[i].velocity);
+            cubes[i]->angular_velocity() +=
+                (bodies_1[i].angular_velocity - start[i].angular_velocity) +
+                (bodies_2[i].angular_velocity - start[i].angular_velocity);
+        }
 
         Assert::IsTrue(cube1->velocity() == Vector());
         Assert::IsTrue(cube2->velocity() == -cube3->velocity());
@@ -288,16 +290,86 @@ public:
 
         Contact_manifold manifold(*floor, *cube1, 0.05f, 0.05f);
         manifold.insert(contacts);
+        std::vector<Constraint_solver::Body> bodies = {Constraint_solver::Body(*floor),
+                                                       Constraint_solver::Body(*cube1)};
         //        Constraint_solver constraint_solver(0.016f, 0.03f, 0.5f, 0.05f);
         Constraint_solver constraint_solver(0.016f, 0.03f, 0.0f, 0.05f);
-        constraint_solver.solve(manifold);
+        constraint_solver.solve(constraint_solver.prepare(manifold, 0, 1), bodies);
+
+        //        Assert::IsTrue(bodies[1].angular_velocity == Vector());
+    }
 
-        manifold.object_a().velocity() += manifold.a_delta_velocity();
-        manifold.object_a().angular_velocity() += manifold.a_delta_angular_velocity();
-        manifold.object_b().velocity() += manifold.b_delta_velocity();
-        manifold.object_b().angular_velocity() += manifold.b_delta_angular_velocity();
+    TEST_METHOD(constraint_solver_wide_three_cubes)
+    {
+        // Three cubes in a stack, moving and spinning into each other. There's
+        // one offset contact point between each pair. The wide solver should
+        // end up with the same velocities as solving one manifold at a time.
+        auto model_file    = Ac3d_file_reader::test_cube(0.5f, 0.5f, 0.5f);
+        auto physics_model = std::make_shared<Physics_model>(*model_file);
+
+        std::shared_ptr<Physics_object> cubes[3];
+        std::shared_ptr<Physics_object> wide_cubes[3];
+        for (int i = 0; i < 3; ++i) {
+            for (auto set : {cubes, wide_cubes}) {
+                set[i]       = std::make_shared<Physics_object>(physics_model, 1.0f + i);
+                set[i]->id() = i + 1;
+                set[i]->coordinate_space().translate(Vector(0, 0.9f * i, 0));
+                set[i]->velocity()         = Vector(0.1f * i, 1.0f - i, 0);
+                set[i]->angular_velocity() = Vector(0, 0, 0.5f * i);
+            }
+        }
+        std::vector<Contact_manifold::Contact> contacts;
+        Contact_manifold::Contact              c;
+        c.local_point_a     = Local_point(0.2f, 0.5f, 0.1f);
+        c.local_point_b     = Local_point(0.2f, -0.5f, 0.1f);
+        c.normal            = Unit_vector(0, 1, 0);
+        c.tangent1          = Unit_vector(0, 0, -1);
+        c.tangent2          = Unit_vector(-1, 0, 0);
+        c.penetration_depth = 0.1f;
+        contacts.push_back(c);
+
+        std::vector<Constraint_solver::Body> bodies;
+        std::vector<Constraint_solver::Body> wide_bodies;
+        for (int i = 0; i < 3; ++i) {
+            bodies.push_back(Constraint_solver::Body(*cubes[i]));
+            wide_bodies.push_back(Constraint_solver::Body(*wide_cubes[i]));
+        }
+
+        Contact_manifold  lower(*cubes[0], *cubes[1], 0.05f, 0.05f);
+        Contact_manifold  upper(*cubes[1], *cubes[2], 0.05f, 0.05f);
+        Constraint_solver constraint_solver(0.016f, 0.03f, 0.5f, 0.05f);
+        lower.insert(contacts);
+        upper.insert(contacts);
+        const size_t prepared[] = {constraint_solver.prepare(lower, 0, 1),
+                                   constraint_solver.prepare(upper, 1, 2)};
+        for (int i = 0; i < 10; ++i) {
+            for (size_t manifold : prepared) {
+                constraint_solver.solve(manifold, bodies);
+            }
+        }
 
-        //        Assert::IsTrue(cube1->angular_velocity() == Vector());
+        Pair_cache pairs(0.05f, 0.05f);
+        pairs.begin_step();
+        pairs.touch(*wide_cubes[0], *wide_cubes[1]).insert(contacts);
+        pairs.touch(*wide_cubes[1], *wide_cubes[2]).insert(contacts);
+        pairs.end_step();
+        constraint_solver.begin_step();
+        for (auto& manifold : pairs) {
+            constraint_solver.prepare(manifold, manifold.object_a().id() - 1,
+                                      manifold.object_b().id() - 1);
+        }
+        Constraint_solver_wide wide_solver;
+        wide_solver.solve(constraint_solver, wide_bodies, 10);
+
+        for (int i = 0; i < 3; ++i) {
+            Assert::IsTrue((bodies[i].velocity - wide_bodies[i].velocity).length() < 0.0001f);
+            Assert::IsTrue(
+                (bodies[i].angular_velocity - wide_bodies[i].angular_velocity).length() < 0.0001f);
+        }
+        Assert::IsTrue(lower.contacts()[0].normal_impulse > 0);
+        Assert::IsTrue(
+            std::abs(lower.contacts()[0].normal_impulse -
+                     pairs.begin()->contacts()[0].normal_impulse) < 0.0001f);
     }
 };
 
@@ -78,6 +78,49 @@ public:
         Assert::IsTrue(contact_manifold.contacts().size() == 0);
     }
 
+    TEST_METHOD(contact_manifold_full_test)
+    {
+        std::unique_ptr<const Ac3d_file> model_file = Ac3d_file_reader::test_cube(1.0f, 1.0f, 1.0f);
+
+        std::shared_ptr<Physics_model>  model = std::make_shared<Physics_model>(*model_file);
+        std::shared_ptr<Physics_object> a(new Physics_object(model, 1));
+        std::shared_ptr<Physics_object> b(new Physics_object(model, 1));
+        b->coordinate_space().position() = Point(0, 1.9f, 0);
+
+        // The four corners of the face and a couple of points inside
+        // it. The manifold should hang on to the corners.
+        const Point points[6] = {Point(0, 0.95f, 0), Point(-1, 0.95f, -1),
+                                 Point(1, 0.95f, -1), Point(0.5f, 0.95f, 0.5f),
+                                 Point(1, 0.95f, 1), Point(-1, 0.95f, 1)};
+        std::vector<Contact_manifold::Contact> contacts;
+        for (const Point& p : points) {
+            Contact_manifold::Contact c;
+            c.contact_point_a   = p + Vector(0, 0.05f, 0);
+            c.contact_point_b   = p - Vector(0, 0.05f, 0);
+            c.local_point_a     = a->coordinate_space().transform(c.contact_point_a);
+            c.local_point_b     = b->coordinate_space().transform(c.contact_point_b);
+            c.normal            = Unit_vector(0, 1, 0);
+            c.penetration_depth = p == points[1] ? 0.2f : 0.1f;
+            contacts.push_back(c);
+        }
+        Contact_manifold contact_manifold(*a, *b, 0.05f, 0.05f);
+        contact_manifold.insert(contacts);
+        Assert::IsTrue(contact_manifold.contacts().size() == 4);
+        for (const auto& c : contact_manifold.contacts()) {
+            const Point p = contact_manifold.contact_point_a(c);
+            Assert::IsTrue(std::abs(p.x()) == 1 && std::abs(p.z()) == 1);
+        }
+
+        // Copies are independent of the original
+        Contact_manifold copy = contact_manifold;
+        contact_manifold.prune_old_contacts();
+        Assert::IsTrue(contact_manifold.contacts().size() == 4);
+        b->coordinate_space().position() = Point(0, 2.2f, 0);
+        contact_manifold.prune_old_contacts();
+        Assert::IsTrue(contact_manifold.contacts().size() == 0);
+        Assert::IsTrue(copy.contacts().size() == 4);
+    }
+
     TEST_METHOD(contact_manifold_distance_squared_to_line_segment_test)
     {
         // Methodology:
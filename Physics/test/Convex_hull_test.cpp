@@ -0,0 +1,104 @@
+#include "CppUnitTest.h"
+
+#include <Convex_hull.h>
+#include <Vector_math.h>
+
+#include <cmath>
+#include <random>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Dubious::Physics;
+using namespace Dubious::Math;
+
+namespace Physics_test {
+
+class Convex_hull_test
+    : public ::Microsoft::VisualStudio::CppUnitTestFramework::TestClass<Convex_hull_test> {
+public:
+    TEST_METHOD(convex_hull_cube)
+    {
+        // The corners, followed by a bunch of points that are all either
+        // inside the cube or on its faces and edges
+        std::vector<Local_vector> points;
+        for (int i = 0; i < 8; ++i) {
+            points.push_back(Local_vector(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f,
+                                          i & 4 ? 1.0f : -1.0f));
+        }
+        points.push_back(Local_vector(0, 0, 0));
+        points.push_back(Local_vector(1, 0, 0));
+        points.push_back(Local_vector(0, -1, 0));
+        points.push_back(Local_vector(1, 1, 0));
+        points.push_back(Local_vector(-1, 0, -1));
+        points.push_back(Local_vector(0.5f, 0.25f, 1.0f));
+        points.push_back(points[3]);
+        std::mt19937                          generator(1);
+        std::uniform_real_distribution<float> inside(-0.99f, 0.99f);
+        for (int i = 0; i < 100; ++i) {
+            points.push_back(Local_vector(inside(generator), inside(generator), inside(generator)));
+        }
+
+        Convex_hull hull(points);
+        Assert::IsTrue(hull.vertices().size() == 8);
+        Assert::IsTrue(hull.faces().size() == 12);
+        for (int i = 0; i < 8; ++i) {
+            Assert::IsTrue(hull.vertices()[i] == points[i]);
+        }
+        Assert::IsTrue(is_convex(hull, points));
+    }
+
+    TEST_METHOD(convex_hull_sphere)
+    {
+        std::vector<Local_vector>       points;
+        std::mt19937                    generator(2);
+        std::normal_distribution<float> normal;
+        for (int i = 0; i < 200; ++i) {
+            Local_vector v(normal(generator), normal(generator), normal(generator));
+            points.push_back(v / v.length());
+        }
+        Convex_hull hull(points);
+        Assert::IsTrue(hull.vertices().size() == points.size());
+        // Euler: a closed triangle mesh has 2V - 4 faces
+        Assert::IsTrue(hull.faces().size() == 2 * points.size() - 4);
+        Assert::IsTrue(is_convex(hull, points));
+
+        Convex_hull simplified(points, 20);
+        Assert::IsTrue(simplified.vertices().size() == 20);
+        Assert::IsTrue(simplified.faces().size() == 2 * 20 - 4);
+        Assert::IsTrue(is_convex(simplified, simplified.vertices()));
+    }
+
+    TEST_METHOD(convex_hull_flat)
+    {
+        // No volume, so nothing can be removed except the duplicate
+        std::vector<Local_vector> points;
+        points.push_back(Local_vector(0, 0, 0));
+        points.push_back(Local_vector(1, 0, 0));
+        points.push_back(Local_vector(1, 1, 0));
+        points.push_back(Local_vector(0, 1, 0));
+        points.push_back(Local_vector(0.5f, 0.5f, 0));
+        points.push_back(Local_vector(1, 0, 0));
+        Convex_hull hull(points);
+        Assert::IsTrue(hull.vertices().size() == 5);
+        Assert::IsTrue(hull.faces().empty());
+    }
+
+private:
+    // Every point has to be behind (or on) every face
+    bool is_convex(const Convex_hull& hull, const std::vector<Local_vector>& points)
+    {
+        for (const auto& face : hull.faces()) {
+            const Local_vector& a = hull.vertices()[face[0]];
+            const Local_vector& b = hull.vertices()[face[1]];
+            const Local_vector& c = hull.vertices()[face[2]];
+            Local_vector        n = cross_product(b - a, c - a);
+            n                     = n / n.length();
+            for (const auto& p : points) {
+                if (dot_product(n, p - a) > 0.001f) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+};
+}  // namespace Physics_test
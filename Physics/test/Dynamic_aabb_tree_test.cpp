@@ -0,0 +1,113 @@
+#include "CppUnitTest.h"
+
+#include <Dynamic_aabb_tree.h>
+
+#include <algorithm>
+#include <random>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Dubious::Physics;
+
+namespace Physics_test {
+
+class Dynamic_aabb_tree_test
+    : public ::Microsoft::VisualStudio::CppUnitTestFramework::TestClass<Dynamic_aabb_tree_test> {
+public:
+    TEST_METHOD(dynamic_aabb_tree_pairs)
+    {
+        std::vector<Dynamic_aabb_tree::Aabb>  boxes;
+        std::mt19937                          generator(1);
+        std::uniform_real_distribution<float> position(0, 50);
+        std::uniform_real_distribution<float> size(0.1f, 3);
+        for (int i = 0; i < 500; ++i) {
+            boxes.push_back(make_box(position(generator), position(generator),
+                                     position(generator), size(generator)));
+        }
+
+        Dynamic_aabb_tree tree;
+        std::vector<int>  proxies;
+        for (size_t i = 0; i < boxes.size(); ++i) {
+            proxies.push_back(tree.insert(boxes[i], i));
+        }
+        Assert::IsTrue(same_pairs(tree, boxes));
+        // A balanced tree of 500 leaves should be nowhere near this tall
+        Assert::IsTrue(tree.height() < 20);
+
+        // Move everything, some will escape their boxes and some won't
+        for (size_t i = 0; i < boxes.size(); ++i) {
+            boxes[i] = make_box(position(generator), position(generator), position(generator),
+                                size(generator));
+            tree.move(proxies[i], boxes[i], boxes[i]);
+            boxes[i] = tree.fat_box(proxies[i]);
+        }
+        Assert::IsTrue(same_pairs(tree, boxes));
+        Assert::IsTrue(tree.height() < 20);
+
+        // A box that stays inside its fat box is left alone
+        const auto fat   = tree.fat_box(proxies[0]);
+        const auto tight = make_box((fat.min[0] + fat.max[0]) / 2, (fat.min[1] + fat.max[1]) / 2,
+                                    (fat.min[2] + fat.max[2]) / 2, 0.01f);
+        Assert::IsFalse(tree.move(proxies[0], tight, tight));
+    }
+
+    TEST_METHOD(dynamic_aabb_tree_remove)
+    {
+        Dynamic_aabb_tree tree;
+        const int         a = tree.insert(make_box(0, 0, 0, 1), 0);
+        const int         b = tree.insert(make_box(1, 0, 0, 1), 1);
+        const int         c = tree.insert(make_box(10, 0, 0, 1), 2);
+
+        std::vector<std::tuple<size_t, size_t>> pairs;
+        tree.overlapping_pairs(pairs);
+        Assert::IsTrue(pairs.size() == 1);
+        Assert::IsTrue(pairs[0] == std::make_tuple<size_t, size_t>(0, 1));
+
+        tree.remove(b);
+        pairs.clear();
+        tree.overlapping_pairs(pairs);
+        Assert::IsTrue(pairs.empty());
+
+        // the freed node gets reused
+        const int d = tree.insert(make_box(10.5f, 0, 0, 1), 3);
+        pairs.clear();
+        tree.overlapping_pairs(pairs);
+        Assert::IsTrue(pairs.size() == 1);
+        Assert::IsTrue(pairs[0] == std::make_tuple<size_t, size_t>(2, 3));
+
+        tree.remove(a);
+        tree.remove(c);
+        tree.remove(d);
+        Assert::IsTrue(tree.height() == 0);
+    }
+
+private:
+    Dynamic_aabb_tree::Aabb make_box(float x, float y, float z, float half_size)
+    {
+        Dynamic_aabb_tree::Aabb box;
+        box.min[0] = x - half_size;
+        box.min[1] = y - half_size;
+        box.min[2] = z - half_size;
+        box.max[0] = x + half_size;
+        box.max[1] = y + half_size;
+        box.max[2] = z + half_size;
+        return box;
+    }
+
+    bool same_pairs(const Dynamic_aabb_tree&                    tree,
+                    const std::vector<Dynamic_aabb_tree::Aabb>& boxes)
+    {
+        std::vector<std::tuple<size_t, size_t>> expected;
+        for (size_t i = 0; i < boxes.size(); ++i) {
+            for (size_t j = i + 1; j < boxes.size(); ++j) {
+                if (boxes[i].overlaps(boxes[j])) {
+                    expected.push_back(std::make_tuple(i, j));
+                }
+            }
+        }
+        std::vector<std::tuple<size_t, size_t>> pairs;
+        tree.overlapping_pairs(pairs);
+        std::sort(pairs.begin(), pairs.end());
+        return !expected.empty() && pairs == expected;
+    }
+};
+}  // namespace Physics_test
@@ -0,0 +1,101 @@
+#include "CppUnitTest.h"
+
+#include <Minkowski_polytope.h>
+#include <Minkowski_simplex.h>
+#include <Vector_math.h>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <tuple>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Dubious::Physics;
+using namespace Dubious::Math;
+
+namespace Physics_test {
+
+class Minkowski_polytope_test
+    : public ::Microsoft::VisualStudio::CppUnitTestFramework::TestClass<Minkowski_polytope_test> {
+public:
+    TEST_METHOD(minkowski_polytope_cube)
+    {
+        // Start from a tetrahedron of cube corners and expand out to the
+        // cube the same way EPA does. The closest face ends up 1 away.
+        Minkowski_polytope           polytope(tetrahedron());
+        Minkowski_polytope::Triangle triangle;
+        float                        distance = 0;
+        for (int i = 0; i < 20; ++i) {
+            std::tie(triangle, distance) = polytope.find_closest_triangle();
+            const Vector support         = cube_support(Vector(triangle.normal));
+            if (dot_product(support, Vector(triangle.normal)) <= distance + 0.001f) {
+                break;
+            }
+            polytope.push_back(Minkowski_vector(support, support, Vector()));
+        }
+        Assert::IsTrue(std::abs(distance - 1) < 0.001f);
+        const float largest = std::max(std::abs(triangle.normal.x()),
+                                       std::max(std::abs(triangle.normal.y()),
+                                                std::abs(triangle.normal.z())));
+        Assert::IsTrue(std::abs(largest - 1) < 0.001f);
+    }
+
+    TEST_METHOD(minkowski_polytope_inside)
+    {
+        // A point no face can see leaves the polytope alone
+        Minkowski_polytope           polytope(tetrahedron());
+        Minkowski_polytope::Triangle before;
+        float                        before_distance;
+        std::tie(before, before_distance) = polytope.find_closest_triangle();
+        polytope.push_back(Minkowski_vector(Vector(0.1f, 0, 0), Vector(), Vector()));
+        Minkowski_polytope::Triangle after;
+        float                        after_distance;
+        std::tie(after, after_distance) = polytope.find_closest_triangle();
+        Assert::IsTrue(before_distance == after_distance);
+        Assert::IsTrue(before.normal == after.normal);
+    }
+
+    TEST_METHOD(minkowski_polytope_full)
+    {
+        // Points on a sphere, every one of them is a new vertex
+        Minkowski_polytope polytope(tetrahedron());
+        for (int i = 4; i < Minkowski_polytope::MAX_VERTICES; ++i) {
+            const float  angle = i * 2.4f;
+            const float  y     = 1 - 2 * (i + 0.5f) / Minkowski_polytope::MAX_VERTICES;
+            const float  r     = std::sqrt(1 - y * y) * 2;
+            const Vector v(std::cos(angle) * r, y * 2, std::sin(angle) * r);
+            polytope.push_back(Minkowski_vector(v, v, Vector()));
+        }
+        float distance;
+        std::tie(std::ignore, distance) = polytope.find_closest_triangle();
+        Assert::IsTrue(distance > 0 && distance < 2);
+        bool threw = false;
+        try {
+            polytope.push_back(Minkowski_vector(Vector(5, 5, 5), Vector(5, 5, 5), Vector()));
+        }
+        catch (const std::runtime_error&) {
+            threw = true;
+        }
+        Assert::IsTrue(threw);
+    }
+
+private:
+    // Every other corner of the cube, in the order GJK leaves a simplex
+    Minkowski_simplex tetrahedron()
+    {
+        const Vector corners[4] = {Vector(-1, -1, 1), Vector(-1, 1, -1), Vector(1, -1, -1),
+                                   Vector(1, 1, 1)};
+        Minkowski_simplex simplex;
+        for (const auto& corner : corners) {
+            simplex.push_back(Minkowski_vector(corner, corner, Vector()));
+        }
+        return simplex;
+    }
+
+    Vector cube_support(const Vector& direction)
+    {
+        return Vector(direction.x() < 0 ? -1.0f : 1.0f, direction.y() < 0 ? -1.0f : 1.0f,
+                      direction.z() < 0 ? -1.0f : 1.0f);
+    }
+};
+}  // namespace Physics_test
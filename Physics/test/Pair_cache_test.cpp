@@ -0,0 +1,153 @@
+#include "CppUnitTest.h"
+
+#include <Pair_cache.h>
+#include <Physics_model.h>
+#include <Physics_object.h>
+#include <Ac3d_file_reader.h>
+
+#include <map>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Dubious::Physics;
+using namespace Dubious::Utility;
+
+namespace Physics_test {
+
+class Pair_cache_test
+    : public ::Microsoft::VisualStudio::CppUnitTestFramework::TestClass<Pair_cache_test> {
+public:
+    TEST_METHOD(pair_cache_events)
+    {
+        std::unique_ptr<const Ac3d_file> model_file = Ac3d_file_reader::test_cube(1.0f, 1.0f, 1.0f);
+        std::shared_ptr<Physics_model>   model      = std::make_shared<Physics_model>(*model_file);
+        Physics_object                   a(model, 1);
+        Physics_object                   b(model, 1);
+        Physics_object                   c(model, 1);
+        a.id() = 1;
+        b.id() = 2;
+        c.id() = 3;
+
+        Pair_cache cache(0.05f, 0.05f);
+        cache.begin_step();
+        cache.touch(a, b);
+        cache.touch(a, c);
+        cache.touch(b, c);
+        cache.end_step();
+        Assert::IsTrue(cache.size() == 3);
+        Assert::IsTrue(cache.began().size() == 3);
+        Assert::IsTrue(cache.ended().empty());
+
+        // touching a pair again gives back the same manifold
+        Contact_manifold& manifold = *cache.find(std::make_tuple(1, 2));
+        cache.clear_events();
+        cache.begin_step();
+        Assert::IsTrue(&cache.touch(a, b) == &manifold);
+        cache.touch(b, c);
+        cache.end_step();
+        Assert::IsTrue(cache.size() == 2);
+        Assert::IsTrue(cache.began().empty());
+        Assert::IsTrue(cache.ended().size() == 1);
+        Assert::IsTrue(cache.ended()[0] == std::make_tuple(1, 3));
+        Assert::IsTrue(cache.find(std::make_tuple(1, 3)) == cache.end());
+
+        // events keep building up until they're cleared
+        cache.begin_step();
+        cache.touch(a, c);
+        cache.end_step();
+        Assert::IsTrue(cache.size() == 1);
+        Assert::IsTrue(cache.began().size() == 1);
+        Assert::IsTrue(cache.ended().size() == 3);
+        Assert::IsTrue(cache.find(std::make_tuple(1, 3)) != cache.end());
+    }
+
+    TEST_METHOD(pair_cache_many_pairs)
+    {
+        std::unique_ptr<const Ac3d_file> model_file = Ac3d_file_reader::test_cube(1.0f, 1.0f, 1.0f);
+        std::shared_ptr<Physics_model>   model      = std::make_shared<Physics_model>(*model_file);
+
+        std::vector<std::unique_ptr<Physics_object>> objects;
+        for (int i = 0; i < 50; ++i) {
+            objects.emplace_back(new Physics_object(model, 1));
+            objects.back()->id() = 50 - i;
+        }
+
+        // Enough new pairs in one step to make the table grow a few times
+        Pair_cache cache(0.05f, 0.05f);
+        cache.begin_step();
+        for (size_t i = 0; i < objects.size(); ++i) {
+            for (size_t j = i + 1; j < objects.size(); ++j) {
+                cache.touch(*objects[i], *objects[j]);
+            }
+        }
+        cache.end_step();
+        Assert::IsTrue(cache.size() == 50 * 49 / 2);
+        Assert::IsTrue(cache.began().size() == 50 * 49 / 2);
+
+        // Iteration is always sorted by id
+        auto previous = cache.begin();
+        for (auto iter = cache.begin(); iter != cache.end(); ++iter) {
+            Assert::IsTrue(previous.ids() <= iter.ids());
+            previous = iter;
+        }
+
+        // Drop every pair with the first object
+        cache.begin_step();
+        for (size_t i = 1; i < objects.size(); ++i) {
+            for (size_t j = i + 1; j < objects.size(); ++j) {
+                cache.touch(*objects[i], *objects[j]);
+            }
+        }
+        cache.end_step();
+        Assert::IsTrue(cache.size() == 49 * 48 / 2);
+        Assert::IsTrue(cache.ended().size() == 49);
+        Assert::IsTrue(cache.find(std::make_tuple(50, 49)) == cache.end());
+        Assert::IsTrue(cache.find(std::make_tuple(49, 48)) != cache.end());
+        Assert::IsTrue(&cache.find(std::make_tuple(49, 48))->object_a() == objects[1].get());
+    }
+
+    TEST_METHOD(pair_cache_churn)
+    {
+        // Pairs come and go every step. The cache should always hold exactly
+        // the pairs touched last, in order, and a pair that stays in the cache
+        // keeps the same manifold.
+        std::unique_ptr<const Ac3d_file> model_file = Ac3d_file_reader::test_cube(1.0f, 1.0f, 1.0f);
+        std::shared_ptr<Physics_model>   model      = std::make_shared<Physics_model>(*model_file);
+
+        std::vector<std::unique_ptr<Physics_object>> objects;
+        for (int i = 0; i < 30; ++i) {
+            objects.emplace_back(new Physics_object(model, 1));
+            objects.back()->id() = i;
+        }
+
+        Pair_cache                                            cache(0.05f, 0.05f);
+        std::map<Pair_cache::Physics_object_ids, const void*> expected;
+        for (int step = 0; step < 50; ++step) {
+            std::map<Pair_cache::Physics_object_ids, const void*> touched;
+            cache.begin_step();
+            for (int i = 0; i < 30; ++i) {
+                for (int j = i + 1; j < 30; ++j) {
+                    if ((i * 7 + j * 13 + step * (i + 1)) % 5 < 2) {
+                        const auto ids = std::make_tuple(i, j);
+                        touched[ids]   = &cache.touch(*objects[i], *objects[j]);
+                        if (expected.count(ids)) {
+                            Assert::IsTrue(touched[ids] == expected[ids]);
+                        }
+                    }
+                }
+            }
+            cache.end_step();
+            expected.swap(touched);
+
+            Assert::IsTrue(cache.size() == expected.size());
+            auto iter = cache.begin();
+            for (const auto& pair : expected) {
+                Assert::IsTrue(iter.ids() == pair.first);
+                Assert::IsTrue(&*iter == pair.second);
+                Assert::IsTrue(cache.state(pair.first) != nullptr);
+                ++iter;
+            }
+            Assert::IsTrue(cache.state(std::make_tuple(30, 31)) == nullptr);
+        }
+    }
+};
+}  // namespace Physics_test
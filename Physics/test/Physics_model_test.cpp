@@ -3,6 +3,10 @@
 #include <Utils.h>
 #include <Ac3d_file_reader.h>
 #include <Physics_model.h>
+#include <Vector_math.h>
+
+#include <algorithm>
+#include <random>
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 using namespace Dubious::Physics;
@@ -25,5 +29,166 @@ public:
         model      = std::make_shared<Physics_model>(*model_file);
         Assert::IsTrue(equals(model->radius(), 1.0f + sqrt(3.0f)));
     }
+
+    TEST_METHOD(hull_test)
+    {
+        // A cube with extra points in the middle of every face and one in
+        // the center. Only the corners should be left.
+        std::unique_ptr<Ac3d_model> ac3d_model = std::make_unique<Ac3d_model>();
+        for (int i = 0; i < 8; ++i) {
+            ac3d_model->points().push_back(Local_point(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f,
+                                                       i & 4 ? 1.0f : -1.0f));
+        }
+        for (int axis = 0; axis < 3; ++axis) {
+            for (float side : {-1.0f, 1.0f}) {
+                ac3d_model->points().push_back(Local_point(axis == 0 ? side : 0,
+                                                           axis == 1 ? side : 0,
+                                                           axis == 2 ? side : 0));
+            }
+        }
+        ac3d_model->points().push_back(Local_point(0, 0, 0));
+        std::vector<Ac3d_material> materials;
+        materials.push_back(Ac3d_material::Color(1.0f, 1.0f, 1.0f));
+        Ac3d_file model_file(std::move(materials), std::move(ac3d_model));
+
+        Physics_model model(model_file);
+        Assert::IsTrue(model.vectors().size() == 8);
+        Assert::IsTrue(equals(model.radius(), sqrt(3.0f)));
+
+        // The test cube is already as small as it gets
+        std::unique_ptr<const Ac3d_file> cube_file = Ac3d_file_reader::test_cube(1.0f, 2.0f, 3.0f);
+        Physics_model                    cube(*cube_file, 4);
+        Assert::IsTrue(cube.vectors().size() == 4);
+        Physics_model full_cube(*cube_file);
+        Assert::IsTrue(full_cube.vectors().size() == 8);
+    }
+
+    TEST_METHOD(small_support_test)
+    {
+        // Small models check every vertex, and should always pick the first
+        // of any that tie
+        std::unique_ptr<const Ac3d_file> cube_file = Ac3d_file_reader::test_cube(1.0f, 2.0f, 3.0f);
+        Physics_model                    cube(*cube_file);
+        const Local_vector               directions[] = {
+            Local_vector(1, 0, 0), Local_vector(0, -1, 0), Local_vector(0, 0, 1),
+            Local_vector(1, 1, 0), Local_vector(-1, 1, -1)};
+        for (const auto& direction : directions) {
+            int hint = 5;
+            cube.support(direction, hint);
+            Assert::IsTrue(hint == first_max(cube, direction));
+        }
+
+        std::unique_ptr<Ac3d_model>     ac3d_model = std::make_unique<Ac3d_model>();
+        std::mt19937                    generator(3);
+        std::normal_distribution<float> normal;
+        for (int i = 0; i < 21; ++i) {
+            Local_vector v(normal(generator), normal(generator), normal(generator));
+            ac3d_model->points().push_back(to_point(v / v.length()));
+        }
+        std::vector<Ac3d_material> materials;
+        materials.push_back(Ac3d_material::Color(1.0f, 1.0f, 1.0f));
+        Ac3d_file     model_file(std::move(materials), std::move(ac3d_model));
+        Physics_model model(model_file);
+        for (int i = 0; i < 100; ++i) {
+            Local_vector direction(normal(generator), normal(generator), normal(generator));
+            int          hint = 0;
+            model.support(direction, hint);
+            Assert::IsTrue(hint == first_max(model, direction));
+        }
+    }
+
+    TEST_METHOD(support_test)
+    {
+        // Enough points on a sphere that support walks the hull instead of
+        // checking everything. It should always agree with checking everything.
+        std::unique_ptr<Ac3d_model>     ac3d_model = std::make_unique<Ac3d_model>();
+        std::mt19937                    generator(1);
+        std::normal_distribution<float> normal;
+        for (int i = 0; i < 300; ++i) {
+            Local_vector v(normal(generator), normal(generator), normal(generator));
+            ac3d_model->points().push_back(to_point(v / v.length()));
+        }
+        std::vector<Ac3d_material> materials;
+        materials.push_back(Ac3d_material::Color(1.0f, 1.0f, 1.0f));
+        Ac3d_file     model_file(std::move(materials), std::move(ac3d_model));
+        Physics_model model(model_file);
+        Assert::IsTrue(model.vectors().size() == 300);
+
+        std::uniform_int_distribution<int> vertex(0, 299);
+        int                                hint = 0;
+        for (int i = 0; i < 500; ++i) {
+            Local_vector direction(normal(generator), normal(generator), normal(generator));
+            if (i % 2 == 0) {
+                hint = vertex(generator);
+            }
+            const Local_vector& found = model.support(direction, hint);
+            Assert::IsTrue(found == model.vectors()[hint]);
+            for (const auto& v : model.vectors()) {
+                Assert::IsTrue(dot_product(v, direction) <= dot_product(found, direction));
+            }
+        }
+    }
+
+    TEST_METHOD(bounds_test)
+    {
+        std::unique_ptr<const Ac3d_file> model_file = Ac3d_file_reader::test_cube_group(1.0f);
+        Physics_model                    model(*model_file);
+        // The top level has no points of its own, just the three kids
+        Assert::IsTrue(model.bounds().radius < 0);
+        Assert::IsTrue(model.tree_bounds().center == Local_vector(0.5f, 0.5f, 0.5f));
+        Assert::IsTrue(equals(model.tree_bounds().radius, 1.5f * sqrt(3.0f)));
+        Assert::IsTrue(model.kids().size() == 3);
+        const Physics_model& kid = *model.kids()[1];
+        Assert::IsTrue(kid.bounds().center == Local_vector(0, 1, 0));
+        Assert::IsTrue(equals(kid.bounds().radius, sqrt(3.0f)));
+        Assert::IsTrue(kid.tree_bounds().center == kid.bounds().center);
+
+        Physics_model capsule(0.5f, 1.0f);
+        Assert::IsTrue(capsule.bounds().center == Local_vector());
+        Assert::IsTrue(equals(capsule.bounds().radius, 1.5f));
+    }
+
+    TEST_METHOD(faces_test)
+    {
+        // The two triangles on each side of the box are merged
+        Physics_model box(Local_vector(1, 2, 3));
+        Assert::IsTrue(box.faces().size() == 6);
+        for (const auto& face : box.faces()) {
+            Assert::IsTrue(face.count == 4);
+            const Local_vector* corner[3];
+            for (int i = 0; i < 3; ++i) {
+                corner[i] = &box.vectors()[box.face_vertices()[face.first + i]];
+                Assert::IsTrue(equals(dot_product(face.normal, *corner[i]), face.offset));
+            }
+            // Counter clockwise from outside
+            Assert::IsTrue(
+                dot_product(cross_product(*corner[1] - *corner[0], *corner[2] - *corner[0]),
+                            face.normal) > 0);
+        }
+        Local_vector up(0, 1, 0);
+        auto         top = std::find_if(box.faces().begin(), box.faces().end(),
+                                [&up](const Physics_model::Face& face) {
+                                    return face.normal == up;
+                                });
+        Assert::IsTrue(top != box.faces().end());
+        Assert::IsTrue(equals(top->offset, 2));
+
+        Physics_model sphere(1.0f);
+        Assert::IsTrue(sphere.faces().empty());
+    }
+
+private:
+    int first_max(const Physics_model& model, const Local_vector& direction)
+    {
+        int   result  = 0;
+        float max_dot = dot_product(model.vectors()[0], direction);
+        for (int i = 1; i < static_cast<int>(model.vectors().size()); ++i) {
+            if (dot_product(model.vectors()[i], direction) > max_dot) {
+                max_dot = dot_product(model.vectors()[i], direction);
+                result  = i;
+            }
+        }
+        return result;
+    }
 };
 }  // namespace Physics_test
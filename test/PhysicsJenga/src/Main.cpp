@@ -100,6 +100,7 @@ main(int argc, char** argv)
         constraint_solver_settings.coefficient_of_restitution = 0.0f;
         constraint_solver_settings.iterations                 = 10;
         constraint_solver_settings.warm_start_scale           = 0.0f;
+        constraint_solver_settings.allow_sleeping             = true;
 
         arena = std::make_unique<Physics::Arena>(
             Physics::Arena::Settings(collision_solver_settings, constraint_solver_settings));
@@ -119,7 +120,8 @@ main(int argc, char** argv)
         simple_renderer.reset(new Renderer::Simple_object_renderer(context_store));
 
         visible_model = std::make_shared<Renderer::Visible_model>(*floor_file, false);
-        physics_model = std::make_shared<Physics::Physics_model>(*floor_file);
+        physics_model =
+            std::make_shared<Physics::Physics_model>(Math::Local_vector(8.0f, 0.5f, 8.0f));
         visible_objects.push_back(
             std::make_shared<Renderer::Visible_object>(visible_model, visible_model));
         visible_objects.back()->coordinate_space().translate(Math::Vector(0, -0.5f, 0));
@@ -132,7 +134,8 @@ main(int argc, char** argv)
         arena->push_back(physics_objects.back());
 
         visible_model = std::make_shared<Renderer::Visible_model>(*model_file, false);
-        physics_model = std::make_shared<Physics::Physics_model>(*model_file);
+        physics_model = std::make_shared<Physics::Physics_model>(
+            Math::Local_vector(OBJECT_WIDTH / 2.0f, OBJECT_HEIGHT / 2.0f, OBJECT_DEPTH / 2.0f));
         float layer   = OBJECT_HEIGHT / 2.0f;
         float angle   = 0.0f;
         for (int i = 0; i < NUM_LAYERS; ++i) {
@@ -273,11 +276,11 @@ on_idle()
         glPointSize(3.0f);
 
         for (const auto& manifold : arena->manifolds()) {
-            for (const auto& c : manifold.second.contacts()) {
+            for (const auto& c : manifold.contacts()) {
                 {
                     Renderer::Open_gl_primitive prim(Renderer::Open_gl_primitive::LINES);
-                    prim.vertex(c.contact_point_a);
-                    prim.vertex(c.contact_point_b);
+                    prim.vertex(manifold.contact_point_a(c));
+                    prim.vertex(manifold.contact_point_b(c));
                 }
                 //            Renderer::Open_gl_primitive prim(Renderer::Open_gl_primitive::LINES);
                 //          prim.vertex(c.contact_point_a);
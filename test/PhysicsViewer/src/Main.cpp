@@ -102,7 +102,8 @@ main(int argc, char** argv)
         simple_renderer.reset(new Renderer::Simple_object_renderer(context_store));
 
         auto visible_model = std::make_shared<Renderer::Visible_model>(*floor_file, false);
-        auto physics_model = std::make_shared<Physics::Physics_model>(*floor_file);
+        auto physics_model =
+            std::make_shared<Physics::Physics_model>(Math::Local_vector(20.0f, 0.5f, 20.0f));
         visible_objects.push_back(
             std::make_shared<Renderer::Visible_object>(visible_model, visible_model));
         visible_objects.back()->coordinate_space().translate(Math::Vector(0, -0.5f, 0));
@@ -115,7 +116,13 @@ main(int argc, char** argv)
         arena->push_back(physics_objects.back());
 
         visible_model = std::make_shared<Renderer::Visible_model>(*model_file, false);
-        physics_model = std::make_shared<Physics::Physics_model>(*model_file);
+        if (argc == 2) {
+            physics_model = std::make_shared<Physics::Physics_model>(*model_file);
+        }
+        else {
+            physics_model =
+                std::make_shared<Physics::Physics_model>(Math::Local_vector(0.5f, 0.5f, 0.5f));
+        }
         Renderer::Color object_color = Renderer::Color::RED;
         for (int i = 0; i < NUM_OBJECTS; ++i) {
             visible_objects.push_back(
@@ -242,11 +249,11 @@ on_idle()
         glPointSize(5.0f);
 
         for (const auto& manifold : arena->manifolds()) {
-            for (const auto& c : manifold.second.contacts()) {
+            for (const auto& c : manifold.contacts()) {
                 {
                     Renderer::Open_gl_primitive prim(Renderer::Open_gl_primitive::POINTS);
-                    prim.vertex(c.contact_point_a);
-                    prim.vertex(c.contact_point_b);
+                    prim.vertex(manifold.contact_point_a(c));
+                    prim.vertex(manifold.contact_point_b(c));
                 }
                 // Renderer::Open_gl_primitive prim(Renderer::Open_gl_primitive::LINES);
                 // prim.vertex(c.contact_point_a);
@@ -1,4 +1,3 @@
-#include <Ac3d_file_reader.h>
 #include <File_path.h>
 #include <Point.h>
 #include <Vector_math.h>
@@ -36,11 +35,10 @@ main(int argc, char** argv)
             Physics::Arena::Settings(collision_solver_settings, constraint_solver_settings));
         std::vector<std::shared_ptr<Physics::Physics_object>> physics_objects;
 
-        auto floor_file  = Utility::Ac3d_file_reader::test_cube(20.0f, 0.5f, 20.0f);
-        auto floor_model = std::make_shared<Physics::Physics_model>(*floor_file);
-
-        auto cube_file  = Utility::Ac3d_file_reader::test_cube(0.5f, 0.5f, 0.5f);
-        auto cube_model = std::make_shared<Physics::Physics_model>(*cube_file);
+        auto floor_model =
+            std::make_shared<Physics::Physics_model>(Math::Local_vector(20.0f, 0.5f, 20.0f));
+        auto cube_model =
+            std::make_shared<Physics::Physics_model>(Math::Local_vector(0.5f, 0.5f, 0.5f));
 
         physics_objects.push_back(std::make_shared<Physics::Physics_object>(
             floor_model, Physics::Physics_object::STATIONARY));